@@ -241,6 +241,9 @@ class FrameAnalyzerModule extends WasmModule {
 // AUDIO FINGERPRINT MODULE
 // ============================================================================
 
+// Rate the audio analysis paths run at (ANALYSIS_SAMPLE_RATE in audio_fingerprint.cpp)
+const ANALYSIS_SAMPLE_RATE = 11025;
+
 class AudioFingerprintModule extends WasmModule {
     constructor() {
         super('audio_fingerprint');
@@ -248,19 +251,18 @@ class AudioFingerprintModule extends WasmModule {
 
     /**
      * Detect intro boundaries in audio
-     * @param {Float32Array} audioSamples - Audio samples
+     * Audio is downmixed and resampled to ANALYSIS_SAMPLE_RATE inside Wasm first
+     * @param {Float32Array} audioSamples - Audio samples (interleaved when channels > 1)
      * @param {number} sampleRate - Sample rate (e.g., 44100)
+     * @param {number} channels - Interleaved channel count
      * @returns {Object} { introStart, introEnd, confidence, duration }
      */
-    detectIntroBoundaries(audioSamples, sampleRate) {
-        const sampleCount = audioSamples.length;
-        const ptr = this.malloc(sampleCount * 4); // Float32 = 4 bytes
+    detectIntroBoundaries(audioSamples, sampleRate, channels = 1) {
+        const analysis = this.toAnalysisAudio(audioSamples, sampleRate, channels);
+        if (!analysis) return null;
 
         try {
-            const view = new Float32Array(this.memory.buffer);
-            view.set(audioSamples, ptr / 4);
-            
-            const resultPtr = this.exports.detect_intro_boundaries(ptr, sampleCount, sampleRate);
+            const resultPtr = this.exports.detect_intro_boundaries(analysis.ptr, analysis.length, ANALYSIS_SAMPLE_RATE);
             
             if (resultPtr === 0) return null;
 
@@ -273,6 +275,49 @@ class AudioFingerprintModule extends WasmModule {
                 confidence: result[2],
                 duration: result[3]
             };
+        } finally {
+            this.free(analysis.ptr);
+        }
+    }
+
+    /**
+     * Landmark hashes of decoded audio (resampled to ANALYSIS_SAMPLE_RATE inside Wasm)
+     * @param {Float32Array} audioSamples - Audio samples (interleaved when channels > 1)
+     * @param {number} sampleRate - Sample rate (e.g., 48000)
+     * @param {number} channels - Interleaved channel count
+     * @returns {Uint32Array} (hash, anchor_frame) pairs
+     */
+    extractLandmarks(audioSamples, sampleRate, channels = 1, fftSize = 1024) {
+        const frames = Math.floor(audioSamples.length / channels);
+        const maxLandmarks = Math.max(1, Math.ceil(frames * ANALYSIS_SAMPLE_RATE / sampleRate / (fftSize / 4)) * 25);
+        const ptr = this.malloc(audioSamples.length * 4);
+        const outPtr = this.malloc(maxLandmarks * 8);
+
+        try {
+            this.writeArray(ptr, audioSamples, 'Float32');
+            const count = this.exports.extract_landmarks_from_audio(ptr, frames, channels, sampleRate, fftSize,
+                                                                    outPtr, maxLandmarks);
+            return Uint32Array.from(this.readArray(outPtr, count * 2, 'Int32'), (v) => v >>> 0);
+        } finally {
+            this.free(ptr);
+            this.free(outPtr);
+        }
+    }
+
+    /**
+     * Downmix + resample into a Wasm buffer at ANALYSIS_SAMPLE_RATE
+     * @returns {{ptr: number, length: number}|null} (free ptr when done)
+     */
+    toAnalysisAudio(audioSamples, sampleRate, channels = 1) {
+        const frames = Math.floor(audioSamples.length / channels);
+        const ptr = this.malloc(audioSamples.length * 4);
+
+        try {
+            this.writeArray(ptr, audioSamples, 'Float32');
+            const resultPtr = this.exports.resample_audio(ptr, frames, channels, sampleRate, ANALYSIS_SAMPLE_RATE);
+            if (resultPtr === 0) return null;
+
+            return { ptr: resultPtr, length: this.exports.get_resampled_length(frames, sampleRate, ANALYSIS_SAMPLE_RATE) };
         } finally {
             this.free(ptr);
         }
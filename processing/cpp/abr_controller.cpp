@@ -3,10 +3,16 @@
  * Real-time bandwidth prediction and quality selection for HLS/DASH streaming
  */
 
+#ifdef __EMSCRIPTEN__
 #include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE   // native builds (abr_simulator)
+#endif
 #include <cmath>
 #include <cstring>
 #include <cstdlib>
+#include <cstdint>
+#include <cstddef>
 
 #ifndef M_E
 #define M_E 2.71828182845904523536
@@ -16,8 +22,7 @@
 // QUALITY LEVEL DEFINITIONS
 // ============================================================================
 
-// Quality levels (bitrates in kbps)
-static const int QUALITY_BITRATES[] = {400, 800, 1500, 3000, 6000, 12000};
+// Default quality levels (bitrates in kbps, see DEFAULT_LADDER)
 static const int NUM_QUALITIES = 6;
 
 // Quality level names for reference:
@@ -28,10 +33,219 @@ static const int NUM_QUALITIES = 6;
 // 4: 1080p (6000 kbps)
 // 5: 4K    (12000 kbps)
 
+static const int MAX_LADDER_RUNGS = 16;
+
+/**
+ * Bitrate ladder the decisions run over (rungs in ascending bitrate)
+ * The array exports use DEFAULT_LADDER; sessions and the *_ladder exports
+ * take the renditions actually published (create_abr_ladder_from_playlist).
+ * segment_kbits: optional real segment sizes, rung-major (count x segment_count)
+ */
+struct AbrLadder {
+    int count;
+    float bitrates[MAX_LADDER_RUNGS];   // kbps
+    int widths[MAX_LADDER_RUNGS];
+    int heights[MAX_LADDER_RUNGS];
+    float* segment_kbits;
+    int segment_count;
+};
+
+static const AbrLadder DEFAULT_LADDER = {
+    NUM_QUALITIES,
+    { 400, 800, 1500, 3000, 6000, 12000 },
+    { 426, 640, 854, 1280, 1920, 3840 },
+    { 240, 360, 480, 720, 1080, 2160 },
+    nullptr, 0
+};
+
+static inline const AbrLadder* ladder_or_default(const AbrLadder* ladder) {
+    return ladder ? ladder : &DEFAULT_LADDER;
+}
+
+/**
+ * Quality score of a rung, normalized 0-1 over the ladder
+ */
+static inline float ladder_quality_score(const AbrLadder* ladder, int rung) {
+    return (ladder->count > 1) ? (float)rung / (ladder->count - 1) : 1.0f;
+}
+
+/**
+ * Size of one segment of a rung in kbit: the real size when the ladder has
+ * it for `segment`, otherwise bitrate * duration
+ */
+static inline float ladder_segment_kbits(const AbrLadder* ladder, int rung, int segment, float segment_duration) {
+    if (ladder->segment_kbits && segment >= 0 && segment < ladder->segment_count) {
+        return ladder->segment_kbits[(size_t)rung * ladder->segment_count + segment];
+    }
+    return ladder->bitrates[rung] * segment_duration;
+}
+
+// ============================================================================
+// LADDER CONFIGURATION
+// ============================================================================
+
+/**
+ * Insert one rung keeping ascending bitrate order
+ * Returns false when the ladder is full or the bitrate is not positive
+ */
+static bool ladder_insert(AbrLadder* ladder, float kbps, int width, int height) {
+    if (ladder->count >= MAX_LADDER_RUNGS || !(kbps > 0.0f)) return false;
+
+    int i = ladder->count++;
+    while (i > 0 && ladder->bitrates[i - 1] > kbps) {
+        ladder->bitrates[i] = ladder->bitrates[i - 1];
+        ladder->widths[i] = ladder->widths[i - 1];
+        ladder->heights[i] = ladder->heights[i - 1];
+        i--;
+    }
+    ladder->bitrates[i] = kbps;
+    ladder->widths[i] = width;
+    ladder->heights[i] = height;
+    return true;
+}
+
+/**
+ * Create a ladder from parallel arrays (any order; rungs are sorted by bitrate)
+ * widths / heights may be nullptr. Returns nullptr on invalid input
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+AbrLadder* create_abr_ladder(float* bitrates_kbps, int* widths, int* heights, int count) {
+    if (!bitrates_kbps || count < 1 || count > MAX_LADDER_RUNGS) return nullptr;
+
+    AbrLadder* ladder = (AbrLadder*)calloc(1, sizeof(AbrLadder));
+    if (!ladder) return nullptr;
+
+    for (int i = 0; i < count; i++) {
+        if (!ladder_insert(ladder, bitrates_kbps[i], widths ? widths[i] : 0, heights ? heights[i] : 0)) {
+            free(ladder);
+            return nullptr;
+        }
+    }
+    return ladder;
+}
+
+/**
+ * Value of a playlist attribute (NAME=value) within one tag line, or nullptr
+ * Quoted values (CODECS="a,b") are skipped over, not matched inside
+ */
+static const char* playlist_attribute(const char* attrs, const char* line_end, const char* name) {
+    size_t name_len = strlen(name);
+    const char* p = attrs;
+
+    while (p < line_end) {
+        if ((size_t)(line_end - p) > name_len && strncmp(p, name, name_len) == 0 && p[name_len] == '=') {
+            return p + name_len + 1;
+        }
+        // Advance to the next attribute
+        bool quoted = false;
+        while (p < line_end && (quoted || *p != ',')) {
+            if (*p == '"') quoted = !quoted;
+            p++;
+        }
+        if (p < line_end) p++;
+    }
+    return nullptr;
+}
+
+/**
+ * Create a ladder from an HLS master playlist (NUL-terminated text)
+ * Every #EXT-X-STREAM-INF becomes a rung: AVERAGE-BANDWIDTH when present,
+ * else BANDWIDTH (bits/s -> kbps), with RESOLUTION=WxH when given.
+ * Returns nullptr when no variant stream is found
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+AbrLadder* create_abr_ladder_from_playlist(const char* playlist) {
+    if (!playlist) return nullptr;
+
+    AbrLadder* ladder = (AbrLadder*)calloc(1, sizeof(AbrLadder));
+    if (!ladder) return nullptr;
+
+    static const char TAG[] = "#EXT-X-STREAM-INF:";
+    const char* line = playlist;
+
+    while (*line) {
+        const char* line_end = line + strcspn(line, "\r\n");
+
+        if (strncmp(line, TAG, sizeof(TAG) - 1) == 0) {
+            const char* attrs = line + sizeof(TAG) - 1;
+            const char* bandwidth = playlist_attribute(attrs, line_end, "AVERAGE-BANDWIDTH");
+            if (!bandwidth) bandwidth = playlist_attribute(attrs, line_end, "BANDWIDTH");
+            const char* resolution = playlist_attribute(attrs, line_end, "RESOLUTION");
+
+            int width = 0, height = 0;
+            if (resolution) {
+                char* x = nullptr;
+                width = (int)strtol(resolution, &x, 10);
+                if (x && (*x == 'x' || *x == 'X')) height = (int)strtol(x + 1, nullptr, 10);
+            }
+            if (bandwidth) ladder_insert(ladder, (float)(strtod(bandwidth, nullptr) / 1000.0), width, height);
+        }
+
+        line = line_end;
+        while (*line == '\r' || *line == '\n') line++;
+    }
+
+    if (ladder->count == 0) {
+        free(ladder);
+        return nullptr;
+    }
+    return ladder;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_abr_ladder(AbrLadder* ladder) {
+    if (!ladder) return;
+    free(ladder->segment_kbits);
+    free(ladder);
+}
+
+/**
+ * Attach real segment sizes (bytes), rung-major: segment_count per rung in
+ * ladder order. Decisions for a known segment index then use these instead
+ * of bitrate * duration (VBR encodes). Returns 1 on success
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int abr_ladder_set_segment_sizes(AbrLadder* ladder, float* segment_bytes, int segment_count) {
+    if (!ladder || !segment_bytes || segment_count < 1) return 0;
+
+    size_t cells = (size_t)ladder->count * segment_count;
+    float* kbits = (float*)malloc(cells * sizeof(float));
+    if (!kbits) return 0;
+
+    for (size_t i = 0; i < cells; i++) kbits[i] = segment_bytes[i] * 8.0f / 1000.0f;
+
+    free(ladder->segment_kbits);
+    ladder->segment_kbits = kbits;
+    ladder->segment_count = segment_count;
+    return 1;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int abr_ladder_size(AbrLadder* ladder) {
+    return ladder_or_default(ladder)->count;
+}
+
+/**
+ * Rung description: [bitrate_kbps, width, height]
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int abr_ladder_rung(AbrLadder* ladder, int rung, float* result) {
+    const AbrLadder* l = ladder_or_default(ladder);
+    if (!result || rung < 0 || rung >= l->count) return 0;
+
+    result[0] = l->bitrates[rung];
+    result[1] = (float)l->widths[rung];
+    result[2] = (float)l->heights[rung];
+    return 1;
+}
+
 // ============================================================================
 // BANDWIDTH PREDICTION
 // ============================================================================
 
+static const float EWMA_ALPHA = 0.3f;
+static const float BANDWIDTH_SAFETY = 0.8f;
+
 /**
  * Predict bandwidth using exponential weighted moving average
  */
@@ -40,7 +254,7 @@ float predict_bandwidth(float* history, int history_length) {
     if (!history || history_length < 1) return 0.0f;
     
     // Use EWMA with alpha = 0.3 (more weight on recent measurements)
-    float alpha = 0.3f;
+    float alpha = EWMA_ALPHA;
     float ewma = history[0];
     
     for (int i = 1; i < history_length; i++) {
@@ -48,7 +262,7 @@ float predict_bandwidth(float* history, int history_length) {
     }
     
     // Apply safety margin (use 80% of predicted bandwidth)
-    return ewma * 0.8f;
+    return ewma * BANDWIDTH_SAFETY;
 }
 
 /**
@@ -72,6 +286,17 @@ float predict_bandwidth_harmonic(float* history, int history_length) {
     return (float)valid_count / sum_reciprocal;
 }
 
+/**
+ * Trend from a regression slope (per sample) normalized by the average
+ */
+static inline int classify_trend(float slope, float avg) {
+    float norm_slope = slope / avg;
+    
+    if (norm_slope > 0.1f) return 1;   // Increasing
+    if (norm_slope < -0.1f) return -1; // Decreasing
+    return 0; // Stable
+}
+
 /**
  * Detect bandwidth trend (increasing, stable, decreasing)
  * Returns: 1 = increasing, 0 = stable, -1 = decreasing
@@ -94,12 +319,7 @@ int detect_bandwidth_trend(float* history, int history_length) {
     float slope = (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
     float avg = sum_y / n;
     
-    // Normalize slope relative to average
-    float norm_slope = slope / avg;
-    
-    if (norm_slope > 0.1f) return 1;   // Increasing
-    if (norm_slope < -0.1f) return -1; // Decreasing
-    return 0; // Stable
+    return classify_trend(slope, avg);
 }
 
 // ============================================================================
@@ -110,12 +330,12 @@ int detect_bandwidth_trend(float* history, int history_length) {
  * Select optimal quality level based on bandwidth and buffer
  * Uses BBA (Buffer-Based Adaptation) combined with throughput estimation
  */
-extern "C" EMSCRIPTEN_KEEPALIVE
-int select_quality_level(float bandwidth, float buffer_level, int current_quality, int max_quality) {
+static int select_level_on_ladder(const AbrLadder* ladder, float bandwidth, float buffer_level,
+                                  int current_quality, int max_quality) {
     if (bandwidth <= 0) return 0;
     
     int target_quality = current_quality;
-    int actual_max = (max_quality < NUM_QUALITIES) ? max_quality : NUM_QUALITIES - 1;
+    int actual_max = (max_quality < ladder->count) ? max_quality : ladder->count - 1;
     
     // Buffer thresholds (in seconds)
     const float LOW_BUFFER = 5.0f;
@@ -130,7 +350,7 @@ int select_quality_level(float bandwidth, float buffer_level, int current_qualit
     // Find highest quality that fits bandwidth
     int bandwidth_quality = 0;
     for (int i = 0; i <= actual_max; i++) {
-        if (QUALITY_BITRATES[i] <= bandwidth * 0.9f) { // 90% safety margin
+        if (ladder->bitrates[i] <= bandwidth * 0.9f) { // 90% safety margin
             bandwidth_quality = i;
         }
     }
@@ -147,7 +367,7 @@ int select_quality_level(float bandwidth, float buffer_level, int current_qualit
     } else {
         // Medium buffer - stable adaptation
         // Only switch if bandwidth supports it clearly
-        if (bandwidth_quality > current_quality && bandwidth > QUALITY_BITRATES[current_quality + 1] * 1.2f) {
+        if (bandwidth_quality > current_quality && bandwidth > ladder->bitrates[current_quality + 1] * 1.2f) {
             target_quality = current_quality + 1;
         } else if (bandwidth_quality < current_quality) {
             target_quality = bandwidth_quality;
@@ -163,32 +383,65 @@ int select_quality_level(float bandwidth, float buffer_level, int current_qualit
     return target_quality;
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_quality_level(float bandwidth, float buffer_level, int current_quality, int max_quality) {
+    return select_level_on_ladder(&DEFAULT_LADDER, bandwidth, buffer_level, current_quality, max_quality);
+}
+
 /**
- * Select quality with oscillation prevention
+ * select_quality_level over a runtime ladder (nullptr: default ladder)
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-int select_quality_stable(float bandwidth, float buffer_level, int current_quality, 
-                          int max_quality, int* switch_history, int history_length) {
+int select_quality_level_ladder(AbrLadder* ladder, float bandwidth, float buffer_level,
+                                int current_quality, int max_quality) {
+    return select_level_on_ladder(ladder_or_default(ladder), bandwidth, buffer_level, current_quality, max_quality);
+}
+
+// Oscillation guard: quality levels remembered and switches tolerated among them
+static const int SWITCH_HISTORY_WINDOW = 5;
+static const int SWITCH_HISTORY_LIMIT = 3;
+
+/**
+ * With too many recent switches, be more conservative and avoid small changes
+ */
+static inline int hold_if_oscillating(int recommended, int current_quality, int recent_switches) {
+    if (recent_switches >= SWITCH_HISTORY_LIMIT && abs(recommended - current_quality) == 1) {
+        return current_quality;
+    }
+    return recommended;
+}
+
+/**
+ * Select quality with oscillation prevention
+ */
+static int select_stable_on_ladder(const AbrLadder* ladder, float bandwidth, float buffer_level, int current_quality,
+                                   int max_quality, const int* switch_history, int history_length) {
     // Get base recommendation
-    int recommended = select_quality_level(bandwidth, buffer_level, current_quality, max_quality);
+    int recommended = select_level_on_ladder(ladder, bandwidth, buffer_level, current_quality, max_quality);
     
     // Count recent switches
     int recent_switches = 0;
     if (switch_history && history_length > 0) {
-        for (int i = history_length - 5; i < history_length && i >= 0; i++) {
+        for (int i = history_length - SWITCH_HISTORY_WINDOW; i < history_length && i >= 0; i++) {
             if (switch_history[i] != current_quality) recent_switches++;
         }
     }
     
-    // If too many recent switches, be more conservative
-    if (recent_switches >= 3) {
-        // Avoid small changes
-        if (abs(recommended - current_quality) == 1) {
-            return current_quality;
-        }
-    }
-    
-    return recommended;
+    return hold_if_oscillating(recommended, current_quality, recent_switches);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_quality_stable(float bandwidth, float buffer_level, int current_quality, 
+                          int max_quality, int* switch_history, int history_length) {
+    return select_stable_on_ladder(&DEFAULT_LADDER, bandwidth, buffer_level, current_quality,
+                                   max_quality, switch_history, history_length);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_quality_stable_ladder(AbrLadder* ladder, float bandwidth, float buffer_level, int current_quality,
+                                 int max_quality, int* switch_history, int history_length) {
+    return select_stable_on_ladder(ladder_or_default(ladder), bandwidth, buffer_level, current_quality,
+                                   max_quality, switch_history, history_length);
 }
 
 // ============================================================================
@@ -245,12 +498,11 @@ float calculate_rebuffer_probability(float buffer_seconds, float download_time,
 /**
  * Calculate estimated QoE score for a quality level
  */
-extern "C" EMSCRIPTEN_KEEPALIVE
-float estimate_qoe(int quality_level, float rebuffer_probability, float switch_penalty) {
-    if (quality_level < 0 || quality_level >= NUM_QUALITIES) return 0.0f;
+static float qoe_on_ladder(const AbrLadder* ladder, int quality_level, float rebuffer_probability, float switch_penalty) {
+    if (quality_level < 0 || quality_level >= ladder->count) return 0.0f;
     
     // Quality score (normalized 0-1)
-    float quality_score = (float)quality_level / (NUM_QUALITIES - 1);
+    float quality_score = ladder_quality_score(ladder, quality_level);
     
     // Rebuffer penalty (very impactful on QoE)
     float rebuffer_cost = rebuffer_probability * 0.5f;
@@ -262,19 +514,29 @@ float estimate_qoe(int quality_level, float rebuffer_probability, float switch_p
     return fmaxf(0.0f, fminf(1.0f, qoe));
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE
+float estimate_qoe(int quality_level, float rebuffer_probability, float switch_penalty) {
+    return qoe_on_ladder(&DEFAULT_LADDER, quality_level, rebuffer_probability, switch_penalty);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float estimate_qoe_ladder(AbrLadder* ladder, int quality_level, float rebuffer_probability, float switch_penalty) {
+    return qoe_on_ladder(ladder_or_default(ladder), quality_level, rebuffer_probability, switch_penalty);
+}
+
 /**
  * Select quality that maximizes QoE
+ * segment >= 0 uses that segment's real size when the ladder carries sizes
  */
-extern "C" EMSCRIPTEN_KEEPALIVE
-int select_quality_maximize_qoe(float bandwidth, float buffer_seconds, float segment_duration,
-                                int current_quality, int max_quality) {
+static int select_max_qoe_on_ladder(const AbrLadder* ladder, float bandwidth, float buffer_seconds,
+                                    float segment_duration, int segment, int current_quality, int max_quality) {
     int best_quality = 0;
     float best_qoe = -1.0f;
-    int actual_max = (max_quality < NUM_QUALITIES) ? max_quality : NUM_QUALITIES - 1;
+    int actual_max = (max_quality < ladder->count) ? max_quality : ladder->count - 1;
     
     for (int q = 0; q <= actual_max; q++) {
         // Estimate download time for this quality
-        float download_time = (QUALITY_BITRATES[q] * segment_duration) / bandwidth;
+        float download_time = ladder_segment_kbits(ladder, q, segment, segment_duration) / bandwidth;
         
         // Calculate rebuffer probability
         float rebuffer_prob = calculate_rebuffer_probability(buffer_seconds, download_time, segment_duration);
@@ -283,7 +545,7 @@ int select_quality_maximize_qoe(float bandwidth, float buffer_seconds, float seg
         float switch_penalty = (q != current_quality) ? 1.0f : 0.0f;
         
         // Calculate QoE
-        float qoe = estimate_qoe(q, rebuffer_prob, switch_penalty);
+        float qoe = qoe_on_ladder(ladder, q, rebuffer_prob, switch_penalty);
         
         if (qoe > best_qoe) {
             best_qoe = qoe;
@@ -294,6 +556,23 @@ int select_quality_maximize_qoe(float bandwidth, float buffer_seconds, float seg
     return best_quality;
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_quality_maximize_qoe(float bandwidth, float buffer_seconds, float segment_duration,
+                                int current_quality, int max_quality) {
+    return select_max_qoe_on_ladder(&DEFAULT_LADDER, bandwidth, buffer_seconds, segment_duration, -1,
+                                    current_quality, max_quality);
+}
+
+/**
+ * select_quality_maximize_qoe over a runtime ladder; segment < 0 ignores segment sizes
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_quality_maximize_qoe_ladder(AbrLadder* ladder, float bandwidth, float buffer_seconds,
+                                       float segment_duration, int segment, int current_quality, int max_quality) {
+    return select_max_qoe_on_ladder(ladder_or_default(ladder), bandwidth, buffer_seconds, segment_duration, segment,
+                                    current_quality, max_quality);
+}
+
 // ============================================================================
 // STATISTICS
 // ============================================================================
@@ -319,20 +598,14 @@ float calculate_bandwidth_variance(float* history, int history_length) {
 }
 
 /**
- * Get recommended quality based on all factors
- * Returns: [quality_level, confidence, rebuffer_risk, estimated_qoe]
+ * Shared tail of the recommendation: trend-adjust the prediction, pick the
+ * QoE-maximizing level (held by the oscillation guard after recent_switches)
+ * and score it. result: [quality_level, confidence, rebuffer_risk, estimated_qoe]
  */
-extern "C" EMSCRIPTEN_KEEPALIVE
-float* get_comprehensive_recommendation(float* bandwidth_history, int history_length,
-                                        float buffer_seconds, float segment_duration,
-                                        int current_quality, int max_quality) {
-    float* result = (float*)malloc(4 * sizeof(float));
-    if (!result) return nullptr;
-    
-    float predicted_bw = predict_bandwidth(bandwidth_history, history_length);
-    float bw_variance = calculate_bandwidth_variance(bandwidth_history, history_length);
-    int trend = detect_bandwidth_trend(bandwidth_history, history_length);
-    
+static void recommend_from_estimates(const AbrLadder* ladder, float predicted_bw, float bw_variance, int trend,
+                                     float buffer_seconds, float segment_duration, int segment,
+                                     int current_quality, int max_quality, int recent_switches,
+                                     float* result) {
     // Adjust prediction based on trend
     if (trend == -1) predicted_bw *= 0.85f; // Decreasing - be more conservative
     if (trend == 1) predicted_bw *= 1.1f;   // Increasing - can be slightly aggressive
@@ -342,24 +615,1194 @@ float* get_comprehensive_recommendation(float* bandwidth_history, int history_le
     float confidence = 1.0f - fminf(sqrtf(bw_variance) / avg_bw, 1.0f);
     
     // Select quality
-    int quality = select_quality_maximize_qoe(predicted_bw, buffer_seconds, segment_duration,
-                                               current_quality, max_quality);
+    int quality = select_max_qoe_on_ladder(ladder, predicted_bw, buffer_seconds, segment_duration, segment,
+                                           current_quality, max_quality);
+    quality = hold_if_oscillating(quality, current_quality, recent_switches);
     
     // Calculate rebuffer risk
-    float download_time = (QUALITY_BITRATES[quality] * segment_duration) / predicted_bw;
+    float download_time = ladder_segment_kbits(ladder, quality, segment, segment_duration) / predicted_bw;
     float rebuffer_risk = calculate_rebuffer_probability(buffer_seconds, download_time, segment_duration);
     
     // Calculate QoE
-    float qoe = estimate_qoe(quality, rebuffer_risk, (quality != current_quality) ? 1.0f : 0.0f);
+    float qoe = qoe_on_ladder(ladder, quality, rebuffer_risk, (quality != current_quality) ? 1.0f : 0.0f);
     
     result[0] = (float)quality;
     result[1] = confidence;
     result[2] = rebuffer_risk;
     result[3] = qoe;
+}
+
+/**
+ * Get recommended quality based on all factors
+ * Returns: [quality_level, confidence, rebuffer_risk, estimated_qoe]
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* get_comprehensive_recommendation(float* bandwidth_history, int history_length,
+                                        float buffer_seconds, float segment_duration,
+                                        int current_quality, int max_quality) {
+    float* result = (float*)malloc(4 * sizeof(float));
+    if (!result) return nullptr;
+    
+    float predicted_bw = predict_bandwidth(bandwidth_history, history_length);
+    float bw_variance = calculate_bandwidth_variance(bandwidth_history, history_length);
+    int trend = detect_bandwidth_trend(bandwidth_history, history_length);
     
+    recommend_from_estimates(&DEFAULT_LADDER, predicted_bw, bw_variance, trend, buffer_seconds, segment_duration, -1,
+                             current_quality, max_quality, 0, result);
     return result;
 }
 
+/**
+ * get_comprehensive_recommendation over a runtime ladder, into a caller buffer
+ * segment >= 0 uses that segment's real sizes when the ladder has them
+ * result: [quality_level, confidence, rebuffer_risk, estimated_qoe]; returns 1
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int get_comprehensive_recommendation_ladder(AbrLadder* ladder, float* bandwidth_history, int history_length,
+                                            float buffer_seconds, float segment_duration, int segment,
+                                            int current_quality, int max_quality, float* result) {
+    if (!bandwidth_history || history_length < 1 || !result) return 0;
+
+    float predicted_bw = predict_bandwidth(bandwidth_history, history_length);
+    float bw_variance = calculate_bandwidth_variance(bandwidth_history, history_length);
+    int trend = detect_bandwidth_trend(bandwidth_history, history_length);
+
+    recommend_from_estimates(ladder_or_default(ladder), predicted_bw, bw_variance, trend, buffer_seconds,
+                             segment_duration, segment, current_quality, max_quality, 0, result);
+    return 1;
+}
+
+// ============================================================================
+// BATCHED DECISIONS (structure of arrays)
+// ============================================================================
+
+// Sessions decided together; per-block scratch stays on the stack
+static const int ABR_BATCH_BLOCK = 64;
+
+/**
+ * calculate_rebuffer_probability written as selects, so the batched loops
+ * vectorize; same result for every input
+ */
+static inline float rebuffer_probability_select(float buffer_seconds, float download_time, float segment_duration) {
+    float download_rate = download_time / segment_duration;
+    float time_to_rebuffer = buffer_seconds / (1.0f - download_rate);
+
+    float p = 1.0f - (time_to_rebuffer / 30.0f);
+    p = (time_to_rebuffer < 5.0f) ? 0.9f : p;
+    p = (time_to_rebuffer > 30.0f) ? 0.0f : p;
+    p = (download_rate >= 1.0f) ? 1.0f : p;
+    p = (download_time <= 0.0f) ? 0.0f : p;
+    p = (buffer_seconds <= 0.0f) ? 1.0f : p;
+    return p;
+}
+
+/**
+ * fmaxf(0, fminf(1, qoe)) as selects; NaN maps to 1, as fminf returns its
+ * non-NaN operand
+ */
+static inline float clamp_qoe(float qoe) {
+    qoe = (qoe < 1.0f) ? qoe : 1.0f;
+    return (qoe > 0.0f) ? qoe : 0.0f;
+}
+
+/**
+ * select_quality_level for many sessions in one call
+ * bandwidth, buffer_level, current_quality, output: count entries each
+ * (output[i] is exactly select_quality_level_ladder for session i).
+ * Returns number of decisions written
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_quality_level_batch(AbrLadder* ladder, float* bandwidth, float* buffer_level, int* current_quality,
+                               int max_quality, int count, int* output) {
+    if (!bandwidth || !buffer_level || !current_quality || !output || count < 1) return 0;
+
+    const AbrLadder* l = ladder_or_default(ladder);
+    int actual_max = (max_quality < l->count) ? max_quality : l->count - 1;
+
+    int bandwidth_quality[ABR_BATCH_BLOCK];
+    float next_bitrate[ABR_BATCH_BLOCK];
+
+    for (int start = 0; start < count; start += ABR_BATCH_BLOCK) {
+        int n = (count - start < ABR_BATCH_BLOCK) ? count - start : ABR_BATCH_BLOCK;
+        const float* bw = bandwidth + start;
+        const float* buf = buffer_level + start;
+        const int* cur = current_quality + start;
+        int* out = output + start;
+
+        // Rungs are sorted, so the highest one that fits is the number that fit
+        for (int i = 0; i < n; i++) {
+            bandwidth_quality[i] = 0;
+            next_bitrate[i] = 0.0f;
+        }
+        for (int r = 0; r < l->count; r++) {
+            float rate = l->bitrates[r];
+            int counted = (r >= 1 && r <= actual_max);
+            for (int i = 0; i < n; i++) {
+                bandwidth_quality[i] += (counted && rate <= bw[i] * 0.9f) ? 1 : 0;
+                next_bitrate[i] = (cur[i] + 1 == r) ? rate : next_bitrate[i];
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            int c = cur[i];
+            int fit = bandwidth_quality[i];
+
+            // Low buffer: step down, never above what fits
+            int low = (c > 0) ? c - 1 : 0;
+            low = (low < fit) ? low : fit;
+
+            // High buffer: step up, never above what fits
+            int high = (c < actual_max) ? c + 1 : c;
+            high = (high <= fit) ? high : fit;
+
+            // Medium buffer: step up only with clear headroom, drop to what fits
+            int up = (fit > c) && (bw[i] > next_bitrate[i] * 1.2f);
+            int medium = up ? c + 1 : ((fit < c) ? fit : c);
+
+            int target = (buf[i] < 5.0f) ? low : ((buf[i] > 30.0f) ? high : medium);
+            target = (target < 0) ? 0 : target;
+            target = (target > actual_max) ? actual_max : target;
+            target = (buf[i] < 2.0f) ? 0 : target;
+            out[i] = (bw[i] <= 0.0f) ? 0 : target;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Comprehensive recommendation for many sessions from their estimates
+ * For server-side decisions (CMCD steering, fleet simulation) where the
+ * bandwidth estimates are already at hand: predicted_bandwidth (kbps),
+ * buffer_seconds and current_quality per session; bandwidth_variance, trend
+ * (-1/0/1) and recent_switches may be nullptr (0). Outputs are per session;
+ * out_confidence, out_rebuffer_risk and out_qoe may be nullptr.
+ * Session i gets what get_comprehensive_recommendation_ladder gives for a
+ * history with those estimates. Returns number of sessions decided
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int get_recommendation_batch(AbrLadder* ladder, float* predicted_bandwidth, float* bandwidth_variance, int* trend,
+                             float* buffer_seconds, int* current_quality, int* recent_switches,
+                             int max_quality, float segment_duration, int count, int* out_quality,
+                             float* out_confidence, float* out_rebuffer_risk, float* out_qoe) {
+    if (!predicted_bandwidth || !buffer_seconds || !current_quality || !out_quality || count < 1) return 0;
+
+    const AbrLadder* l = ladder_or_default(ladder);
+    int actual_max = (max_quality < l->count) ? max_quality : l->count - 1;
+
+    float bw[ABR_BATCH_BLOCK];
+    float best_qoe[ABR_BATCH_BLOCK];
+    int best_quality[ABR_BATCH_BLOCK];
+    float risk[ABR_BATCH_BLOCK];
+    float confidence[ABR_BATCH_BLOCK];
+
+    for (int start = 0; start < count; start += ABR_BATCH_BLOCK) {
+        int n = (count - start < ABR_BATCH_BLOCK) ? count - start : ABR_BATCH_BLOCK;
+        const float* buf = buffer_seconds + start;
+        const int* cur = current_quality + start;
+
+        // Trend-adjusted prediction
+        for (int i = 0; i < n; i++) {
+            int t = trend ? trend[start + i] : 0;
+            float scale = (t == -1) ? 0.85f : ((t == 1) ? 1.1f : 1.0f);
+            bw[i] = predicted_bandwidth[start + i] * scale;
+            best_qoe[i] = -1.0f;
+            best_quality[i] = 0;
+        }
+
+        // QoE-maximizing rung, one rung across the block at a time
+        for (int q = 0; q <= actual_max; q++) {
+            float kbits = ladder_segment_kbits(l, q, -1, segment_duration);
+            float score = ladder_quality_score(l, q);
+            for (int i = 0; i < n; i++) {
+                float p = rebuffer_probability_select(buf[i], kbits / bw[i], segment_duration);
+                float switch_penalty = (q != cur[i]) ? 1.0f : 0.0f;
+                float qoe = clamp_qoe(score - p * 0.5f - switch_penalty * 0.1f);
+                int better = qoe > best_qoe[i];
+                best_qoe[i] = better ? qoe : best_qoe[i];
+                best_quality[i] += better * (q - best_quality[i]);   // blend, not a branch
+            }
+        }
+
+        // Oscillation guard, then score the chosen rung
+        for (int i = 0; i < n; i++) {
+            int switches = recent_switches ? recent_switches[start + i] : 0;
+            int c = cur[i];
+            int q = best_quality[i];
+            int hold = (switches >= SWITCH_HISTORY_LIMIT) && (q - c == 1 || c - q == 1);
+            q = hold ? c : q;
+
+            // A held current_quality off the ladder scores 0, as in qoe_on_ladder
+            int on_ladder = (q >= 0 && q < l->count);
+            int rung = (q < 0) ? 0 : ((q < l->count) ? q : l->count - 1);
+            risk[i] = rebuffer_probability_select(buf[i], l->bitrates[rung] * segment_duration / bw[i],
+                                                  segment_duration);
+            float qoe = clamp_qoe(ladder_quality_score(l, q) - risk[i] * 0.5f - ((q != c) ? 1.0f : 0.0f) * 0.1f);
+            best_qoe[i] = on_ladder ? qoe : 0.0f;
+            best_quality[i] = q;
+
+            float variance = bandwidth_variance ? bandwidth_variance[start + i] : 0.0f;
+            float spread = sqrtf(variance) / bw[i];
+            confidence[i] = 1.0f - ((spread < 1.0f) ? spread : 1.0f);
+        }
+
+        memcpy(out_quality + start, best_quality, n * sizeof(int));
+        if (out_confidence) memcpy(out_confidence + start, confidence, n * sizeof(float));
+        if (out_rebuffer_risk) memcpy(out_rebuffer_risk + start, risk, n * sizeof(float));
+        if (out_qoe) memcpy(out_qoe + start, best_qoe, n * sizeof(float));
+    }
+
+    return count;
+}
+
+// ============================================================================
+// PREFETCH PREDICTION
+// ============================================================================
+
+// Bandwidth the player may have estimated: equal-weight quantiles of a
+// log-normal around the edge's replay of its estimate (standard normal at (i + 0.5) / 9)
+static const int PREFETCH_QUANTILES = 9;
+static const float PREFETCH_Z[PREFETCH_QUANTILES] = {-1.5932f, -0.9674f, -0.5895f, -0.2822f, 0.0f,
+                                                     0.2822f, 0.5895f, 0.9674f, 1.5932f};
+static const float PREFETCH_DEFAULT_CV = 0.15f; // edge vs player throughput view, std / mean
+
+/**
+ * Distribution over the next (rendition, segment) each session will request
+ * For edge prefetch: per session, its last request (rendition, segment),
+ * buffer (CMCD bl) and the throughput of its recent requests
+ * (throughput_history: count * history_length kbps, oldest first, e.g.
+ * CMCD mtp or size / time at the edge). The player's estimate is replayed
+ * with predict_bandwidth and its select_quality_stable decision evaluated
+ * across the uncertainty of that replay (throughput_cv, std / mean; nullptr:
+ * 0.15), so the probabilities are the share of plausible estimates that
+ * lead to each rendition of segment last + 1. recent_switches may be nullptr.
+ * A last_rendition outside the ladder (e.g. a bogus CMCD value) is
+ * predicted as a startup request.
+ * Outputs hold top_k candidates per session (count * top_k entries), most
+ * likely first; unused slots get rendition -1 and probability 0.
+ * Returns number of sessions predicted
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int predict_next_requests_batch(AbrLadder* ladder, int* last_rendition, int* last_segment, float* buffer_seconds,
+                                float* throughput_history, int history_length, float* throughput_cv,
+                                int* recent_switches, int count, int top_k, int* out_rendition, int* out_segment,
+                                float* out_probability) {
+    if (!last_rendition || !last_segment || !buffer_seconds || !throughput_history || history_length < 1 ||
+        count < 1 || top_k < 1 ||
+        !out_rendition || !out_segment || !out_probability) {
+        return 0;
+    }
+
+    const AbrLadder* l = ladder_or_default(ladder);
+    int top = l->count - 1;
+
+    for (int i = 0; i < count; i++) {
+        int current = (last_rendition[i] >= 0 && last_rendition[i] <= top) ? last_rendition[i] : -1;
+        float cv = throughput_cv ? throughput_cv[i] : PREFETCH_DEFAULT_CV;
+        float sigma = sqrtf(logf(1.0f + cv * cv));
+        int switches = recent_switches ? recent_switches[i] : 0;
+        float estimate = predict_bandwidth(throughput_history + (size_t)i * history_length, history_length);
+
+        // Decision histogram over the bandwidth quantiles (mean-preserving)
+        float mass[MAX_LADDER_RUNGS] = {0};
+        for (int z = 0; z < PREFETCH_QUANTILES; z++) {
+            float bandwidth = estimate * expf(sigma * PREFETCH_Z[z] - 0.5f * sigma * sigma);
+            int q = select_level_on_ladder(l, bandwidth, buffer_seconds[i], current, top);
+            q = hold_if_oscillating(q, current, switches);
+            mass[(q < 0) ? 0 : (q > top ? top : q)] += 1.0f / PREFETCH_QUANTILES;
+        }
+
+        // Top k by probability (ties: lower rung first)
+        int* rendition = out_rendition + (size_t)i * top_k;
+        int* segment = out_segment + (size_t)i * top_k;
+        float* probability = out_probability + (size_t)i * top_k;
+        for (int k = 0; k < top_k; k++) {
+            int best = -1;
+            for (int q = 0; q <= top; q++) {
+                if (mass[q] > 0.0f && (best < 0 || mass[q] > mass[best])) best = q;
+            }
+            rendition[k] = best;
+            segment[k] = (best >= 0) ? last_segment[i] + 1 : -1;
+            probability[k] = (best >= 0) ? mass[best] : 0.0f;
+            if (best >= 0) mass[best] = 0.0f;
+        }
+    }
+
+    return count;
+}
+
+// ============================================================================
+// SESSION ESTIMATOR (incremental, O(1) per segment)
+// ============================================================================
+
+static const int DEFAULT_SESSION_WINDOW = 20;   // samples, as the player's bandwidth history
+
+/**
+ * Per-session state for get_comprehensive_recommendation without resending
+ * the history: the last `window` throughput samples live in a ring, and
+ * the EWMA, mean/variance (Welford) and regression sums slide with it, so
+ * each download and each recommendation costs O(1) instead of O(window).
+ * Decisions run over the session's ladder, which is borrowed (one ladder
+ * can serve every session of a title and must outlive them).
+ */
+struct AbrSession {
+    const AbrLadder* ladder;
+    float* samples;             // ring of throughput samples (kbps)
+    int window;
+    int head;                   // oldest sample
+    int count;
+    double ewma_sum;            // sum of (1 - alpha)^(count-1-i) * x_i, oldest i = 0
+    double decay_oldest;        // (1 - alpha)^(count-1)
+    double mean;                // Welford over the window
+    double m2;
+    double sum_y;               // regression sums over x = 0..count-1
+    double sum_xy;
+    int qualities[SWITCH_HISTORY_WINDOW];   // ring of recent quality levels
+    int quality_head;
+    int quality_count;
+    int current_quality;
+    int next_segment;           // index of the segment the recommendation is for
+    int has_chunk;              // low-latency chunk timing (abr_session_on_chunk)
+    double chunk_last_byte_ms;
+    double pending_bytes;       // active transfer pooled toward the next sample
+    double pending_ms;
+};
+
+/**
+ * Create a session estimator over the last `window` segments (<= 0: 20)
+ * ladder: renditions actually published (nullptr: default ladder)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+AbrSession* create_abr_session(int window, AbrLadder* ladder) {
+    if (window <= 0) window = DEFAULT_SESSION_WINDOW;
+
+    AbrSession* session = (AbrSession*)calloc(1, sizeof(AbrSession));
+    if (!session) return nullptr;
+
+    session->samples = (float*)malloc(window * sizeof(float));
+    if (!session->samples) {
+        free(session);
+        return nullptr;
+    }
+    session->window = window;
+    session->ladder = ladder_or_default(ladder);
+    return session;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_abr_session(AbrSession* session) {
+    if (!session) return;
+    free(session->samples);
+    free(session);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void reset_abr_session(AbrSession* session) {
+    if (!session) return;
+    float* samples = session->samples;
+    int window = session->window;
+    const AbrLadder* ladder = session->ladder;
+    memset(session, 0, sizeof(AbrSession));
+    session->samples = samples;
+    session->window = window;
+    session->ladder = ladder;
+}
+
+/**
+ * Drop the oldest sample from every running statistic
+ */
+static void session_pop_oldest(AbrSession* s) {
+    double x = s->samples[s->head];
+    s->head = (s->head + 1) % s->window;
+
+    s->ewma_sum -= s->decay_oldest * x;
+    s->decay_oldest /= (1.0 - EWMA_ALPHA);
+
+    // Remaining samples shift down one regression slot (the oldest sat at x = 0)
+    s->sum_y -= x;
+    s->sum_xy -= s->sum_y;
+
+    int n = --s->count;
+    if (n == 0) {
+        s->mean = 0.0;
+        s->m2 = 0.0;
+        s->decay_oldest = 0.0;
+        s->ewma_sum = 0.0;
+        return;
+    }
+    double d = x - s->mean;
+    s->mean -= d / n;
+    s->m2 -= d * (x - s->mean);
+    if (s->m2 < 0.0) s->m2 = 0.0;
+}
+
+static void session_push(AbrSession* s, double x) {
+    if (s->count == s->window) session_pop_oldest(s);
+
+    s->samples[(s->head + s->count) % s->window] = (float)x;
+    s->ewma_sum = (1.0 - EWMA_ALPHA) * s->ewma_sum + x;
+    s->decay_oldest = (s->count == 0) ? 1.0 : s->decay_oldest * (1.0 - EWMA_ALPHA);
+
+    s->sum_xy += s->count * x;
+    s->sum_y += x;
+
+    int n = ++s->count;
+    double d = x - s->mean;
+    s->mean += d / n;
+    s->m2 += d * (x - s->mean);
+}
+
+/**
+ * Record a finished segment download
+ * Returns its throughput in kbps, or 0 for an unusable sample (not recorded)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float abr_session_on_segment_downloaded(AbrSession* session, double bytes, double ms) {
+    if (!session || bytes <= 0.0 || ms <= 0.0) return 0.0f;
+
+    double kbps = bytes * 8.0 / ms;
+    session_push(session, kbps);
+    session->next_segment++;
+    return (float)kbps;
+}
+
+/**
+ * Set the index of the next segment to fetch (after a seek or a live join);
+ * downloads advance it by one
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+void abr_session_seek(AbrSession* session, int segment) {
+    if (session) session->next_segment = segment;
+}
+
+/**
+ * Record the quality level now playing (feeds the oscillation guard)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+void abr_session_set_quality(AbrSession* session, int quality) {
+    if (!session) return;
+
+    int slot = (session->quality_head + session->quality_count) % SWITCH_HISTORY_WINDOW;
+    if (session->quality_count == SWITCH_HISTORY_WINDOW) {
+        session->quality_head = (session->quality_head + 1) % SWITCH_HISTORY_WINDOW;
+    } else {
+        session->quality_count++;
+    }
+    session->qualities[slot] = quality;
+    session->current_quality = quality;
+}
+
+/**
+ * Windowed estimates; match the array functions over the same samples
+ * (up to their float accumulation)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float abr_session_predicted_bandwidth(AbrSession* session) {
+    if (!session || session->count < 1) return 0.0f;
+    double oldest = session->samples[session->head];
+    double ewma = EWMA_ALPHA * session->ewma_sum + session->decay_oldest * (1.0 - EWMA_ALPHA) * oldest;
+    return (float)ewma * BANDWIDTH_SAFETY;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float abr_session_bandwidth_variance(AbrSession* session) {
+    if (!session || session->count < 2) return 0.0f;
+    return (float)(session->m2 / (session->count - 1));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int abr_session_trend(AbrSession* session) {
+    if (!session || session->count < 3) return 0;
+
+    double n = session->count;
+    double sum_x = n * (n - 1.0) / 2.0;
+    double sum_xx = (n - 1.0) * n * (2.0 * n - 1.0) / 6.0;
+    double slope = (n * session->sum_xy - sum_x * session->sum_y) / (n * sum_xx - sum_x * sum_x);
+    return classify_trend((float)slope, (float)(session->sum_y / n));
+}
+
+/**
+ * Recommendation from the session state in O(1)
+ * Same model as get_comprehensive_recommendation (for the current quality
+ * set with abr_session_set_quality) over the session's ladder, using the
+ * next segment's real size when the ladder has sizes, plus the
+ * select_quality_stable oscillation guard over the recent quality levels.
+ * result: [quality_level, confidence, rebuffer_risk, estimated_qoe]
+ * Returns 1, or 0 before the first download
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int abr_session_recommend(AbrSession* session, float buffer_seconds, float segment_duration,
+                          int max_quality, float* result) {
+    if (!session || !result || session->count < 1) return 0;
+
+    int current = session->current_quality;
+    int recent_switches = 0;
+    if (session->quality_count == SWITCH_HISTORY_WINDOW) {
+        for (int i = 0; i < SWITCH_HISTORY_WINDOW; i++) {
+            if (session->qualities[i] != current) recent_switches++;
+        }
+    }
+
+    recommend_from_estimates(session->ladder, abr_session_predicted_bandwidth(session),
+                             abr_session_bandwidth_variance(session), abr_session_trend(session),
+                             buffer_seconds, segment_duration, session->next_segment,
+                             current, max_quality, recent_switches, result);
+    return 1;
+}
+
+// ============================================================================
+// LOW-LATENCY STREAMING (chunked transfer, LL-HLS / CMAF)
+// ============================================================================
+
+// Chunk throughput filtering
+static const double LL_IDLE_GAP_MS = 5.0;       // longer gaps between chunks are encoder waits
+static const double LL_MIN_CHUNK_MS = 1.0;      // shorter transfers are below timer resolution
+static const double LL_MIN_SAMPLE_MS = 50.0;    // active transfer time per throughput sample
+
+// Decisions under a few seconds of buffer
+static const float LL_CRITICAL_BUFFER = 0.5f;   // seconds: step down, slow playback
+static const float LL_UPSWITCH_BUFFER = 1.0f;   // seconds: step up, allow catch-up
+static const float LL_MAX_RATE_CHANGE = 0.1f;   // playback rate stays within 1 +/- this
+static const float LL_LATENCY_TOLERANCE = 0.05f;    // seconds
+
+/**
+ * Record one chunk of a chunked-transfer download (times in ms, any origin)
+ * Only time spent transferring counts: the gap before a chunk is added when
+ * it is short enough to be network time (back-to-back chunks) and dropped
+ * when it is the player waiting for the encoder, which is what collapses
+ * whole-segment throughput toward the encoding bitrate. Active time is
+ * pooled across chunks until LL_MIN_SAMPLE_MS, then one sample is recorded.
+ * Returns the recorded throughput in kbps, or 0 while pooling
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float abr_session_on_chunk(AbrSession* session, double first_byte_ms, double last_byte_ms, double bytes) {
+    if (!session || bytes <= 0.0 || last_byte_ms < first_byte_ms) return 0.0f;
+
+    double active = last_byte_ms - first_byte_ms;
+    double gap = first_byte_ms - session->chunk_last_byte_ms;
+    if (session->has_chunk && gap >= 0.0 && gap <= LL_IDLE_GAP_MS) active += gap;
+
+    session->has_chunk = 1;
+    session->chunk_last_byte_ms = last_byte_ms;
+    if (active < LL_MIN_CHUNK_MS) return 0.0f;
+
+    session->pending_bytes += bytes;
+    session->pending_ms += active;
+    if (session->pending_ms < LL_MIN_SAMPLE_MS) return 0.0f;
+
+    double kbps = session->pending_bytes * 8.0 / session->pending_ms;
+    session_push(session, kbps);
+    session->pending_bytes = 0.0;
+    session->pending_ms = 0.0;
+    return (float)kbps;
+}
+
+/**
+ * Quality and playback rate for a live stream with a small buffer
+ * The BBA thresholds of select_quality_level (2/5/30 s) never allow a step
+ * up below 3 s of buffer; here the rung follows the chunk throughput,
+ * stepping up one rung at a time once LL_UPSWITCH_BUFFER is buffered.
+ * Playback slows as the buffer nears empty and otherwise steers latency
+ * toward target_latency_seconds (<= 0: no catch-up) with a sigmoid.
+ * result: [quality_level, playback_rate]; returns 1, or 0 before any sample
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int abr_session_recommend_low_latency(AbrSession* session, float buffer_seconds, float latency_seconds,
+                                      float target_latency_seconds, int max_quality, float* result) {
+    if (!session || !result || session->count < 1) return 0;
+
+    const AbrLadder* ladder = session->ladder;
+    int top = (max_quality >= 0 && max_quality < ladder->count) ? max_quality : ladder->count - 1;
+    float bandwidth = abr_session_predicted_bandwidth(session);
+
+    int fit = 0;
+    for (int q = 1; q <= top; q++) {
+        if (ladder->bitrates[q] <= bandwidth) fit = q;
+    }
+
+    int current = (session->quality_count > 0) ? session->current_quality : fit;
+    int quality;
+    if (buffer_seconds < LL_CRITICAL_BUFFER) {
+        quality = (current - 1 < fit) ? current - 1 : fit;
+    } else if (fit > current) {
+        quality = (buffer_seconds >= LL_UPSWITCH_BUFFER) ? current + 1 : current;
+    } else {
+        quality = fit;
+    }
+    if (quality < 0) quality = 0;
+    if (quality > top) quality = top;
+
+    float rate = 1.0f;
+    float drift = latency_seconds - target_latency_seconds;
+    if (buffer_seconds < LL_CRITICAL_BUFFER) {
+        rate = 1.0f - LL_MAX_RATE_CHANGE * (1.0f - fmaxf(buffer_seconds, 0.0f) / LL_CRITICAL_BUFFER);
+    } else if (target_latency_seconds > 0.0f && fabsf(drift) > LL_LATENCY_TOLERANCE) {
+        rate = 1.0f - LL_MAX_RATE_CHANGE + 2.0f * LL_MAX_RATE_CHANGE / (1.0f + expf(-5.0f * drift));
+        if (buffer_seconds < LL_UPSWITCH_BUFFER && rate > 1.0f) rate = 1.0f;  // no catch-up on a thin buffer
+    }
+
+    result[0] = (float)quality;
+    result[1] = rate;
+    return 1;
+}
+
+// ============================================================================
+// MODEL PREDICTIVE CONTROL (FastMPC)
+// ============================================================================
+
+// Lookahead QoE: sum of quality scores minus switch and stall costs
+static const int MPC_HORIZON = 5;                   // segments
+static const float MPC_SWITCH_WEIGHT = 1.0f;        // per unit change of quality score
+static const float MPC_REBUFFER_WEIGHT = 1.0f;      // per second of stall (one top-quality segment)
+static const float MPC_DEFAULT_MAX_BUFFER = 60.0f;  // seconds
+
+// Decision table resolution (buffer linear, throughput log-spaced)
+static const int MPC_BUFFER_BINS = 64;
+static const int MPC_THROUGHPUT_BINS = 64;
+static const int MPC_MAX_BINS = 4096;           // per axis, for tables loaded from data
+static const float MPC_THROUGHPUT_SPAN = 4.0f;      // table covers [lowest / 4, highest * 4] kbps
+static const uint32_t MPC_TABLE_MAGIC = 0x3143504D; // "MPC1"
+
+struct MpcSearch {
+    const AbrLadder* ladder;
+    int rungs;                  // candidate rungs 0..rungs-1
+    float throughput;           // kbps, assumed constant over the horizon
+    float segment_duration;
+    int segment;                // first segment index (< 0: sizes from bitrates)
+    float max_buffer;
+    float best_qoe;
+    int best_first;
+};
+
+/**
+ * Depth-first search over every rung sequence of the horizon
+ * A branch is cut when even top quality with no costs for the remaining
+ * steps cannot beat the best plan found so far.
+ */
+static void mpc_search(MpcSearch* m, int depth, float buffer, int prev, float qoe, int first) {
+    if (depth == MPC_HORIZON) {
+        if (qoe > m->best_qoe) {
+            m->best_qoe = qoe;
+            m->best_first = first;
+        }
+        return;
+    }
+    if (qoe + (float)(MPC_HORIZON - depth) <= m->best_qoe) return;
+
+    int segment = (m->segment >= 0) ? m->segment + depth : -1;
+    float prev_score = (prev >= 0) ? ladder_quality_score(m->ladder, prev) : -1.0f;
+
+    // Highest rungs first, so good plans are found early and prune more
+    for (int q = m->rungs - 1; q >= 0; q--) {
+        float download = ladder_segment_kbits(m->ladder, q, segment, m->segment_duration) / m->throughput;
+        float stall = (download > buffer) ? download - buffer : 0.0f;
+        float next = fmaxf(buffer - download, 0.0f) + m->segment_duration;
+        if (next > m->max_buffer) next = m->max_buffer;   // player idles while full
+
+        float score = ladder_quality_score(m->ladder, q);
+        float switch_cost = (prev >= 0) ? fabsf(score - prev_score) : 0.0f;
+        float step = score - MPC_SWITCH_WEIGHT * switch_cost - MPC_REBUFFER_WEIGHT * stall;
+
+        mpc_search(m, depth + 1, next, q, qoe + step, (depth == 0) ? q : first);
+    }
+}
+
+static int mpc_decide(const AbrLadder* ladder, float throughput, float buffer_seconds, int prev_quality,
+                      float segment_duration, int segment, int max_quality, float max_buffer) {
+    if (throughput <= 0.0f || segment_duration <= 0.0f) return 0;
+
+    MpcSearch m;
+    m.ladder = ladder;
+    m.rungs = (max_quality >= 0 && max_quality < ladder->count) ? max_quality + 1 : ladder->count;
+    m.throughput = throughput;
+    m.segment_duration = segment_duration;
+    m.segment = segment;
+    m.max_buffer = (max_buffer > 0.0f) ? max_buffer : MPC_DEFAULT_MAX_BUFFER;
+    m.best_qoe = -INFINITY;
+    m.best_first = 0;
+
+    if (prev_quality >= m.rungs) prev_quality = m.rungs - 1;
+    mpc_search(&m, 0, fmaxf(buffer_seconds, 0.0f), prev_quality, 0.0f, 0);
+    return m.best_first;
+}
+
+/**
+ * Exact MPC decision: first rung of the best plan over MPC_HORIZON segments
+ * throughput_kbps: predicted throughput (e.g. predict_bandwidth); prev_quality
+ * < 0 at startup (no switch cost); segment >= 0 uses the ladder's real sizes.
+ * Cost grows as rungs^5 in the worst case; use the table for hot paths
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_quality_mpc(AbrLadder* ladder, float throughput_kbps, float buffer_seconds, int prev_quality,
+                       float segment_duration, int segment, int max_quality) {
+    return mpc_decide(ladder_or_default(ladder), throughput_kbps, buffer_seconds, prev_quality,
+                      segment_duration, segment, max_quality, MPC_DEFAULT_MAX_BUFFER);
+}
+
+/**
+ * Precomputed FastMPC decisions for one ladder and segment duration
+ * One contiguous blob (header + cells) so a table generated offline can be
+ * shipped as bytes and loaded with create_mpc_table_from_data. Cells hold
+ * the decision per (previous rung or startup) x buffer bin x throughput bin.
+ */
+struct MpcTable {
+    uint32_t magic;
+    int rungs;
+    int buffer_bins;
+    int throughput_bins;
+    float segment_duration;
+    float max_buffer;
+    float min_kbps;
+    float max_kbps;
+    uint8_t cells[1];           // (rungs + 1) * buffer_bins * throughput_bins
+};
+
+static inline size_t mpc_table_bytes(int rungs, int buffer_bins, int throughput_bins) {
+    return offsetof(MpcTable, cells) + (size_t)(rungs + 1) * buffer_bins * throughput_bins;
+}
+
+/**
+ * Generate the decision table by solving the MPC problem at every cell center
+ * max_buffer_seconds <= 0 uses 60 s; nullptr for a non-finite segment
+ * duration or max buffer. Takes a few hundred ms for a
+ * six-rung ladder natively, so generate once per ladder (offline or at
+ * startup) and share it across sessions.
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+MpcTable* create_mpc_table(AbrLadder* ladder, float segment_duration, float max_buffer_seconds) {
+    const AbrLadder* l = ladder_or_default(ladder);
+    if (!(segment_duration > 0.0f && segment_duration < INFINITY) || l->count > 255) return nullptr;
+    if (!(max_buffer_seconds < INFINITY)) return nullptr;     // same bounds a loaded table must meet
+    if (max_buffer_seconds <= 0.0f) max_buffer_seconds = MPC_DEFAULT_MAX_BUFFER;
+
+    MpcTable* table = (MpcTable*)malloc(mpc_table_bytes(l->count, MPC_BUFFER_BINS, MPC_THROUGHPUT_BINS));
+    if (!table) return nullptr;
+
+    table->magic = MPC_TABLE_MAGIC;
+    table->rungs = l->count;
+    table->buffer_bins = MPC_BUFFER_BINS;
+    table->throughput_bins = MPC_THROUGHPUT_BINS;
+    table->segment_duration = segment_duration;
+    table->max_buffer = max_buffer_seconds;
+    table->min_kbps = l->bitrates[0] / MPC_THROUGHPUT_SPAN;
+    table->max_kbps = l->bitrates[l->count - 1] * MPC_THROUGHPUT_SPAN;
+
+    float log_span = logf(table->max_kbps / table->min_kbps);
+    uint8_t* cell = table->cells;
+
+    for (int prev = -1; prev < l->count; prev++) {
+        for (int b = 0; b < MPC_BUFFER_BINS; b++) {
+            float buffer = (b + 0.5f) * max_buffer_seconds / MPC_BUFFER_BINS;
+            for (int t = 0; t < MPC_THROUGHPUT_BINS; t++) {
+                float throughput = table->min_kbps * expf(log_span * (t + 0.5f) / MPC_THROUGHPUT_BINS);
+                *cell++ = (uint8_t)mpc_decide(l, throughput, buffer, prev, segment_duration, -1, -1,
+                                              max_buffer_seconds);
+            }
+        }
+    }
+
+    return table;
+}
+
+/**
+ * Load a table from bytes produced by mpc_table_data / mpc_table_size
+ * Returns nullptr when the blob is not a table or is truncated
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+MpcTable* create_mpc_table_from_data(uint8_t* data, int size) {
+    if (!data || size < (int)offsetof(MpcTable, cells)) return nullptr;
+
+    // Bounded dimensions keep mpc_table_bytes within a 32-bit size_t
+    MpcTable header;
+    memcpy(&header, data, offsetof(MpcTable, cells));
+    if (header.magic != MPC_TABLE_MAGIC || header.rungs < 1 || header.rungs > MAX_LADDER_RUNGS ||
+        header.buffer_bins < 1 || header.buffer_bins > MPC_MAX_BINS ||
+        header.throughput_bins < 1 || header.throughput_bins > MPC_MAX_BINS ||
+        !(header.segment_duration > 0.0f) || !(header.max_buffer > 0.0f) || !(header.max_buffer < INFINITY) ||
+        !(header.min_kbps > 0.0f) || !(header.max_kbps > header.min_kbps) || !(header.max_kbps < INFINITY)) {
+        return nullptr;
+    }
+
+    size_t bytes = mpc_table_bytes(header.rungs, header.buffer_bins, header.throughput_bins);
+    if ((size_t)size < bytes) return nullptr;
+
+    // Every decision must name a rung of the table's ladder
+    size_t cell_count = bytes - offsetof(MpcTable, cells);
+    const uint8_t* cells = data + offsetof(MpcTable, cells);
+    for (size_t i = 0; i < cell_count; i++) {
+        if (cells[i] >= header.rungs) return nullptr;
+    }
+
+    MpcTable* table = (MpcTable*)malloc(bytes);
+    if (table) memcpy(table, data, bytes);
+    return table;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_mpc_table(MpcTable* table) {
+    free(table);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint8_t* mpc_table_data(MpcTable* table) {
+    return (uint8_t*)table;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int mpc_table_size(MpcTable* table) {
+    return table ? (int)mpc_table_bytes(table->rungs, table->buffer_bins, table->throughput_bins) : 0;
+}
+
+/**
+ * FastMPC decision by table lookup (nearest cell; inputs outside the table
+ * range clamp to its edge). prev_quality < 0 selects the startup row
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int mpc_table_lookup(MpcTable* table, float throughput_kbps, float buffer_seconds, int prev_quality) {
+    if (!table || throughput_kbps <= 0.0f) return 0;
+
+    // Clamp in float first: NaN and out-of-range values must not reach the int conversion
+    float fb = buffer_seconds / table->max_buffer * table->buffer_bins;
+    int b = (fb >= 0.0f) ? (fb < table->buffer_bins ? (int)fb : table->buffer_bins - 1) : 0;
+
+    float ft = logf(throughput_kbps / table->min_kbps) / logf(table->max_kbps / table->min_kbps) *
+               table->throughput_bins;
+    int t = (ft >= 0.0f) ? (ft < table->throughput_bins ? (int)ft : table->throughput_bins - 1) : 0;
+
+    int row = (prev_quality < 0) ? 0 : (prev_quality >= table->rungs ? table->rungs : prev_quality + 1);
+    return table->cells[((size_t)row * table->buffer_bins + b) * table->throughput_bins + t];
+}
+
+/**
+ * FastMPC decision for a session: its predicted bandwidth and current
+ * quality against a table built for the session's ladder
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int abr_session_recommend_mpc(AbrSession* session, MpcTable* table, float buffer_seconds) {
+    if (!session || !table || session->count < 1) return 0;
+    int prev = (session->quality_count > 0) ? session->current_quality : -1;
+    return mpc_table_lookup(table, abr_session_predicted_bandwidth(session), buffer_seconds, prev);
+}
+
+// ============================================================================
+// BUFFER-BASED UTILITY MAXIMIZATION (BOLA, VBR-aware)
+// ============================================================================
+
+// Buffer the utility curve spans: at least this plus a little per rung
+static const float BOLA_MIN_BUFFER = 10.0f;         // seconds
+static const float BOLA_BUFFER_PER_RUNG = 2.0f;     // seconds
+static const float BOLA_BUFFER_SAFETY = 0.5f;       // share of the buffer one download may use
+
+/**
+ * Highest rung (<= top) whose segment downloads within its own duration
+ */
+static int bola_sustainable(const AbrLadder* ladder, float throughput, float segment_duration, int segment, int top) {
+    int q = 0;
+    for (int i = 1; i <= top; i++) {
+        if (ladder_segment_kbits(ladder, i, segment, segment_duration) / throughput <= segment_duration) q = i;
+    }
+    return q;
+}
+
+static int bola_on_ladder(const AbrLadder* ladder, float buffer_seconds, float throughput, int prev_quality,
+                          float segment_duration, int segment, float buffer_target, int max_quality) {
+    int top = (max_quality >= 0 && max_quality < ladder->count) ? max_quality : ladder->count - 1;
+    if (top < 1 || segment_duration <= 0.0f) return 0;
+
+    // Startup: nothing buffered to trade against, follow throughput
+    if (prev_quality < 0) {
+        return (throughput > 0.0f) ? bola_sustainable(ladder, throughput, segment_duration, segment, top) : 0;
+    }
+
+    // Utilities from nominal bitrates (ln(r / r0) + 1), so a rung's value
+    // does not swing with scene complexity; gp and V place the lowest rung
+    // at BOLA_MIN_BUFFER and the highest at the buffer target.
+    float buffer_time = fmaxf(buffer_target, BOLA_MIN_BUFFER + BOLA_BUFFER_PER_RUNG * ladder->count);
+    float top_utility = logf(ladder->bitrates[ladder->count - 1] / ladder->bitrates[0]) + 1.0f;
+    float gp = (top_utility - 1.0f) / (buffer_time / BOLA_MIN_BUFFER - 1.0f);
+    float vp = BOLA_MIN_BUFFER / gp;
+
+    // Objective per kbit of this segment's real size (VBR-aware)
+    int best = 0;
+    float best_score = -INFINITY;
+    for (int q = 0; q <= top; q++) {
+        float utility = logf(ladder->bitrates[q] / ladder->bitrates[0]) + 1.0f;
+        float score = (vp * (utility + gp) - buffer_seconds) / ladder_segment_kbits(ladder, q, segment, segment_duration);
+        if (score >= best_score) {
+            best_score = score;
+            best = q;
+        }
+    }
+
+    // Step up only as far as this segment can be sustained (BOLA-O)
+    if (best > prev_quality && throughput > 0.0f) {
+        int sustainable = bola_sustainable(ladder, throughput, segment_duration, segment, best);
+        best = (sustainable > prev_quality) ? sustainable : prev_quality;
+    }
+
+    // A large (complex) segment must not drain the buffer: cap by its real size
+    if (throughput > 0.0f) {
+        float budget = throughput * buffer_seconds * BOLA_BUFFER_SAFETY;
+        while (best > 0 && ladder_segment_kbits(ladder, best, segment, segment_duration) > budget) best--;
+    }
+    return best;
+}
+
+/**
+ * BOLA quality selection using each segment's real size
+ * throughput_kbps: predicted throughput (0 = unknown); prev_quality < 0 at
+ * startup; segment >= 0 uses the ladder's per-segment sizes so a complex
+ * (large) segment is fetched at a lower rung than its neighbours.
+ * buffer_target: buffer level at which the top rung is reached (seconds)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_quality_bola(AbrLadder* ladder, float buffer_seconds, float throughput_kbps, int prev_quality,
+                        float segment_duration, int segment, float buffer_target, int max_quality) {
+    return bola_on_ladder(ladder_or_default(ladder), buffer_seconds, throughput_kbps, prev_quality,
+                          segment_duration, segment, buffer_target, max_quality);
+}
+
+/**
+ * BOLA decision for a session's next segment (see select_quality_bola)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int abr_session_recommend_bola(AbrSession* session, float buffer_seconds, float segment_duration,
+                               float buffer_target, int max_quality) {
+    if (!session) return 0;
+    int prev = (session->quality_count > 0) ? session->current_quality : -1;
+    float throughput = (session->count > 0) ? abr_session_predicted_bandwidth(session) : 0.0f;
+    return bola_on_ladder(session->ladder, buffer_seconds, throughput, prev, segment_duration,
+                          session->next_segment, buffer_target, max_quality);
+}
+
+// ============================================================================
+// TRACE SIMULATION
+// ============================================================================
+
+// Selection policies the simulator can drive
+static const int ABR_POLICY_LEVEL = 0;          // select_quality_level (BBA + throughput)
+static const int ABR_POLICY_STABLE = 1;         // select_quality_stable
+static const int ABR_POLICY_MAX_QOE = 2;        // select_quality_maximize_qoe
+static const int ABR_POLICY_SESSION = 3;        // abr_session_recommend
+static const int ABR_POLICY_MPC = 4;            // select_quality_mpc (exact)
+static const int ABR_POLICY_FAST_MPC = 5;       // mpc_table_lookup
+static const int ABR_POLICY_BOLA = 6;           // select_quality_bola (buffer target = buffer cap)
+static const int ABR_POLICY_COUNT = 7;
+
+// Player model
+static const double SIM_LINK_RTT = 0.08;        // seconds per segment request
+static const float SIM_REBUFFER_PENALTY = 4.3f; // QoE per stall second (linear QoE, Mbps units)
+
+/**
+ * Outcome of one simulated playback (all fields 4 bytes, JS-readable)
+ * qoe is the linear QoE per segment: bitrate (Mbps) minus 4.3 per stall
+ * second minus the bitrate change (Mbps) from the previous segment.
+ * The startup download is reported separately and is not a stall.
+ */
+struct AbrSimResult {
+    int segments;
+    int switches;
+    int rebuffer_events;
+    float avg_bitrate_kbps;
+    float rebuffer_seconds;
+    float startup_seconds;
+    float avg_switch_kbps;      // mean bitrate change per switch
+    float qoe;
+};
+
+/**
+ * Position in a throughput trace; the trace repeats when exhausted
+ * Sample i holds from times[i] to times[i + 1]; the last one for the
+ * average step of the trace.
+ */
+struct TraceCursor {
+    const float* times;
+    const float* kbps;
+    int length;
+    int index;
+    double offset;              // start of the current repetition
+    double last_span;
+    double clock;
+};
+
+static inline double trace_sample_end(const TraceCursor* c) {
+    double end = (c->index + 1 < c->length) ? c->times[c->index + 1] : c->times[c->index] + c->last_span;
+    return c->offset + end;
+}
+
+static inline void trace_next_sample(TraceCursor* c) {
+    if (++c->index == c->length) {
+        c->offset += (double)c->times[c->length - 1] + c->last_span - c->times[0];
+        c->index = 0;
+    }
+}
+
+static void trace_idle(TraceCursor* c, double seconds) {
+    double until = c->clock + seconds;
+    while (trace_sample_end(c) <= until) trace_next_sample(c);
+    c->clock = until;
+}
+
+/**
+ * Download kbits starting at the cursor; returns seconds taken
+ */
+static double trace_download(TraceCursor* c, double kbits) {
+    double start = c->clock;
+    trace_idle(c, SIM_LINK_RTT);
+
+    while (kbits > 0.0) {
+        double end = trace_sample_end(c);
+        double capacity = (double)c->kbps[c->index] * (end - c->clock);
+        if (capacity >= kbits) {
+            c->clock += kbits / c->kbps[c->index];
+            break;
+        }
+        kbits -= (capacity > 0.0) ? capacity : 0.0;
+        c->clock = end;
+        trace_next_sample(c);
+    }
+
+    return c->clock - start;
+}
+
+/**
+ * One policy decision from the session's estimates
+ */
+static int sim_select(int policy, const AbrLadder* ladder, AbrSession* session, MpcTable* table,
+                      const int* history, int history_length, float buffer, float segment_duration, int segment,
+                      float max_buffer) {
+    int top = ladder->count - 1;
+    int current = session->current_quality;
+    float bandwidth = abr_session_predicted_bandwidth(session);
+
+    switch (policy) {
+    case ABR_POLICY_LEVEL:
+        return select_level_on_ladder(ladder, bandwidth, buffer, current, top);
+    case ABR_POLICY_STABLE:
+        return select_stable_on_ladder(ladder, bandwidth, buffer, current, top, history, history_length);
+    case ABR_POLICY_MAX_QOE:
+        return select_max_qoe_on_ladder(ladder, bandwidth, buffer, segment_duration, segment, current, top);
+    case ABR_POLICY_SESSION: {
+        // No throughput recorded yet (e.g. zero-byte segments): keep the current rung
+        float result[4];
+        if (!abr_session_recommend(session, buffer, segment_duration, top, result)) return current;
+        return (int)result[0];
+    }
+    case ABR_POLICY_MPC:
+        return mpc_decide(ladder, bandwidth, buffer, current, segment_duration, segment, top, MPC_DEFAULT_MAX_BUFFER);
+    case ABR_POLICY_FAST_MPC:
+        return mpc_table_lookup(table, bandwidth, buffer, current);
+    case ABR_POLICY_BOLA:
+        return bola_on_ladder(ladder, buffer, bandwidth, current, segment_duration, segment, max_buffer, top);
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Replay a throughput trace against a ladder with one selection policy
+ * trace_seconds / trace_kbps: trace_length samples (finite timestamps, strictly
+ * ascending), looped if playback outlasts them. segment_count segments of
+ * segment_duration are fetched back to back (using the ladder's segment
+ * sizes when set), pausing while the buffer is at max_buffer_seconds
+ * (<= 0: 60). table is required for ABR_POLICY_FAST_MPC only.
+ * The first segment is fetched at the lowest rung. Returns 1, 0 on bad input
+ * (including out-of-order timestamps or no positive throughput, either of
+ * which would keep the replay from ever finishing a download)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int simulate_abr_trace(AbrLadder* ladder, float* trace_seconds, float* trace_kbps, int trace_length,
+                       int segment_count, float segment_duration, float max_buffer_seconds, int policy,
+                       MpcTable* table, AbrSimResult* result) {
+    if (!trace_seconds || !trace_kbps || trace_length < 1 || segment_count < 1 || segment_duration <= 0.0f ||
+        policy < 0 || policy >= ABR_POLICY_COUNT || (policy == ABR_POLICY_FAST_MPC && !table) || !result) {
+        return 0;
+    }
+
+    double volume = 0.0;
+    for (int i = 0; i < trace_length; i++) {
+        if (!(fabsf(trace_seconds[i]) < INFINITY)) return 0;
+        if (i > 0 && !(trace_seconds[i] > trace_seconds[i - 1])) return 0;   // cursor would never advance
+        volume += (trace_kbps[i] > 0.0f) ? trace_kbps[i] : 0.0f;
+    }
+    if (volume <= 0.0) return 0;   // would never finish a download
+
+    const AbrLadder* l = ladder_or_default(ladder);
+    double max_buffer = (max_buffer_seconds > 0.0f) ? max_buffer_seconds : MPC_DEFAULT_MAX_BUFFER;
+
+    AbrSession* session = create_abr_session(0, ladder);
+    int* history = (int*)malloc(segment_count * sizeof(int));
+    if (!session || !history) {
+        destroy_abr_session(session);
+        free(history);
+        return 0;
+    }
+
+    TraceCursor cursor = {trace_seconds, trace_kbps, trace_length, 0, 0.0, 1.0, trace_seconds[0]};
+    if (trace_length > 1) {
+        cursor.last_span = (trace_seconds[trace_length - 1] - trace_seconds[0]) / (trace_length - 1);
+        if (cursor.last_span <= 0.0) cursor.last_span = 1.0;
+    }
+
+    memset(result, 0, sizeof(AbrSimResult));
+    double buffer = 0.0;
+    double bitrate_sum = 0.0, switch_kbps = 0.0, qoe = 0.0, stall_total = 0.0;
+    int quality = 0;
+
+    for (int s = 0; s < segment_count; s++) {
+        if (s > 0) {
+            quality = sim_select(policy, l, session, table, history, s, (float)buffer, segment_duration, s,
+                                 (float)max_buffer);
+            if (quality < 0) quality = 0;
+            if (quality >= l->count) quality = l->count - 1;
+        }
+
+        // Wait for room in the buffer, playing meanwhile
+        if (buffer + segment_duration > max_buffer) {
+            double wait = buffer + segment_duration - max_buffer;
+            trace_idle(&cursor, wait);
+            buffer -= wait;
+        }
+
+        double kbits = ladder_segment_kbits(l, quality, s, segment_duration);
+        double seconds = trace_download(&cursor, kbits);
+
+        if (s == 0) {
+            result->startup_seconds = (float)seconds;
+        } else {
+            double stall = (seconds > buffer) ? seconds - buffer : 0.0;
+            if (stall > 0.0) result->rebuffer_events++;
+            stall_total += stall;
+            qoe -= SIM_REBUFFER_PENALTY * stall;
+        }
+        buffer = ((seconds < buffer) ? buffer - seconds : 0.0) + segment_duration;
+
+        double bitrate = l->bitrates[quality];
+        bitrate_sum += bitrate;
+        qoe += bitrate / 1000.0;
+        if (s > 0 && quality != history[s - 1]) {
+            double change = fabs(bitrate - l->bitrates[history[s - 1]]);
+            result->switches++;
+            switch_kbps += change;
+            qoe -= change / 1000.0;
+        }
+
+        history[s] = quality;
+        abr_session_on_segment_downloaded(session, kbits * 125.0, seconds * 1000.0);
+        abr_session_set_quality(session, quality);
+    }
+
+    result->segments = segment_count;
+    result->avg_bitrate_kbps = (float)(bitrate_sum / segment_count);
+    result->rebuffer_seconds = (float)stall_total;
+    result->avg_switch_kbps = result->switches ? (float)(switch_kbps / result->switches) : 0.0f;
+    result->qoe = (float)(qoe / segment_count);
+
+    destroy_abr_session(session);
+    free(history);
+    return 1;
+}
+
 // Memory management
 extern "C" EMSCRIPTEN_KEEPALIVE
 void* wasm_malloc(int size) { return malloc(size); }
@@ -0,0 +1,489 @@
+/**
+ * Trace-driven ABR Simulator (native)
+ * Replays throughput traces against a segment manifest with the selection
+ * policies of abr_controller.cpp and reports bitrate, stalls, switches,
+ * QoE and decision throughput per policy.
+ *
+ * Build: g++ -std=c++17 -O3 -pthread abr_simulator.cpp -o abr_simulator
+ *
+ * Usage: abr_simulator [options] <trace file or directory>...
+ *   --manifest FILE          HLS master playlist for the ladder (default ladder otherwise)
+ *   --sizes FILE             segment sizes in bytes: one line per rung in ladder order, or the
+ *                            segment_sizes.json sidecar written by videoWorker.js (its
+ *                            bandwidths and segment duration are used unless --manifest /
+ *                            --segment-duration are given)
+ *   --segments N             segments per playback (default 48)
+ *   --segment-duration S     seconds per segment (default 4, or the sidecar's)
+ *   --max-buffer S           buffer cap in seconds (default 60)
+ *   --policy LIST            comma-separated: level,stable,qoe,session,mpc,fastmpc,bola or all (default)
+ *   --unit mbps|kbps         throughput unit of two-column traces (default mbps)
+ *   --threads N              worker threads (default: every core)
+ *   --per-trace              also print one CSV row per trace and policy
+ *
+ * decisions/s is per core: simulated segments over the time spent in the
+ * simulator, summed across worker threads.
+ *
+ * Traces are text, one sample per line; lines that do not parse are skipped,
+ * and traces whose timestamps do not strictly ascend are skipped whole:
+ *   time throughput          two columns, comma or whitespace separated
+ *                            (the cooked FCC and HSDPA 3G datasets)
+ *   t ms lat lon bytes ms    raw HSDPA 3G logs (throughput = bytes / elapsed)
+ */
+
+#include "abr_controller.cpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// TRACES
+// ============================================================================
+
+static const char* POLICY_NAMES[ABR_POLICY_COUNT] = {"level", "stable", "qoe", "session", "mpc", "fastmpc", "bola"};
+
+struct Trace {
+    std::string path;
+    std::vector<float> seconds;
+    std::vector<float> kbps;
+};
+
+static bool read_file(const char* path, std::string* text) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) text->append(chunk, n);
+    fclose(f);
+    return true;
+}
+
+/**
+ * Parse a trace in either supported layout; returns false when no sample
+ * parses or the timestamps are not strictly ascending
+ */
+static bool load_trace(const std::string& path, float unit_kbps, Trace* trace) {
+    std::string text;
+    if (!read_file(path.c_str(), &text)) return false;
+
+    trace->path = path;
+    double clock = 0.0;
+    const char* p = text.c_str();
+
+    while (*p) {
+        const char* line_end = strchr(p, '\n');
+        if (!line_end) line_end = p + strlen(p);
+
+        double v[6];
+        int fields = 0;
+        const char* q = p;
+        while (fields < 6 && q < line_end) {
+            while (q < line_end && (*q == ' ' || *q == '\t' || *q == ',' || *q == ';' || *q == '\r')) q++;
+            if (q >= line_end) break;
+            char* next;
+            v[fields] = strtod(q, &next);
+            if (next == q) {
+                fields = -1;    // header or comment
+                break;
+            }
+            fields++;
+            q = next;
+        }
+
+        if (fields == 6 && v[5] > 0.0) {
+            // Raw HSDPA log: bytes over elapsed ms
+            trace->seconds.push_back((float)clock);
+            trace->kbps.push_back((float)(v[4] * 8.0 / v[5]));
+            clock += v[5] / 1000.0;
+        } else if (fields == 2) {
+            trace->seconds.push_back((float)v[0]);
+            trace->kbps.push_back((float)(v[1] * unit_kbps));
+        }
+
+        p = *line_end ? line_end + 1 : line_end;
+    }
+
+    for (size_t i = 1; i < trace->seconds.size(); i++) {
+        if (!(trace->seconds[i] > trace->seconds[i - 1])) return false;
+    }
+    return !trace->seconds.empty();
+}
+
+static void collect_traces(const char* arg, std::vector<std::string>* paths) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    if (fs::is_directory(arg, ec)) {
+        size_t first = paths->size();
+        for (auto& entry : fs::recursive_directory_iterator(arg, ec)) {
+            if (entry.is_regular_file(ec)) paths->push_back(entry.path().string());
+        }
+        std::sort(paths->begin() + first, paths->end());
+    } else {
+        paths->push_back(arg);
+    }
+}
+
+/**
+ * Rung-major segment sizes: every line one rung, sizes in bytes
+ * Returns the segment count per rung, 0 when malformed
+ */
+static int load_segment_sizes(const char* path, int rungs, std::vector<float>* bytes) {
+    std::string text;
+    if (!read_file(path, &text)) return 0;
+
+    int per_rung = 0, lines = 0;
+    const char* p = text.c_str();
+    while (*p && lines < rungs) {
+        const char* line_end = strchr(p, '\n');
+        if (!line_end) line_end = p + strlen(p);
+
+        int count = 0;
+        const char* q = p;
+        while (q < line_end) {
+            char* next;
+            double v = strtod(q, &next);
+            if (next == q) {
+                q++;
+                continue;
+            }
+            bytes->push_back((float)v);
+            count++;
+            q = next;
+        }
+
+        if (count > 0) {
+            if (lines > 0 && count != per_rung) return 0;
+            per_rung = count;
+            lines++;
+        }
+        p = *line_end ? line_end + 1 : line_end;
+    }
+
+    return (lines == rungs) ? per_rung : 0;
+}
+
+/**
+ * Number after `"key":` at or past from; false when the key is missing
+ */
+static bool json_number(const std::string& text, const char* key, size_t from, size_t to, double* value) {
+    size_t at = text.find(std::string("\"") + key + "\"", from);
+    if (at == std::string::npos || at >= to) return false;
+    at = text.find(':', at);
+    if (at == std::string::npos || at >= to) return false;
+
+    char* end;
+    *value = strtod(text.c_str() + at + 1, &end);
+    return end != text.c_str() + at + 1;
+}
+
+/**
+ * segment_sizes.json sidecar from videoWorker.js:
+ * {"segmentDuration": s, "renditions": [{"name", "bandwidth": bps, "sizes": [bytes...]}...]}
+ * with renditions in ascending bitrate. Renditions are cut to the shortest
+ * one (the last segment may be missing from some). Returns the segment
+ * count per rung, 0 when malformed
+ */
+static int load_segment_sizes_json(const char* path, std::vector<float>* kbps, std::vector<float>* bytes,
+                                   float* segment_duration) {
+    std::string text;
+    if (!read_file(path, &text)) return 0;
+
+    double duration;
+    if (json_number(text, "segmentDuration", 0, text.size(), &duration) && duration > 0.0) {
+        *segment_duration = (float)duration;
+    }
+
+    std::vector<std::vector<float>> rungs;
+    size_t pos = text.find("\"renditions\"");
+    while (pos != std::string::npos && (pos = text.find('{', pos)) != std::string::npos) {
+        size_t end = text.find('}', pos);
+        if (end == std::string::npos) return 0;
+
+        double bandwidth;
+        size_t list = text.find("\"sizes\"", pos);
+        if (!json_number(text, "bandwidth", pos, end, &bandwidth) || list >= end) return 0;
+        list = text.find('[', list);
+        size_t list_end = text.find(']', list);
+        if (list >= end || list_end >= end) return 0;
+
+        std::vector<float> sizes;
+        for (const char* q = text.c_str() + list + 1; q < text.c_str() + list_end;) {
+            char* next;
+            double v = strtod(q, &next);
+            if (next == q) {
+                q++;
+                continue;
+            }
+            sizes.push_back((float)v);
+            q = next;
+        }
+        if (sizes.empty() || !(bandwidth > 0.0)) return 0;
+
+        kbps->push_back((float)(bandwidth / 1000.0));
+        rungs.push_back(std::move(sizes));
+        pos = end + 1;
+    }
+    if (rungs.empty() || (int)rungs.size() > MAX_LADDER_RUNGS) return 0;
+
+    size_t per_rung = rungs[0].size();
+    for (auto& r : rungs) per_rung = std::min(per_rung, r.size());
+    for (auto& r : rungs) bytes->insert(bytes->end(), r.begin(), r.begin() + per_rung);
+    return (int)per_rung;
+}
+
+// ============================================================================
+// SWEEP
+// ============================================================================
+
+struct PolicyTotals {
+    int traces;
+    double avg_bitrate_kbps;
+    double rebuffer_seconds;
+    double rebuffer_events;
+    double startup_seconds;
+    double switches;
+    double qoe;
+    long long decisions;
+    double busy_seconds;        // time spent inside the simulator, summed over threads
+};
+
+/**
+ * Run fn(0..count-1) on up to num_threads workers
+ */
+template <typename Fn>
+static void parallel_for(int count, int num_threads, Fn fn) {
+    if (num_threads <= 0) num_threads = (int)std::thread::hardware_concurrency();
+    if (num_threads > count) num_threads = count;
+    if (num_threads < 1) num_threads = 1;
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) fn(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads - 1; t++) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+}
+
+static int usage() {
+    fprintf(stderr,
+            "usage: abr_simulator [--manifest FILE] [--sizes FILE] [--segments N] [--segment-duration S]\n"
+            "                     [--max-buffer S] [--policy LIST] [--unit mbps|kbps] [--threads N]\n"
+            "                     [--per-trace] <trace file or directory>...\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    const char* manifest = nullptr;
+    const char* sizes = nullptr;
+    int segments = 48;
+    float segment_duration = 0.0f;      // 4 s unless --segment-duration or a sidecar sets it
+    float max_buffer = 60.0f;
+    float unit_kbps = 1000.0f;
+    int threads = 0;
+    bool per_trace = false;
+    bool enabled[ABR_POLICY_COUNT];
+    for (int p = 0; p < ABR_POLICY_COUNT; p++) enabled[p] = true;
+
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--manifest" && has_value) {
+            manifest = argv[++i];
+        } else if (arg == "--sizes" && has_value) {
+            sizes = argv[++i];
+        } else if (arg == "--segments" && has_value) {
+            segments = atoi(argv[++i]);
+        } else if (arg == "--segment-duration" && has_value) {
+            segment_duration = (float)atof(argv[++i]);
+        } else if (arg == "--max-buffer" && has_value) {
+            max_buffer = (float)atof(argv[++i]);
+        } else if (arg == "--threads" && has_value) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--unit" && has_value) {
+            std::string unit = argv[++i];
+            if (unit != "mbps" && unit != "kbps") return usage();
+            unit_kbps = (unit == "mbps") ? 1000.0f : 1.0f;
+        } else if (arg == "--policy" && has_value) {
+            std::string list = std::string(argv[++i]) + ",";
+            if (list != "all,") {
+                for (int p = 0; p < ABR_POLICY_COUNT; p++) enabled[p] = false;
+                for (size_t start = 0, comma; (comma = list.find(',', start)) != std::string::npos; start = comma + 1) {
+                    std::string name = list.substr(start, comma - start);
+                    int found = -1;
+                    for (int p = 0; p < ABR_POLICY_COUNT; p++) {
+                        if (name == POLICY_NAMES[p]) found = p;
+                    }
+                    if (found < 0) {
+                        fprintf(stderr, "unknown policy: %s\n", name.c_str());
+                        return usage();
+                    }
+                    enabled[found] = true;
+                }
+            }
+        } else if (arg == "--per-trace") {
+            per_trace = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            return usage();
+        } else {
+            collect_traces(argv[i], &paths);
+        }
+    }
+    if (paths.empty() || segments < 1 || segment_duration < 0.0f) return usage();
+
+    // Manifest: ladder plus optional per-segment sizes
+    AbrLadder* ladder = nullptr;
+    if (manifest) {
+        std::string playlist;
+        if (!read_file(manifest, &playlist) || !(ladder = create_abr_ladder_from_playlist(playlist.c_str()))) {
+            fprintf(stderr, "no variant streams in %s\n", manifest);
+            return 1;
+        }
+    }
+    if (sizes) {
+        std::vector<float> bytes;
+        int per_rung = 0;
+        bool sidecar = false;
+        std::string text;
+
+        if (read_file(sizes, &text)) {
+            size_t first = text.find_first_not_of(" \t\r\n");
+            sidecar = first != std::string::npos && text[first] == '{';
+        }
+
+        if (sidecar) {
+            std::vector<float> kbps;
+            float sidecar_duration = 0.0f;
+            per_rung = load_segment_sizes_json(sizes, &kbps, &bytes, &sidecar_duration);
+            if (per_rung && !ladder) ladder = create_abr_ladder(kbps.data(), nullptr, nullptr, (int)kbps.size());
+            if (per_rung && (!ladder || ladder->count != (int)kbps.size())) per_rung = 0;
+            if (segment_duration <= 0.0f) segment_duration = sidecar_duration;
+        } else {
+            if (!ladder) {
+                float bitrates[MAX_LADDER_RUNGS];
+                memcpy(bitrates, DEFAULT_LADDER.bitrates, sizeof(bitrates));
+                ladder = create_abr_ladder(bitrates, nullptr, nullptr, DEFAULT_LADDER.count);
+            }
+            per_rung = load_segment_sizes(sizes, ladder->count, &bytes);
+        }
+
+        if (!per_rung || !ladder || !abr_ladder_set_segment_sizes(ladder, bytes.data(), per_rung)) {
+            if (sidecar) {
+                fprintf(stderr, "%s: expected renditions with bandwidth and sizes%s\n", sizes,
+                        manifest ? " matching the manifest" : "");
+            } else {
+                fprintf(stderr, "%s: expected %d lines of segment sizes of equal length\n", sizes, ladder->count);
+            }
+            return 1;
+        }
+    }
+    if (segment_duration <= 0.0f) segment_duration = 4.0f;
+
+    MpcTable* table = nullptr;
+    if (enabled[ABR_POLICY_FAST_MPC]) {
+        table = create_mpc_table(ladder, segment_duration, max_buffer);
+        if (!table) {
+            fprintf(stderr, "could not build the fastmpc table (segment duration %g s, max buffer %g s)\n",
+                    segment_duration, max_buffer);
+            return 1;
+        }
+    }
+
+    // Load every trace up front (in parallel), then simulate
+    int trace_count = (int)paths.size();
+    std::vector<Trace> traces(trace_count);
+    std::vector<char> loaded(trace_count);
+    parallel_for(trace_count, threads, [&](int t) { loaded[t] = load_trace(paths[t], unit_kbps, &traces[t]); });
+
+    std::vector<AbrSimResult> results((size_t)trace_count * ABR_POLICY_COUNT);
+    std::vector<double> busy((size_t)trace_count * ABR_POLICY_COUNT);
+    std::vector<char> ok((size_t)trace_count * ABR_POLICY_COUNT);
+
+    auto wall_start = std::chrono::steady_clock::now();
+    parallel_for(trace_count, threads, [&](int t) {
+        if (!loaded[t]) return;
+        for (int p = 0; p < ABR_POLICY_COUNT; p++) {
+            if (!enabled[p]) continue;
+            size_t cell = (size_t)t * ABR_POLICY_COUNT + p;
+            auto start = std::chrono::steady_clock::now();
+            ok[cell] = simulate_abr_trace(ladder, traces[t].seconds.data(), traces[t].kbps.data(),
+                                          (int)traces[t].seconds.size(), segments, segment_duration, max_buffer,
+                                          p, table, &results[cell]);
+            busy[cell] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    });
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    // Aggregate
+    PolicyTotals totals[ABR_POLICY_COUNT];
+    memset(totals, 0, sizeof(totals));
+    int skipped = 0;
+
+    if (per_trace) {
+        printf("trace,policy,avg_bitrate_kbps,rebuffer_s,rebuffer_events,startup_s,switches,qoe\n");
+    }
+    for (int t = 0; t < trace_count; t++) {
+        // Unreadable, or rejected by the simulator (e.g. no positive throughput)
+        bool usable = loaded[t];
+        for (int p = 0; usable && p < ABR_POLICY_COUNT; p++) {
+            if (enabled[p] && !ok[(size_t)t * ABR_POLICY_COUNT + p]) usable = false;
+        }
+        if (!usable) {
+            fprintf(stderr, "skipped %s\n", paths[t].c_str());
+            skipped++;
+            continue;
+        }
+
+        for (int p = 0; p < ABR_POLICY_COUNT; p++) {
+            size_t cell = (size_t)t * ABR_POLICY_COUNT + p;
+            if (!enabled[p]) continue;
+
+            const AbrSimResult& r = results[cell];
+            PolicyTotals& sum = totals[p];
+            sum.traces++;
+            sum.avg_bitrate_kbps += r.avg_bitrate_kbps;
+            sum.rebuffer_seconds += r.rebuffer_seconds;
+            sum.rebuffer_events += r.rebuffer_events;
+            sum.startup_seconds += r.startup_seconds;
+            sum.switches += r.switches;
+            sum.qoe += r.qoe;
+            sum.decisions += r.segments - 1;
+            sum.busy_seconds += busy[cell];
+
+            if (per_trace) {
+                printf("%s,%s,%.1f,%.3f,%d,%.3f,%d,%.4f\n", paths[t].c_str(), POLICY_NAMES[p], r.avg_bitrate_kbps,
+                       r.rebuffer_seconds, r.rebuffer_events, r.startup_seconds, r.switches, r.qoe);
+            }
+        }
+    }
+
+    FILE* report = per_trace ? stderr : stdout;
+    fprintf(report, "%d traces (%d skipped), %d x %.1f s segments, %.2f s wall\n", trace_count - skipped, skipped,
+            segments, segment_duration, wall);
+    fprintf(report, "%-8s %12s %12s %10s %10s %10s %10s %14s\n", "policy", "bitrate_kbps", "rebuffer_s",
+            "stalls", "startup_s", "switches", "qoe", "decisions/s");
+    for (int p = 0; p < ABR_POLICY_COUNT; p++) {
+        const PolicyTotals& sum = totals[p];
+        if (!enabled[p] || sum.traces == 0) continue;
+        double n = sum.traces;
+        double rate = (sum.busy_seconds > 0.0) ? sum.decisions / sum.busy_seconds : 0.0;
+        fprintf(report, "%-8s %12.1f %12.3f %10.2f %10.3f %10.2f %10.4f %14.0f\n", POLICY_NAMES[p],
+                sum.avg_bitrate_kbps / n, sum.rebuffer_seconds / n, sum.rebuffer_events / n,
+                sum.startup_seconds / n, sum.switches / n, sum.qoe / n, rate);
+    }
+
+    destroy_mpc_table(table);
+    destroy_abr_ladder(ladder);
+    return 0;
+}
@@ -8,63 +8,685 @@
 #include <cstring>
 #include <cstdint>
 #include <cstdlib>
+#include <atomic>
+
+// Worker threads for the series analyzer (native builds, or wasm built with -pthread)
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#include <thread>
+#define SERIES_THREADS 1
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
 // ============================================================================
-// FFT IMPLEMENTATION (Cooley-Tukey)
+// FFT PLANS (precomputed twiddles, packed real transform)
 // ============================================================================
 
-static void fft_internal(float* real, float* imag, int n, int inverse) {
-    // Bit-reversal permutation
-    for (int i = 1, j = 0; i < n; i++) {
-        int bit = n >> 1;
+/**
+ * Reusable FFT plan for real input of size n (power of two)
+ * The real signal is packed into m = n/2 complex points, transformed with a
+ * radix-2 complex FFT driven by table twiddles, then split into n/2+1 bins.
+ * Window and scratch buffers live in the plan, so transforms never allocate.
+ */
+struct FFTPlan {
+    int n;              // real transform size
+    int m;              // complex points (n / 2)
+    int* bitrev;        // m bit-reversal indices
+    float* tw_re;       // m/2 complex-FFT twiddles exp(-2*pi*i*k/m)
+    float* tw_im;
+    float* split_re;    // m+1 real-split twiddles exp(-2*pi*i*k/n)
+    float* split_im;
+    float* window;      // n-point Hann window
+    float* buf_re;      // m complex scratch
+    float* buf_im;
+    float* spec_re;     // m+1 spectrum output
+    float* spec_im;
+    float* power;       // m+1 bin scratch for callers (quantized spectrogram)
+};
+
+static void destroy_plan(FFTPlan* plan) {
+    if (!plan) return;
+    free(plan->bitrev);
+    free(plan->tw_re); free(plan->tw_im);
+    free(plan->split_re); free(plan->split_im);
+    free(plan->window);
+    free(plan->buf_re); free(plan->buf_im);
+    free(plan->spec_re); free(plan->spec_im);
+    free(plan->power);
+    free(plan);
+}
+
+static FFTPlan* create_plan(int n) {
+    if (n < 4 || (n & (n - 1)) != 0) return nullptr;
+
+    FFTPlan* plan = (FFTPlan*)calloc(1, sizeof(FFTPlan));
+    if (!plan) return nullptr;
+
+    int m = n / 2;
+    plan->n = n;
+    plan->m = m;
+    plan->bitrev = (int*)malloc(m * sizeof(int));
+    plan->tw_re = (float*)malloc((m / 2 + 1) * sizeof(float));
+    plan->tw_im = (float*)malloc((m / 2 + 1) * sizeof(float));
+    plan->split_re = (float*)malloc((m + 1) * sizeof(float));
+    plan->split_im = (float*)malloc((m + 1) * sizeof(float));
+    plan->window = (float*)malloc(n * sizeof(float));
+    plan->buf_re = (float*)malloc(m * sizeof(float));
+    plan->buf_im = (float*)malloc(m * sizeof(float));
+    plan->spec_re = (float*)malloc((m + 1) * sizeof(float));
+    plan->spec_im = (float*)malloc((m + 1) * sizeof(float));
+    plan->power = (float*)malloc((m + 1) * sizeof(float));
+
+    if (!plan->bitrev || !plan->tw_re || !plan->tw_im || !plan->split_re || !plan->split_im ||
+        !plan->window || !plan->buf_re || !plan->buf_im || !plan->spec_re || !plan->spec_im || !plan->power) {
+        destroy_plan(plan);
+        return nullptr;
+    }
+
+    // Bit-reversal permutation for m points
+    for (int i = 1, j = 0; i < m; i++) {
+        int bit = m >> 1;
         for (; j & bit; bit >>= 1) j ^= bit;
         j ^= bit;
-        if (i < j) {
-            float temp = real[i]; real[i] = real[j]; real[j] = temp;
-            temp = imag[i]; imag[i] = imag[j]; imag[j] = temp;
-        }
+        plan->bitrev[i] = j;
     }
-    
-    // Cooley-Tukey FFT
-    for (int len = 2; len <= n; len <<= 1) {
-        float angle = (inverse ? 1 : -1) * 2.0f * M_PI / len;
-        float wpr = cosf(angle);
-        float wpi = sinf(angle);
-        
-        for (int i = 0; i < n; i += len) {
-            float wr = 1.0f, wi = 0.0f;
-            for (int j = 0; j < len / 2; j++) {
+    plan->bitrev[0] = 0;
+
+    // Twiddles evaluated directly in double precision (no recurrence drift)
+    for (int k = 0; k <= m / 2; k++) {
+        double angle = -2.0 * M_PI * k / m;
+        plan->tw_re[k] = (float)cos(angle);
+        plan->tw_im[k] = (float)sin(angle);
+    }
+    for (int k = 0; k <= m; k++) {
+        double angle = -2.0 * M_PI * k / n;
+        plan->split_re[k] = (float)cos(angle);
+        plan->split_im[k] = (float)sin(angle);
+    }
+
+    // Hann window
+    for (int i = 0; i < n; i++) {
+        plan->window[i] = (float)(0.5 * (1.0 - cos(2.0 * M_PI * i / (n - 1))));
+    }
+
+    return plan;
+}
+
+// Plan reused by the one-shot exports (rebuilt only when fft_size changes).
+// One per thread: a plan carries its own scratch, and native builds call
+// the one-shot exports from worker threads.
+struct CachedPlan {
+    FFTPlan* plan = nullptr;
+    ~CachedPlan() { destroy_plan(plan); }
+};
+static thread_local CachedPlan cached_plan;
+
+static FFTPlan* get_cached_plan(int n) {
+    if (cached_plan.plan && cached_plan.plan->n == n) return cached_plan.plan;
+    FFTPlan* plan = create_plan(n);
+    if (!plan) return nullptr;
+    destroy_plan(cached_plan.plan);
+    cached_plan.plan = plan;
+    return plan;
+}
+
+/**
+ * In-place complex FFT of plan->m points (input already bit-reversed)
+ */
+static void fft_complex_inplace(const FFTPlan* plan, float* re, float* im, int inverse) {
+    int m = plan->m;
+    float sign = inverse ? -1.0f : 1.0f;
+
+    for (int len = 2; len <= m; len <<= 1) {
+        int half = len >> 1;
+        int step = m / len;
+
+        for (int i = 0; i < m; i += len) {
+            for (int j = 0; j < half; j++) {
+                float wr = plan->tw_re[j * step];
+                float wi = sign * plan->tw_im[j * step];
                 int u = i + j;
-                int v = i + j + len / 2;
-                float tr = wr * real[v] - wi * imag[v];
-                float ti = wr * imag[v] + wi * real[v];
-                real[v] = real[u] - tr;
-                imag[v] = imag[u] - ti;
-                real[u] += tr;
-                imag[u] += ti;
-                float temp = wr;
-                wr = wr * wpr - wi * wpi;
-                wi = temp * wpi + wi * wpr;
+                int v = u + half;
+                float tr = wr * re[v] - wi * im[v];
+                float ti = wr * im[v] + wi * re[v];
+                re[v] = re[u] - tr;
+                im[v] = im[u] - ti;
+                re[u] += tr;
+                im[u] += ti;
             }
         }
     }
-    
-    if (inverse) {
-        for (int i = 0; i < n; i++) {
-            real[i] /= n;
-            imag[i] /= n;
+}
+
+/**
+ * Forward real FFT of n samples (optionally windowed) into plan->spec_re/spec_im (m+1 bins)
+ */
+static void fft_real_forward(FFTPlan* plan, const float* samples, bool apply_window) {
+    int m = plan->m;
+    float* out_re = plan->spec_re;
+    float* out_im = plan->spec_im;
+    float* re = plan->buf_re;
+    float* im = plan->buf_im;
+    const float* w = plan->window;
+
+    // Pack even/odd samples as one complex sequence, scattered in bit-reversed order
+    for (int k = 0; k < m; k++) {
+        int dst = plan->bitrev[k];
+        float even = samples[2 * k];
+        float odd = samples[2 * k + 1];
+        if (apply_window) {
+            even *= w[2 * k];
+            odd *= w[2 * k + 1];
+        }
+        re[dst] = even;
+        im[dst] = odd;
+    }
+
+    fft_complex_inplace(plan, re, im, 0);
+
+    // Split: X[k] = (Z[k] + conj(Z[m-k])) / 2 - i * W^k * (Z[k] - conj(Z[m-k])) / 2
+    out_re[0] = re[0] + im[0];
+    out_im[0] = 0.0f;
+    out_re[m] = re[0] - im[0];
+    out_im[m] = 0.0f;
+
+    for (int k = 1; k < m; k++) {
+        float zr = re[k], zi = im[k];
+        float cr = re[m - k], ci = -im[m - k];
+
+        float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        float dr = 0.5f * (zr - cr), di = 0.5f * (zi - ci);
+
+        // -i * W * d
+        float wr = plan->split_re[k], wi = plan->split_im[k];
+        float tr = wr * dr - wi * di;
+        float ti = wr * di + wi * dr;
+
+        out_re[k] = er + ti;
+        out_im[k] = ei - tr;
+    }
+}
+
+/**
+ * Inverse of fft_real_forward: m+1 bins (spec_re/spec_im may be passed) to n samples
+ * Normalized, so forward followed by inverse reproduces the input
+ */
+static void fft_real_inverse(FFTPlan* plan, const float* in_re, const float* in_im, float* samples) {
+    int m = plan->m;
+    float* re = plan->buf_re;
+    float* im = plan->buf_im;
+
+    // Merge: E[k] = (X[k] + conj(X[m-k])) / 2, O[k] = conj(W^k) * (X[k] - conj(X[m-k])) / 2,
+    // Z[k] = E[k] + i * O[k], scattered in bit-reversed order
+    for (int k = 0; k < m; k++) {
+        float xr = in_re[k], xi = in_im[k];
+        float cr = in_re[m - k], ci = -in_im[m - k];
+
+        float er = 0.5f * (xr + cr), ei = 0.5f * (xi + ci);
+        float dr = 0.5f * (xr - cr), di = 0.5f * (xi - ci);
+
+        float wr = plan->split_re[k], wi = -plan->split_im[k];
+        float or_ = wr * dr - wi * di;
+        float oi = wr * di + wi * dr;
+
+        int dst = plan->bitrev[k];
+        re[dst] = er - oi;
+        im[dst] = ei + or_;
+    }
+
+    fft_complex_inplace(plan, re, im, 1);
+
+    float scale = 1.0f / m;
+    for (int k = 0; k < m; k++) {
+        samples[2 * k] = re[k] * scale;
+        samples[2 * k + 1] = im[k] * scale;
+    }
+}
+
+/**
+ * Windowed power spectrum |X[k]|^2 of one frame (m+1 bins), no allocation
+ */
+static void frame_power_spectrum(FFTPlan* plan, const float* samples, float* power) {
+    fft_real_forward(plan, samples, true);
+
+    const float* re = plan->spec_re;
+    const float* im = plan->spec_im;
+    for (int k = 0; k <= plan->m; k++) {
+        power[k] = re[k] * re[k] + im[k] * im[k];
+    }
+}
+
+/**
+ * Windowed power spectrum of one frame in dB (m+1 bins)
+ */
+static void frame_power_db(FFTPlan* plan, const float* samples, float* bins) {
+    frame_power_spectrum(plan, samples, bins);
+    for (int k = 0; k <= plan->m; k++) {
+        bins[k] = 10.0f * log10f(fmaxf(bins[k], 1e-20f)); // dB scale (power)
+    }
+}
+
+/**
+ * Create a reusable FFT plan (fft_size must be a power of two >= 4)
+ * Returns opaque handle, or nullptr on invalid size
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+FFTPlan* create_fft_plan(int fft_size) {
+    return create_plan(fft_size);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_fft_plan(FFTPlan* plan) {
+    if (plan == cached_plan.plan) return;
+    destroy_plan(plan);
+}
+
+// ============================================================================
+// RESAMPLING AND DOWNMIX (analysis front-end)
+// ============================================================================
+
+// Independent accumulators so padded dot products map onto SIMD lanes
+static const int DOT_LANES = 4;
+
+static inline float lane_dot(const float* a, const float* b, int padded_length) {
+    float acc[DOT_LANES] = {0};
+    for (int i = 0; i < padded_length; i += DOT_LANES) {
+        for (int l = 0; l < DOT_LANES; l++) acc[l] += a[i + l] * b[i + l];
+    }
+    float sum = 0.0f;
+    for (int l = 0; l < DOT_LANES; l++) sum += acc[l];
+    return sum;
+}
+
+// Fingerprinting and intro analysis need nothing above ~5 kHz
+static const int ANALYSIS_SAMPLE_RATE = 11025;
+
+static const int RESAMPLE_TAPS = 48;            // taps per polyphase branch (multiple of DOT_LANES)
+static const int RESAMPLE_MAX_PHASES = 2048;    // upsampling factor after reducing the ratio
+static const float RESAMPLE_ROLLOFF = 0.88f;    // cutoff as a fraction of the lower Nyquist (stopband by Nyquist)
+static const float RESAMPLE_KAISER_BETA = 8.0f;
+
+/**
+ * Rational-ratio (L/M) polyphase FIR resampler with interleaved-channel downmix
+ * Output is mono. Each output sample is one RESAMPLE_TAPS dot product against
+ * the branch selected by its phase; the filter is centred, so output n lines
+ * up with input time n * in_rate / out_rate (RESAMPLE_TAPS/2 input lookahead).
+ */
+struct AudioResampler {
+    int channels;
+    int up;                 // L
+    int down;               // M
+    float* coeffs;          // up x RESAMPLE_TAPS, each branch time-reversed
+    float* buffer;          // mono input history, buffer[0] = input index buffer_start
+    int buffer_length;
+    int buffer_capacity;
+    long long buffer_start;
+    long long input_count;  // mono frames received
+    long long next_output;
+    bool flushed;
+};
+
+static int gcd_int(int a, int b) {
+    while (b) { int t = a % b; a = b; b = t; }
+    return a;
+}
+
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_audio_resampler(AudioResampler* resampler) {
+    if (!resampler) return;
+    free(resampler->coeffs);
+    free(resampler->buffer);
+    free(resampler);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void reset_audio_resampler(AudioResampler* resampler) {
+    if (!resampler) return;
+    // Leading zeros stand in for the signal before the first sample
+    memset(resampler->buffer, 0, RESAMPLE_TAPS * sizeof(float));
+    resampler->buffer_length = RESAMPLE_TAPS;
+    resampler->buffer_start = -RESAMPLE_TAPS;
+    resampler->input_count = 0;
+    resampler->next_output = 0;
+    resampler->flushed = false;
+}
+
+/**
+ * Resampler from in_rate to out_rate (out_rate <= 0 uses ANALYSIS_SAMPLE_RATE)
+ * for interleaved input with `channels` channels, downmixed to mono
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+AudioResampler* create_audio_resampler(int in_rate, int out_rate, int channels) {
+    if (out_rate <= 0) out_rate = ANALYSIS_SAMPLE_RATE;
+    if (in_rate <= 0 || channels < 1) return nullptr;
+
+    int g = gcd_int(in_rate, out_rate);
+    int up = out_rate / g;
+    int down = in_rate / g;
+    if (up > RESAMPLE_MAX_PHASES) return nullptr;
+
+    AudioResampler* resampler = (AudioResampler*)calloc(1, sizeof(AudioResampler));
+    if (!resampler) return nullptr;
+
+    resampler->channels = channels;
+    resampler->up = up;
+    resampler->down = down;
+    resampler->coeffs = (float*)malloc((size_t)up * RESAMPLE_TAPS * sizeof(float));
+    resampler->buffer_capacity = 4 * RESAMPLE_TAPS;
+    resampler->buffer = (float*)malloc(resampler->buffer_capacity * sizeof(float));
+
+    if (!resampler->coeffs || !resampler->buffer) {
+        destroy_audio_resampler(resampler);
+        return nullptr;
+    }
+
+    // Kaiser-windowed sinc prototype at the upsampled rate, centred on taps/2 input samples.
+    // Cutoff sits below the lower Nyquist; gain `up` restores the level lost to zero-stuffing.
+    int length = up * RESAMPLE_TAPS;
+    double centre = length / 2.0;
+    double cutoff = 0.5 * RESAMPLE_ROLLOFF / (up > down ? up : down); // cycles per upsampled sample
+    double window_norm = bessel_i0(RESAMPLE_KAISER_BETA);
+
+    for (int phase = 0; phase < up; phase++) {
+        for (int k = 0; k < RESAMPLE_TAPS; k++) {
+            int j = phase + k * up;
+            double t = j - centre;
+            double sinc = (t == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+            double r = t / centre;
+            double window = (r * r < 1.0) ? bessel_i0(RESAMPLE_KAISER_BETA * sqrt(1.0 - r * r)) / window_norm : 0.0;
+            resampler->coeffs[(size_t)phase * RESAMPLE_TAPS + (RESAMPLE_TAPS - 1 - k)] = (float)(up * sinc * window);
+        }
+    }
+
+    reset_audio_resampler(resampler);
+    return resampler;
+}
+
+/**
+ * Upper bound on samples produced by one process() call of `frames` frames
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int audio_resampler_max_output(AudioResampler* resampler, int frames) {
+    if (!resampler || frames < 0) return 0;
+    return (int)(((long long)frames * resampler->up + resampler->down - 1) / resampler->down) + 1;
+}
+
+/**
+ * Emit every output sample whose filter span is already buffered
+ */
+static int resampler_drain(AudioResampler* r, float* output, long long limit) {
+    int written = 0;
+
+    while (r->next_output < limit) {
+        long long p = r->next_output * r->down + (long long)r->up * RESAMPLE_TAPS / 2;
+        long long base = p / r->up;
+        int phase = (int)(p % r->up);
+        long long first = base - RESAMPLE_TAPS + 1;
+        if (base >= r->buffer_start + r->buffer_length) break;
+
+        output[written++] = lane_dot(r->coeffs + (size_t)phase * RESAMPLE_TAPS,
+                                     r->buffer + (first - r->buffer_start), RESAMPLE_TAPS);
+        r->next_output++;
+    }
+
+    // Drop history the next output no longer reaches
+    long long keep_from = (r->next_output * r->down + (long long)r->up * RESAMPLE_TAPS / 2) / r->up - RESAMPLE_TAPS + 1;
+    int drop = (int)(keep_from - r->buffer_start);
+    if (drop > 0 && drop <= r->buffer_length) {
+        memmove(r->buffer, r->buffer + drop, (r->buffer_length - drop) * sizeof(float));
+        r->buffer_length -= drop;
+        r->buffer_start += drop;
+    }
+
+    return written;
+}
+
+static bool resampler_reserve(AudioResampler* r, int extra) {
+    if (r->buffer_length + extra <= r->buffer_capacity) return true;
+    int capacity = r->buffer_capacity;
+    while (capacity < r->buffer_length + extra) capacity *= 2;
+    float* grown = (float*)realloc(r->buffer, capacity * sizeof(float));
+    if (!grown) return false;
+    r->buffer = grown;
+    r->buffer_capacity = capacity;
+    return true;
+}
+
+/**
+ * Downmix and resample the next chunk of interleaved input
+ * output must hold audio_resampler_max_output(frames) samples
+ * Returns samples written, or -1 on failure / after flush
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int audio_resampler_process(AudioResampler* resampler, float* input, int frames, float* output) {
+    if (!resampler || !input || !output || frames < 0 || resampler->flushed) return -1;
+    if (!resampler_reserve(resampler, frames)) return -1;
+
+    float* dst = resampler->buffer + resampler->buffer_length;
+    int channels = resampler->channels;
+
+    if (channels == 1) {
+        memcpy(dst, input, frames * sizeof(float));
+    } else if (channels == 2) {
+        for (int i = 0; i < frames; i++) dst[i] = 0.5f * (input[i * 2] + input[i * 2 + 1]);
+    } else {
+        float scale = 1.0f / channels;
+        for (int i = 0; i < frames; i++) {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; c++) sum += input[(size_t)i * channels + c];
+            dst[i] = sum * scale;
+        }
+    }
+
+    resampler->buffer_length += frames;
+    resampler->input_count += frames;
+
+    return resampler_drain(resampler, output, 0x7FFFFFFFFFFFFFFFLL);
+}
+
+/**
+ * Emit the tail held back for lookahead (zero-padded past the end)
+ * Total output over the stream is ceil(input_frames * out_rate / in_rate)
+ * Returns samples written (at most RESAMPLE_TAPS / 2 * out_rate / in_rate + 1)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int audio_resampler_flush(AudioResampler* resampler, float* output) {
+    if (!resampler || !output || resampler->flushed) return 0;
+    if (!resampler_reserve(resampler, RESAMPLE_TAPS)) return 0;
+
+    memset(resampler->buffer + resampler->buffer_length, 0, RESAMPLE_TAPS * sizeof(float));
+    resampler->buffer_length += RESAMPLE_TAPS;
+    resampler->flushed = true;
+
+    long long total = (resampler->input_count * resampler->up + resampler->down - 1) / resampler->down;
+    return resampler_drain(resampler, output, total);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int get_resampled_length(int frames, int in_rate, int out_rate) {
+    if (out_rate <= 0) out_rate = ANALYSIS_SAMPLE_RATE;
+    if (frames < 1 || in_rate <= 0) return 0;
+    return (int)(((long long)frames * out_rate + in_rate - 1) / in_rate);
+}
+
+/**
+ * One-shot downmix + resample of a resident buffer for the analysis paths
+ * (spectrogram, landmarks, series analyzer, mel features)
+ * Returns get_resampled_length(frames, in_rate, out_rate) mono samples
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* resample_audio(float* input, int frames, int channels, int in_rate, int out_rate) {
+    if (!input || frames < 1) return nullptr;
+
+    AudioResampler* resampler = create_audio_resampler(in_rate, out_rate, channels);
+    if (!resampler) return nullptr;
+
+    int length = get_resampled_length(frames, in_rate, out_rate > 0 ? out_rate : ANALYSIS_SAMPLE_RATE);
+    float* output = (float*)malloc(((size_t)length + RESAMPLE_TAPS) * sizeof(float));
+
+    if (output) {
+        int written = audio_resampler_process(resampler, input, frames, output);
+        if (written < 0) {
+            free(output);
+            output = nullptr;
+        } else {
+            audio_resampler_flush(resampler, output + written);
         }
     }
+
+    destroy_audio_resampler(resampler);
+    return output;
+}
+
+/**
+ * Mono copy of interleaved audio at out_rate for the analysis entry points
+ * Returns the input itself when it is already mono at out_rate (the caller
+ * frees the result only when it differs from the input); *length receives
+ * the sample count
+ */
+static float* analysis_audio(float* input, int frames, int channels, int in_rate, int out_rate, int* length) {
+    if (!input || frames < 1 || channels < 1) return nullptr;
+
+    if (channels == 1 && in_rate == out_rate) {
+        *length = frames;
+        return input;
+    }
+
+    *length = get_resampled_length(frames, in_rate, out_rate);
+    return resample_audio(input, frames, channels, in_rate, out_rate);
+}
+
+// ============================================================================
+// COMPACT STORAGE (float16 / uint8 feature and spectrogram cells)
+// ============================================================================
+
+// Output element formats
+static const int FEATURE_FORMAT_F32 = 0;
+static const int FEATURE_FORMAT_F16 = 1;     // IEEE half, round to nearest even
+static const int FEATURE_FORMAT_U8 = 2;      // linear over the configured range
+
+/**
+ * Float to IEEE 754 half precision (round to nearest even, saturating to inf)
+ */
+static inline uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t abs_bits = bits & 0x7FFFFFFF;
+
+    if (abs_bits >= 0x7F800000) {                        // inf / nan
+        return sign | 0x7C00 | (abs_bits > 0x7F800000 ? 0x200 : 0);
+    }
+    if (abs_bits >= 0x477FF000) return sign | 0x7C00;    // rounds past 65504
+    if (abs_bits < 0x38800000) {                         // subnormal half (or zero)
+        if (abs_bits < 0x33000000) return sign;
+        uint32_t mantissa = (abs_bits & 0x7FFFFF) | 0x800000;
+        int shift = 126 - (int)(abs_bits >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return sign | (uint16_t)half;
+    }
+
+    uint32_t half = ((abs_bits - 0x38000000) >> 13);
+    uint32_t rest = abs_bits & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return sign | (uint16_t)half;
+}
+
+static inline uint8_t quantize_u8(float value, float min_value, float scale) {
+    float q = (value - min_value) * scale + 0.5f;
+    if (q <= 0.0f) return 0;
+    if (q >= 255.0f) return 255;
+    return (uint8_t)q;
+}
+
+/**
+ * IEEE 754 half precision to float (exact)
+ */
+static inline float half_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {                                             // subnormal: normalize
+        int shift = 0;
+        while (!(mantissa & 0x400)) { mantissa <<= 1; shift++; }
+        bits = sign | ((uint32_t)(113 - shift) << 23) | ((mantissa & 0x3FF) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline int feature_format_bytes(int format) {
+    return (format == FEATURE_FORMAT_F16) ? 2 : (format == FEATURE_FORMAT_U8) ? 1 : 4;
+}
+
+/**
+ * log2 from the float's exponent plus a degree-4 polynomial on the mantissa
+ * (max error 3.5e-4, i.e. about 0.001 dB); x must be positive and normal
+ */
+static inline float fast_log2(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+
+    float exponent = (float)((int)(bits >> 23) - 127);
+    bits = (bits & 0x7FFFFF) | 0x3F800000;
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    m -= 1.0f;
+
+    return exponent + m * (1.442068f + m * (-0.7007781f + m * (0.3640188f + m * -0.1056592f)));
 }
 
 // ============================================================================
 // SPECTROGRAM COMPUTATION
 // ============================================================================
 
+/**
+ * Spectrogram into a caller-provided buffer using an existing plan
+ * output: get_spectrogram_frames() * get_spectrogram_bins() floats (dB)
+ * Returns number of frames written
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int compute_spectrogram_with_plan(FFTPlan* plan, float* audio_samples, int sample_count, float* output) {
+    if (!plan || !audio_samples || !output || sample_count < plan->n) return 0;
+
+    int fft_size = plan->n;
+    int hop_size = fft_size / 4;
+    int num_frames = (sample_count - fft_size) / hop_size + 1;
+    int num_bins = plan->m + 1;
+
+    for (int frame = 0; frame < num_frames; frame++) {
+        frame_power_db(plan, audio_samples + (size_t)frame * hop_size, output + (size_t)frame * num_bins);
+    }
+
+    return num_frames;
+}
+
 /**
  * Compute audio spectrogram using STFT
  * Returns power spectrum data for visualization and analysis
@@ -73,46 +695,17 @@ extern "C" EMSCRIPTEN_KEEPALIVE
 float* compute_audio_spectrogram(float* audio_samples, int sample_count, int fft_size) {
     if (!audio_samples || sample_count < fft_size || fft_size < 64) return nullptr;
     
+    FFTPlan* plan = get_cached_plan(fft_size);
+    if (!plan) return nullptr;
+    
     int hop_size = fft_size / 4;
     int num_frames = (sample_count - fft_size) / hop_size + 1;
     int num_bins = fft_size / 2 + 1;
     
-    float* spectrogram = (float*)malloc(num_frames * num_bins * sizeof(float));
+    float* spectrogram = (float*)malloc((size_t)num_frames * num_bins * sizeof(float));
     if (!spectrogram) return nullptr;
     
-    float* real = (float*)malloc(fft_size * sizeof(float));
-    float* imag = (float*)malloc(fft_size * sizeof(float));
-    float* window = (float*)malloc(fft_size * sizeof(float));
-    
-    if (!real || !imag || !window) {
-        free(spectrogram); free(real); free(imag); free(window);
-        return nullptr;
-    }
-    
-    // Hann window
-    for (int i = 0; i < fft_size; i++) {
-        window[i] = 0.5f * (1.0f - cosf(2.0f * M_PI * i / (fft_size - 1)));
-    }
-    
-    for (int frame = 0; frame < num_frames; frame++) {
-        int offset = frame * hop_size;
-        
-        // Apply window and prepare FFT input
-        for (int i = 0; i < fft_size; i++) {
-            real[i] = audio_samples[offset + i] * window[i];
-            imag[i] = 0.0f;
-        }
-        
-        fft_internal(real, imag, fft_size, 0);
-        
-        // Compute power spectrum (magnitude squared)
-        for (int i = 0; i < num_bins; i++) {
-            float mag = sqrtf(real[i] * real[i] + imag[i] * imag[i]);
-            spectrogram[frame * num_bins + i] = 20.0f * log10f(fmaxf(mag, 1e-10f)); // dB scale
-        }
-    }
-    
-    free(real); free(imag); free(window);
+    compute_spectrogram_with_plan(plan, audio_samples, sample_count, spectrogram);
     return spectrogram;
 }
 
@@ -130,31 +723,532 @@ int get_spectrogram_bins(int fft_size) {
     return fft_size / 2 + 1;
 }
 
-// ============================================================================
-// AUDIO FINGERPRINTING
-// ============================================================================
+/**
+ * Output buffer size in bytes for the compact spectrogram
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int get_quantized_spectrogram_size(int sample_count, int fft_size, int format) {
+    if (sample_count < fft_size || fft_size < 64) return 0;
+    return get_spectrogram_frames(sample_count, fft_size) * get_spectrogram_bins(fft_size) * feature_format_bytes(format);
+}
+
+static const float POWER_DB_PER_LOG2 = 3.01029996f;     // 10 * log10(2)
 
 /**
- * Compute audio fingerprint hash
- * Uses spectral peak picking similar to Shazam algorithm
+ * Compact spectrogram into a caller-provided buffer using an existing plan
+ * dB comes straight from power via fast_log2 (no log10f per bin) and is
+ * clamped to [min_db, max_db]. FEATURE_FORMAT_F32 / F16 store dB values,
+ * FEATURE_FORMAT_U8 stores codes linear over the range.
+ * output: get_quantized_spectrogram_size() bytes
+ * Returns number of frames written
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-uint32_t compute_audio_fingerprint(float* spectrogram, int num_frames, int num_bins) {
-    if (!spectrogram || num_frames < 1 || num_bins < 1) return 0;
-    
-    uint32_t fingerprint = 0;
-    
-    // Find peaks in each frequency band and encode
-    int bands[] = {0, 10, 20, 40, 80, 160, 320};
-    int num_bands = 6;
-    
-    for (int frame = 0; frame < num_frames && frame < 32; frame++) {
-        for (int band = 0; band < num_bands && band < 5; band++) {
-            int start = bands[band];
-            int end = (bands[band + 1] < num_bins) ? bands[band + 1] : num_bins;
-            
-            float max_val = -1000.0f;
-            for (int i = start; i < end; i++) {
+int compute_spectrogram_quantized_with_plan(FFTPlan* plan, float* audio_samples, int sample_count,
+                                            int format, float min_db, float max_db, void* output) {
+    if (!plan || !audio_samples || !output || sample_count < plan->n) return 0;
+    if (format < FEATURE_FORMAT_F32 || format > FEATURE_FORMAT_U8 || !(max_db > min_db)) return 0;
+
+    int hop_size = plan->n / 4;
+    int num_frames = (sample_count - plan->n) / hop_size + 1;
+    int num_bins = plan->m + 1;
+    float scale = 255.0f / (max_db - min_db);
+
+    float* power = plan->power;
+
+    for (int frame = 0; frame < num_frames; frame++) {
+        frame_power_spectrum(plan, audio_samples + (size_t)frame * hop_size, power);
+
+        for (int i = 0; i < num_bins; i++) {
+            float db = POWER_DB_PER_LOG2 * fast_log2(fmaxf(power[i], 1e-20f));
+            power[i] = fminf(fmaxf(db, min_db), max_db);
+        }
+
+        size_t base = (size_t)frame * num_bins;
+        if (format == FEATURE_FORMAT_F32) {
+            memcpy((float*)output + base, power, num_bins * sizeof(float));
+        } else if (format == FEATURE_FORMAT_F16) {
+            uint16_t* out = (uint16_t*)output + base;
+            for (int i = 0; i < num_bins; i++) out[i] = float_to_half(power[i]);
+        } else {
+            uint8_t* out = (uint8_t*)output + base;
+            for (int i = 0; i < num_bins; i++) out[i] = quantize_u8(power[i], min_db, scale);
+        }
+    }
+
+    return num_frames;
+}
+
+/**
+ * Compact spectrogram (see compute_spectrogram_quantized_with_plan)
+ * Same framing as compute_audio_spectrogram at 1/2 (F16) or 1/4 (U8) the size
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+void* compute_audio_spectrogram_quantized(float* audio_samples, int sample_count, int fft_size,
+                                          int format, float min_db, float max_db) {
+    if (!audio_samples || sample_count < fft_size || fft_size < 64) return nullptr;
+
+    FFTPlan* plan = get_cached_plan(fft_size);
+    if (!plan) return nullptr;
+
+    void* spectrogram = malloc(get_quantized_spectrogram_size(sample_count, fft_size, format));
+    if (!spectrogram) return nullptr;
+
+    if (!compute_spectrogram_quantized_with_plan(plan, audio_samples, sample_count, format, min_db, max_db,
+                                                 spectrogram)) {
+        free(spectrogram);
+        return nullptr;
+    }
+    return spectrogram;
+}
+
+/**
+ * Decode `count` cells of a compact spectrogram, starting at cell `first`, to dB
+ */
+static void decode_spectrogram_cells(const void* spectrogram, int format, float min_db, float max_db,
+                                     size_t first, size_t count, float* out) {
+    if (format == FEATURE_FORMAT_F32) {
+        memcpy(out, (const float*)spectrogram + first, count * sizeof(float));
+    } else if (format == FEATURE_FORMAT_F16) {
+        const uint16_t* in = (const uint16_t*)spectrogram + first;
+        for (size_t i = 0; i < count; i++) out[i] = half_to_float(in[i]);
+    } else {
+        const uint8_t* in = (const uint8_t*)spectrogram + first;
+        float step = (max_db - min_db) / 255.0f;
+        for (size_t i = 0; i < count; i++) out[i] = min_db + in[i] * step;
+    }
+}
+
+// ============================================================================
+// STREAMING STFT
+// ============================================================================
+
+/**
+ * Called once per completed frame with num_bins dB values
+ * (from JS: register with addFunction(fn, 'viiii'))
+ */
+typedef void (*stft_frame_callback)(int frame_index, float* bins, int num_bins, void* user_data);
+
+/**
+ * Constant-memory STFT over an unbounded sample stream
+ * The last fft_size samples live in a power-of-two ring; frames are emitted
+ * every hop_size samples either to a callback or into a bounded FIFO queue.
+ */
+struct StreamingSTFT {
+    FFTPlan* plan;
+    int hop_size;
+    int num_bins;
+    float* ring;            // fft_size samples
+    int ring_mask;
+    int write_pos;
+    int until_next_frame;   // samples still needed before the next frame
+    float* frame;           // linearized window (fft_size)
+    float* bins;            // current frame output (num_bins)
+    float* queue;           // queue_capacity * num_bins
+    int queue_capacity;
+    int queue_head;
+    int queue_count;
+    int frames_emitted;
+};
+
+/**
+ * Create a streaming STFT
+ * hop_size <= 0 uses fft_size / 4 (same framing as compute_audio_spectrogram)
+ * queue_frames: frames buffered for stft_pull_frames when no callback is given;
+ * must be >= 1 (callback-only users pass 1), otherwise a push without a
+ * callback could never complete a frame. Returns nullptr when < 1
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+StreamingSTFT* create_streaming_stft(int fft_size, int hop_size, int queue_frames) {
+    if (hop_size <= 0) hop_size = fft_size / 4;
+    if (hop_size > fft_size || queue_frames < 1) return nullptr;
+
+    StreamingSTFT* stft = (StreamingSTFT*)calloc(1, sizeof(StreamingSTFT));
+    if (!stft) return nullptr;
+
+    stft->plan = create_plan(fft_size);
+    stft->hop_size = hop_size;
+    stft->num_bins = fft_size / 2 + 1;
+    stft->ring = (float*)calloc(fft_size, sizeof(float));
+    stft->ring_mask = fft_size - 1;
+    stft->until_next_frame = fft_size;
+    stft->frame = (float*)malloc(fft_size * sizeof(float));
+    stft->bins = (float*)malloc(stft->num_bins * sizeof(float));
+    stft->queue_capacity = queue_frames;
+    stft->queue = (float*)malloc((size_t)queue_frames * stft->num_bins * sizeof(float));
+
+    if (!stft->plan || !stft->ring || !stft->frame || !stft->bins || !stft->queue) {
+        destroy_plan(stft->plan);
+        free(stft->ring); free(stft->frame); free(stft->bins); free(stft->queue);
+        free(stft);
+        return nullptr;
+    }
+
+    return stft;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_streaming_stft(StreamingSTFT* stft) {
+    if (!stft) return;
+    destroy_plan(stft->plan);
+    free(stft->ring); free(stft->frame); free(stft->bins); free(stft->queue);
+    free(stft);
+}
+
+/**
+ * Drop buffered audio and queued frames (e.g. after a seek)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+void reset_streaming_stft(StreamingSTFT* stft) {
+    if (!stft) return;
+    memset(stft->ring, 0, stft->plan->n * sizeof(float));
+    stft->write_pos = 0;
+    stft->until_next_frame = stft->plan->n;
+    stft->queue_head = 0;
+    stft->queue_count = 0;
+    stft->frames_emitted = 0;
+}
+
+/**
+ * Transform the most recent fft_size samples into stft->bins (dB)
+ */
+static void stft_compute_frame(StreamingSTFT* stft) {
+    int n = stft->plan->n;
+    int first = stft->write_pos; // oldest sample in the ring
+
+    memcpy(stft->frame, stft->ring + first, (n - first) * sizeof(float));
+    memcpy(stft->frame + (n - first), stft->ring, first * sizeof(float));
+
+    frame_power_db(stft->plan, stft->frame, stft->bins);
+}
+
+/**
+ * Deliver the frame that is due; false when the queue has no room for it
+ */
+static bool stft_emit_frame(StreamingSTFT* stft, stft_frame_callback callback, void* user_data) {
+    if (callback) {
+        stft_compute_frame(stft);
+        callback(stft->frames_emitted, stft->bins, stft->num_bins, user_data);
+    } else {
+        if (stft->queue_count >= stft->queue_capacity) return false;
+
+        stft_compute_frame(stft);
+        int slot = (stft->queue_head + stft->queue_count) % stft->queue_capacity;
+        memcpy(stft->queue + (size_t)slot * stft->num_bins, stft->bins, stft->num_bins * sizeof(float));
+        stft->queue_count++;
+    }
+
+    stft->frames_emitted++;
+    stft->until_next_frame = stft->hop_size;
+    return true;
+}
+
+/**
+ * Push a chunk of mono samples
+ * Each completed frame goes to `callback` when given, otherwise into the
+ * queue; with a full queue the push stops early so nothing is dropped.
+ * Returns number of samples consumed (call again with the remainder after pulling)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int stft_push_samples(StreamingSTFT* stft, float* samples, int count,
+                      stft_frame_callback callback, void* user_data) {
+    if (!stft || !samples || count < 0) return 0;
+
+    int consumed = 0;
+
+    while (true) {
+        // A frame is due (possibly left pending by an earlier full queue)
+        if (stft->until_next_frame == 0 && !stft_emit_frame(stft, callback, user_data)) break;
+        if (consumed == count) break;
+
+        int chunk = count - consumed;
+        if (chunk > stft->until_next_frame) chunk = stft->until_next_frame;
+
+        // Copy into the ring in at most two contiguous pieces
+        int space = stft->plan->n - stft->write_pos;
+        int first = (chunk < space) ? chunk : space;
+        memcpy(stft->ring + stft->write_pos, samples + consumed, first * sizeof(float));
+        memcpy(stft->ring, samples + consumed + first, (chunk - first) * sizeof(float));
+        stft->write_pos = (stft->write_pos + chunk) & stft->ring_mask;
+        stft->until_next_frame -= chunk;
+        consumed += chunk;
+    }
+
+    return consumed;
+}
+
+/**
+ * Pull up to max_frames queued frames (oldest first) into output
+ * output: max_frames * num_bins floats; returns number of frames copied
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int stft_pull_frames(StreamingSTFT* stft, float* output, int max_frames) {
+    if (!stft || !output || max_frames < 1) return 0;
+
+    int pulled = 0;
+    while (pulled < max_frames && stft->queue_count > 0) {
+        memcpy(output + (size_t)pulled * stft->num_bins,
+               stft->queue + (size_t)stft->queue_head * stft->num_bins,
+               stft->num_bins * sizeof(float));
+        stft->queue_head = (stft->queue_head + 1) % stft->queue_capacity;
+        stft->queue_count--;
+        pulled++;
+    }
+    return pulled;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int stft_queued_frames(StreamingSTFT* stft) {
+    return stft ? stft->queue_count : 0;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int stft_frames_emitted(StreamingSTFT* stft) {
+    return stft ? stft->frames_emitted : 0;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int stft_num_bins(StreamingSTFT* stft) {
+    return stft ? stft->num_bins : 0;
+}
+
+// ============================================================================
+// MEL FEATURES (log-mel filterbank / MFCC)
+// ============================================================================
+
+// Feature kinds
+static const int MEL_FEATURE_LOG_MEL = 0;    // num_filters log energies (dB)
+static const int MEL_FEATURE_MFCC = 1;       // num_ceps DCT-II coefficients of the log-mel frame
+
+/**
+ * Sparse triangular filterbank plus DCT matrix for one FFT size
+ * Each filter stores only its non-zero span, zero-padded to a multiple of
+ * DOT_LANES; scratch rows are padded the same way so no loop needs a tail.
+ */
+struct MelFilterbank {
+    FFTPlan* plan;
+    int num_bins;
+    int num_filters;
+    int num_ceps;
+    int filter_stride;      // num_filters rounded up to DOT_LANES
+    int* filter_start;      // first FFT bin of each filter
+    int* filter_length;     // padded span length
+    int* weight_offset;     // into weights
+    float* weights;
+    float* dct;             // num_ceps x filter_stride
+    float* power;           // num_bins + DOT_LANES scratch
+    float* log_mel;         // filter_stride scratch
+    float* frame;           // max(num_filters, num_ceps) scratch
+    float quant_min[2];
+    float quant_max[2];
+};
+
+static inline float hz_to_mel(float hz) { return 2595.0f * log10f(1.0f + hz / 700.0f); }
+static inline float mel_to_hz(float mel) { return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f); }
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_mel_filterbank(MelFilterbank* bank) {
+    if (!bank) return;
+    destroy_plan(bank->plan);
+    free(bank->filter_start); free(bank->filter_length); free(bank->weight_offset);
+    free(bank->weights); free(bank->dct);
+    free(bank->power); free(bank->log_mel); free(bank->frame);
+    free(bank);
+}
+
+/**
+ * Build a mel filterbank (HTK mel scale, unit-peak triangles) for fft_size
+ * fmax <= 0 means sample_rate / 2; num_ceps is only used for MFCC output
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+MelFilterbank* create_mel_filterbank(int fft_size, int sample_rate, int num_filters,
+                                     float fmin, float fmax, int num_ceps) {
+    int num_bins = fft_size / 2 + 1;
+    if (fmax <= 0.0f || fmax > sample_rate * 0.5f) fmax = sample_rate * 0.5f;
+    if (fft_size < 64 || sample_rate < 1 || num_filters < 1 || num_filters > num_bins) return nullptr;
+    if (fmin < 0.0f || fmin >= fmax || num_ceps < 1 || num_ceps > num_filters) return nullptr;
+
+    MelFilterbank* bank = (MelFilterbank*)calloc(1, sizeof(MelFilterbank));
+    if (!bank) return nullptr;
+
+    bank->plan = create_plan(fft_size);
+    bank->num_bins = num_bins;
+    bank->num_filters = num_filters;
+    bank->num_ceps = num_ceps;
+    bank->filter_stride = (num_filters + DOT_LANES - 1) / DOT_LANES * DOT_LANES;
+    bank->filter_start = (int*)malloc(num_filters * sizeof(int));
+    bank->filter_length = (int*)malloc(num_filters * sizeof(int));
+    bank->weight_offset = (int*)malloc(num_filters * sizeof(int));
+    bank->dct = (float*)calloc((size_t)num_ceps * bank->filter_stride, sizeof(float));
+    bank->power = (float*)calloc(num_bins + DOT_LANES, sizeof(float));
+    bank->log_mel = (float*)calloc(bank->filter_stride, sizeof(float));
+    bank->frame = (float*)malloc(num_filters * sizeof(float));
+
+    if (!bank->plan || !bank->filter_start || !bank->filter_length || !bank->weight_offset ||
+        !bank->dct || !bank->power || !bank->log_mel || !bank->frame) {
+        destroy_mel_filterbank(bank);
+        return nullptr;
+    }
+
+    // Filter edges equally spaced on the mel scale; weights evaluated at bin centres
+    float mel_lo = hz_to_mel(fmin);
+    float mel_step = (hz_to_mel(fmax) - mel_lo) / (num_filters + 1);
+    float bin_hz = (float)sample_rate / fft_size;
+
+    int total = 0;
+    for (int f = 0; f < num_filters; f++) {
+        float lo = mel_to_hz(mel_lo + mel_step * f);
+        float hi = mel_to_hz(mel_lo + mel_step * (f + 2));
+        int start = (int)ceilf(lo / bin_hz);
+        int end = (int)floorf(hi / bin_hz);
+        if (end >= num_bins) end = num_bins - 1;
+        if (end < start) end = start;   // narrow low filters still get their nearest bin
+
+        int length = (end - start + 1 + DOT_LANES - 1) / DOT_LANES * DOT_LANES;
+        bank->filter_start[f] = start;
+        bank->filter_length[f] = length;
+        bank->weight_offset[f] = total;
+        total += length;
+    }
+
+    bank->weights = (float*)calloc(total, sizeof(float));
+    if (!bank->weights) { destroy_mel_filterbank(bank); return nullptr; }
+
+    for (int f = 0; f < num_filters; f++) {
+        float lo = mel_to_hz(mel_lo + mel_step * f);
+        float centre = mel_to_hz(mel_lo + mel_step * (f + 1));
+        float hi = mel_to_hz(mel_lo + mel_step * (f + 2));
+        float* w = bank->weights + bank->weight_offset[f];
+
+        float peak = 0.0f;
+        for (int i = 0; i < bank->filter_length[f]; i++) {
+            int bin = bank->filter_start[f] + i;
+            if (bin >= num_bins) break;
+            float hz = bin * bin_hz;
+            float v = (hz <= centre) ? (hz - lo) / (centre - lo) : (hi - hz) / (hi - centre);
+            w[i] = (v > 0.0f) ? v : 0.0f;
+            if (w[i] > peak) peak = w[i];
+        }
+        if (peak == 0.0f) w[0] = 1.0f; // filter narrower than a bin
+    }
+
+    // Orthonormal DCT-II
+    for (int k = 0; k < num_ceps; k++) {
+        float scale = (k == 0) ? sqrtf(1.0f / num_filters) : sqrtf(2.0f / num_filters);
+        for (int m = 0; m < num_filters; m++) {
+            bank->dct[(size_t)k * bank->filter_stride + m] =
+                scale * cosf((float)M_PI / num_filters * (m + 0.5f) * k);
+        }
+    }
+
+    bank->quant_min[MEL_FEATURE_LOG_MEL] = -80.0f;
+    bank->quant_max[MEL_FEATURE_LOG_MEL] = 60.0f;
+    bank->quant_min[MEL_FEATURE_MFCC] = -200.0f;
+    bank->quant_max[MEL_FEATURE_MFCC] = 200.0f;
+    return bank;
+}
+
+/**
+ * Value range mapped onto 0-255 by FEATURE_FORMAT_U8 for one feature kind
+ * Defaults: log-mel [-80, 60] dB, MFCC [-200, 200]
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int mel_set_quantization_range(MelFilterbank* bank, int kind, float min_value, float max_value) {
+    if (!bank || (kind != MEL_FEATURE_LOG_MEL && kind != MEL_FEATURE_MFCC) || max_value <= min_value) return 0;
+    bank->quant_min[kind] = min_value;
+    bank->quant_max[kind] = max_value;
+    return 1;
+}
+
+static inline int mel_feature_dims(const MelFilterbank* bank, int kind) {
+    return (kind == MEL_FEATURE_MFCC) ? bank->num_ceps : bank->num_filters;
+}
+
+/**
+ * Output buffer size in bytes for compute_mel_features
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int get_mel_features_size(MelFilterbank* bank, int sample_count, int kind, int format) {
+    if (!bank || sample_count < bank->plan->n) return 0;
+    int frames = get_spectrogram_frames(sample_count, bank->plan->n);
+    return frames * mel_feature_dims(bank, kind) * feature_format_bytes(format);
+}
+
+/**
+ * Log-mel (dB) or MFCC frames with the spectrogram's framing (hop fft_size / 4)
+ * output: frames x dims elements in the requested format, row-major
+ * Returns number of frames written
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int compute_mel_features(MelFilterbank* bank, float* audio_samples, int sample_count,
+                         int kind, int format, void* output) {
+    if (!bank || !audio_samples || !output || sample_count < bank->plan->n) return 0;
+    if (kind != MEL_FEATURE_LOG_MEL && kind != MEL_FEATURE_MFCC) return 0;
+    if (format < FEATURE_FORMAT_F32 || format > FEATURE_FORMAT_U8) return 0;
+
+    int hop_size = bank->plan->n / 4;
+    int num_frames = get_spectrogram_frames(sample_count, bank->plan->n);
+    int dims = mel_feature_dims(bank, kind);
+    float q_min = bank->quant_min[kind];
+    float q_scale = 255.0f / (bank->quant_max[kind] - q_min);
+
+    for (int frame = 0; frame < num_frames; frame++) {
+        frame_power_spectrum(bank->plan, audio_samples + (size_t)frame * hop_size, bank->power);
+
+        for (int f = 0; f < bank->num_filters; f++) {
+            float energy = lane_dot(bank->weights + bank->weight_offset[f],
+                                    bank->power + bank->filter_start[f], bank->filter_length[f]);
+            bank->log_mel[f] = 10.0f * log10f(fmaxf(energy, 1e-10f));
+        }
+
+        const float* values = bank->log_mel;
+        if (kind == MEL_FEATURE_MFCC) {
+            for (int k = 0; k < bank->num_ceps; k++) {
+                bank->frame[k] = lane_dot(bank->dct + (size_t)k * bank->filter_stride,
+                                          bank->log_mel, bank->filter_stride);
+            }
+            values = bank->frame;
+        }
+
+        size_t base = (size_t)frame * dims;
+        if (format == FEATURE_FORMAT_F32) {
+            memcpy((float*)output + base, values, dims * sizeof(float));
+        } else if (format == FEATURE_FORMAT_F16) {
+            uint16_t* out = (uint16_t*)output + base;
+            for (int d = 0; d < dims; d++) out[d] = float_to_half(values[d]);
+        } else {
+            uint8_t* out = (uint8_t*)output + base;
+            for (int d = 0; d < dims; d++) out[d] = quantize_u8(values[d], q_min, q_scale);
+        }
+    }
+
+    return num_frames;
+}
+
+// ============================================================================
+// AUDIO FINGERPRINTING
+// ============================================================================
+
+/**
+ * Compute audio fingerprint hash
+ * Uses spectral peak picking similar to Shazam algorithm
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint32_t compute_audio_fingerprint(float* spectrogram, int num_frames, int num_bins) {
+    if (!spectrogram || num_frames < 1 || num_bins < 1) return 0;
+    
+    uint32_t fingerprint = 0;
+    
+    // Find peaks in each frequency band and encode
+    int bands[] = {0, 10, 20, 40, 80, 160, 320};
+    int num_bands = 6;
+    
+    for (int frame = 0; frame < num_frames && frame < 32; frame++) {
+        for (int band = 0; band < num_bands && band < 5; band++) {
+            int start = bands[band];
+            int end = (bands[band + 1] < num_bins) ? bands[band + 1] : num_bins;
+            
+            float max_val = -1000.0f;
+            for (int i = start; i < end; i++) {
                 if (spectrogram[frame * num_bins + i] > max_val) {
                     max_val = spectrogram[frame * num_bins + i];
                 }
@@ -170,9 +1264,103 @@ uint32_t compute_audio_fingerprint(float* spectrogram, int num_frames, int num_b
     return fingerprint;
 }
 
+/**
+ * Integer key of a compact spectrogram cell, increasing with its dB value
+ * (sign-flipped IEEE bits for F32 / F16, the code itself for U8)
+ */
+static inline int64_t spectrogram_cell_key(const void* spectrogram, int format, size_t i) {
+    if (format == FEATURE_FORMAT_F32) {
+        uint32_t bits;
+        memcpy(&bits, (const float*)spectrogram + i, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    }
+    if (format == FEATURE_FORMAT_F16) {
+        uint16_t bits = ((const uint16_t*)spectrogram)[i];
+        return (bits & 0x8000) ? (uint16_t)~bits : bits | 0x8000;
+    }
+    return ((const uint8_t*)spectrogram)[i];
+}
+
+/**
+ * Largest cell key whose decoded value is <= db (-1 when every cell is above it)
+ */
+static int64_t spectrogram_threshold_key(float db, int format, float min_db, float max_db) {
+    if (format == FEATURE_FORMAT_F32) return spectrogram_cell_key(&db, format, 0);
+    if (format == FEATURE_FORMAT_F16) {
+        uint16_t half = float_to_half(db);      // exact for whole dB values
+        return spectrogram_cell_key(&half, format, 0);
+    }
+
+    float step = (max_db - min_db) / 255.0f;
+    int64_t key = -1;
+    for (int code = 0; code < 256 && min_db + code * step <= db; code++) key = code;
+    return key;
+}
+
+/**
+ * compute_audio_fingerprint over a compact spectrogram
+ * Band maxima are taken and thresholded on the stored cells (the -30 dB
+ * threshold is encoded once), so nothing is decoded
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint32_t compute_audio_fingerprint_quantized(void* spectrogram, int num_frames, int num_bins,
+                                             int format, float min_db, float max_db) {
+    if (!spectrogram || num_frames < 1 || num_bins < 1) return 0;
+    if (format < FEATURE_FORMAT_F32 || format > FEATURE_FORMAT_U8) return 0;
+
+    int64_t threshold = spectrogram_threshold_key(-30.0f, format, min_db, max_db);
+    int bands[] = {0, 10, 20, 40, 80, 160};
+    uint32_t fingerprint = 0;
+
+    for (int frame = 0; frame < num_frames && frame < 32; frame++) {
+        size_t row = (size_t)frame * num_bins;
+        for (int band = 0; band < 5; band++) {
+            int end = (bands[band + 1] < num_bins) ? bands[band + 1] : num_bins;
+
+            int64_t max_key = -1;
+            for (int i = bands[band]; i < end; i++) {
+                int64_t key = spectrogram_cell_key(spectrogram, format, row + i);
+                if (key > max_key) max_key = key;
+            }
+            // Bit 32 (frame 7, band 4) wraps to bit 0, as the float version's shift does on wasm
+            if (max_key > threshold) fingerprint |= 1u << (((frame % 8) * 4 + band) & 31);
+        }
+    }
+
+    return fingerprint;
+}
+
+/**
+ * compute_audio_fingerprint straight from decoded audio
+ * Interleaved samples at sample_rate are downmixed and resampled to
+ * ANALYSIS_SAMPLE_RATE first, so the STFT runs over 4-8x fewer samples;
+ * fft_size <= 0 uses 1024
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint32_t compute_audio_fingerprint_from_audio(float* samples, int frames, int channels, int sample_rate,
+                                              int fft_size) {
+    if (fft_size <= 0) fft_size = 1024;
+
+    int length = 0;
+    float* audio = analysis_audio(samples, frames, channels, sample_rate, ANALYSIS_SAMPLE_RATE, &length);
+    if (!audio) return 0;
+
+    uint32_t fingerprint = 0;
+    float* spectrogram = compute_audio_spectrogram(audio, length, fft_size);
+    if (spectrogram) {
+        fingerprint = compute_audio_fingerprint(spectrogram, get_spectrogram_frames(length, fft_size),
+                                                get_spectrogram_bins(fft_size));
+        free(spectrogram);
+    }
+
+    if (audio != samples) free(audio);
+    return fingerprint;
+}
+
 /**
  * Match intro fingerprint against database
  * Returns index of best match or -1 if no match
+ * Legacy 32-bit summary; use extract_landmarks + landmark_index_query for matching at scale
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
 int match_intro_fingerprint(float* spectrogram, float* intro_db, int db_size) {
@@ -195,127 +1383,1584 @@ int match_intro_fingerprint(float* spectrogram, float* intro_db, int db_size) {
             matches += xor_result & 1;
             xor_result >>= 1;
         }
-        
-        if (matches > best_score && matches > 20) { // Threshold
-            best_score = matches;
-            best_match = i;
+        
+        if (matches > best_score && matches > 20) { // Threshold
+            best_score = matches;
+            best_match = i;
+        }
+    }
+    
+    return best_match;
+}
+
+// ============================================================================
+// LANDMARK FINGERPRINTING (constellation pairs)
+// ============================================================================
+
+// Peak picking neighbourhood and density
+static const int PEAK_FREQ_RADIUS = 8;      // bins
+static const int PEAK_TIME_RADIUS = 4;      // frames
+static const int MAX_PEAKS_PER_FRAME = 5;
+static const float PEAK_MIN_PROMINENCE = 6.0f; // dB above the frame mean
+
+// Target zone for anchor -> target pairs
+static const int TARGET_MAX_DT = 63;        // frames (6-bit field)
+static const int TARGET_MAX_DF = 64;        // bins
+static const int TARGET_FAN_OUT = 5;
+
+static const int QUANTIZED_CHUNK_FRAMES = 1024;  // frames decoded at a time from compact spectrograms
+
+struct SpectralPeak {
+    int frame;
+    int bin;
+    float value;
+};
+
+/**
+ * Pick local maxima of a dB spectrogram
+ * A peak is the maximum of its (2*PEAK_TIME_RADIUS+1) x (2*PEAK_FREQ_RADIUS+1)
+ * neighbourhood and clears the frame mean by PEAK_MIN_PROMINENCE; at most
+ * MAX_PEAKS_PER_FRAME strongest peaks are kept per frame, in (frame, bin) order.
+ * Only frames in [begin, end) are picked; the rest act as neighbourhood, so a
+ * long signal can be processed in chunks with PEAK_TIME_RADIUS frames of halo.
+ * Returns peak count, or -1 on allocation failure
+ */
+static int pick_spectral_peaks(const float* spectrogram, int num_frames, int num_bins,
+                               int begin, int end, SpectralPeak* peaks) {
+    // Frequency-dilated maxima, so the time check is one compare per neighbour frame
+    float* fmax = (float*)malloc(((size_t)num_frames + 2) * num_bins * sizeof(float));
+    if (!fmax) return -1;
+
+    // van Herk / Gil-Werman running max: block prefix (g) and suffix (h) maxima
+    // give any full W-bin window in two lookups, independent of the radius
+    const int W = 2 * PEAK_FREQ_RADIUS + 1;
+    float* g = fmax + (size_t)num_frames * num_bins;
+    float* h = g + num_bins;
+
+    for (int t = 0; t < num_frames; t++) {
+        const float* row = spectrogram + (size_t)t * num_bins;
+        float* out = fmax + (size_t)t * num_bins;
+
+        for (int bs = 0; bs < num_bins; bs += W) {
+            int be = (bs + W < num_bins) ? bs + W : num_bins;
+            g[bs] = row[bs];
+            for (int b = bs + 1; b < be; b++) g[b] = fmaxf(g[b - 1], row[b]);
+            h[be - 1] = row[be - 1];
+            for (int b = be - 2; b >= bs; b--) h[b] = fmaxf(h[b + 1], row[b]);
+        }
+
+        for (int b = PEAK_FREQ_RADIUS; b < num_bins - PEAK_FREQ_RADIUS; b++) {
+            out[b] = fmaxf(h[b - PEAK_FREQ_RADIUS], g[b + PEAK_FREQ_RADIUS]);
+        }
+
+        // Clipped windows at both ends
+        for (int b = 0; b < num_bins; b++) {
+            if (b >= PEAK_FREQ_RADIUS && b < num_bins - PEAK_FREQ_RADIUS) continue;
+            int lo = (b - PEAK_FREQ_RADIUS < 0) ? 0 : b - PEAK_FREQ_RADIUS;
+            int hi = (b + PEAK_FREQ_RADIUS >= num_bins) ? num_bins - 1 : b + PEAK_FREQ_RADIUS;
+            float m = row[lo];
+            for (int k = lo + 1; k <= hi; k++) m = fmaxf(m, row[k]);
+            out[b] = m;
+        }
+    }
+
+    int count = 0;
+
+    for (int t = begin; t < end; t++) {
+        const float* row = spectrogram + (size_t)t * num_bins;
+
+        float mean = 0.0f;
+        for (int b = 0; b < num_bins; b++) mean += row[b];
+        mean /= num_bins;
+
+        int t_lo = (t - PEAK_TIME_RADIUS < 0) ? 0 : t - PEAK_TIME_RADIUS;
+        int t_hi = (t + PEAK_TIME_RADIUS >= num_frames) ? num_frames - 1 : t + PEAK_TIME_RADIUS;
+
+        SpectralPeak best[MAX_PEAKS_PER_FRAME];
+        int kept = 0;
+
+        for (int b = 0; b < num_bins; b++) {
+            float v = row[b];
+            if (v < mean + PEAK_MIN_PROMINENCE || v < fmax[(size_t)t * num_bins + b]) continue;
+
+            // Plateaus (common in quantized input) keep only their earliest,
+            // lowest-bin cell: ties lose to earlier frames and lower bins
+            bool is_peak = true;
+            for (int u = t_lo; u <= t_hi && is_peak; u++) {
+                float other = fmax[(size_t)u * num_bins + b];
+                if (u < t ? other >= v : (u > t && other > v)) is_peak = false;
+            }
+            for (int k = (b - PEAK_FREQ_RADIUS > 0 ? b - PEAK_FREQ_RADIUS : 0); k < b && is_peak; k++) {
+                if (row[k] == v) is_peak = false;
+            }
+            if (!is_peak) continue;
+
+            // Keep the strongest peaks of this frame (small insertion list)
+            if (kept < MAX_PEAKS_PER_FRAME) {
+                best[kept++] = { t, b, v };
+            } else {
+                int weakest = 0;
+                for (int k = 1; k < kept; k++) if (best[k].value < best[weakest].value) weakest = k;
+                if (v > best[weakest].value) best[weakest] = { t, b, v };
+            }
+        }
+
+        // Emit in ascending bin order
+        for (int i = 1; i < kept; i++) {
+            SpectralPeak p = best[i];
+            int j = i - 1;
+            while (j >= 0 && best[j].bin > p.bin) { best[j + 1] = best[j]; j--; }
+            best[j + 1] = p;
+        }
+        for (int i = 0; i < kept; i++) peaks[count++] = best[i];
+    }
+
+    free(fmax);
+    return count;
+}
+
+/**
+ * Hash an anchor/target pair: f1 (10 bits) | f2 (10 bits) | dt (6 bits)
+ */
+static inline uint32_t landmark_hash(int f1, int f2, int dt, int bin_shift) {
+    return ((uint32_t)(f1 >> bin_shift) & 0x3FF) << 16 |
+           ((uint32_t)(f2 >> bin_shift) & 0x3FF) << 6 |
+           ((uint32_t)dt & 0x3F);
+}
+
+/**
+ * Frequency quantization so hashes keep 10-bit fields regardless of FFT size
+ */
+static inline int landmark_bin_shift(int num_bins) {
+    int bin_shift = 0;
+    while ((num_bins >> bin_shift) > 1024) bin_shift++;
+    return bin_shift;
+}
+
+/**
+ * Pair each anchor peak with up to TARGET_FAN_OUT later peaks in its target zone
+ * peaks must be in ascending frame order; writes (hash, anchor_frame) pairs
+ */
+static int pair_landmarks(const SpectralPeak* peaks, int peak_count, int bin_shift,
+                          uint32_t* output, int max_landmarks) {
+    int written = 0;
+
+    for (int i = 0; i < peak_count && written < max_landmarks; i++) {
+        const SpectralPeak& anchor = peaks[i];
+        int paired = 0;
+
+        for (int j = i + 1; j < peak_count && paired < TARGET_FAN_OUT && written < max_landmarks; j++) {
+            int dt = peaks[j].frame - anchor.frame;
+            if (dt > TARGET_MAX_DT) break;
+            if (dt < 1) continue;
+
+            int df = peaks[j].bin - anchor.bin;
+            if (df < -TARGET_MAX_DF || df > TARGET_MAX_DF) continue;
+
+            output[written * 2] = landmark_hash(anchor.bin, peaks[j].bin, dt, bin_shift);
+            output[written * 2 + 1] = (uint32_t)anchor.frame;
+            written++;
+            paired++;
+        }
+    }
+
+    return written;
+}
+
+/**
+ * Extract landmark hashes from a dB spectrogram
+ * output: up to max_landmarks (hash, anchor_frame) uint32 pairs
+ * Returns number of landmarks written
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int extract_landmarks(float* spectrogram, int num_frames, int num_bins, uint32_t* output, int max_landmarks) {
+    if (!spectrogram || !output || num_frames < 1 || num_bins < 2 || max_landmarks < 1) return 0;
+
+    SpectralPeak* peaks = (SpectralPeak*)malloc((size_t)num_frames * MAX_PEAKS_PER_FRAME * sizeof(SpectralPeak));
+    if (!peaks) return 0;
+
+    int peak_count = pick_spectral_peaks(spectrogram, num_frames, num_bins, 0, num_frames, peaks);
+    if (peak_count < 0) { free(peaks); return 0; }
+
+    int written = pair_landmarks(peaks, peak_count, landmark_bin_shift(num_bins), output, max_landmarks);
+
+    free(peaks);
+    return written;
+}
+
+/**
+ * extract_landmarks over a compact spectrogram
+ * Chunks of QUANTIZED_CHUNK_FRAMES frames (plus PEAK_TIME_RADIUS halo) are
+ * decoded at a time, so the float working set stays bounded
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int extract_landmarks_quantized(void* spectrogram, int num_frames, int num_bins, int format,
+                                float min_db, float max_db, uint32_t* output, int max_landmarks) {
+    if (!spectrogram || !output || num_frames < 1 || num_bins < 2 || max_landmarks < 1) return 0;
+
+    int halo = PEAK_TIME_RADIUS;
+    float* decoded = (float*)malloc((size_t)(QUANTIZED_CHUNK_FRAMES + 2 * halo) * num_bins * sizeof(float));
+    SpectralPeak* peaks = (SpectralPeak*)malloc((size_t)num_frames * MAX_PEAKS_PER_FRAME * sizeof(SpectralPeak));
+    bool ok = decoded && peaks;
+    int peak_count = 0;
+
+    for (int c0 = 0; c0 < num_frames && ok; c0 += QUANTIZED_CHUNK_FRAMES) {
+        int c1 = (c0 + QUANTIZED_CHUNK_FRAMES < num_frames) ? c0 + QUANTIZED_CHUNK_FRAMES : num_frames;
+        int f0 = (c0 - halo > 0) ? c0 - halo : 0;
+        int f1 = (c1 + halo < num_frames) ? c1 + halo : num_frames;
+
+        decode_spectrogram_cells(spectrogram, format, min_db, max_db, (size_t)f0 * num_bins,
+                                 (size_t)(f1 - f0) * num_bins, decoded);
+        int picked = pick_spectral_peaks(decoded, f1 - f0, num_bins, c0 - f0, c1 - f0, peaks + peak_count);
+        if (picked < 0) { ok = false; break; }
+
+        for (int p = peak_count; p < peak_count + picked; p++) peaks[p].frame += f0;
+        peak_count += picked;
+    }
+
+    int written = ok ? pair_landmarks(peaks, peak_count, landmark_bin_shift(num_bins), output, max_landmarks) : 0;
+
+    free(decoded);
+    free(peaks);
+    return written;
+}
+
+/**
+ * extract_landmarks straight from decoded audio
+ * Interleaved samples at sample_rate are downmixed and resampled to
+ * ANALYSIS_SAMPLE_RATE first, which also keeps landmark time/frequency
+ * units identical across sources of different rates; fft_size <= 0 uses 1024
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int extract_landmarks_from_audio(float* samples, int frames, int channels, int sample_rate, int fft_size,
+                                 uint32_t* output, int max_landmarks) {
+    if (!output || max_landmarks < 1) return 0;
+    if (fft_size <= 0) fft_size = 1024;
+
+    int length = 0;
+    float* audio = analysis_audio(samples, frames, channels, sample_rate, ANALYSIS_SAMPLE_RATE, &length);
+    if (!audio) return 0;
+
+    int written = 0;
+    float* spectrogram = compute_audio_spectrogram(audio, length, fft_size);
+    if (spectrogram) {
+        written = extract_landmarks(spectrogram, get_spectrogram_frames(length, fft_size),
+                                    get_spectrogram_bins(fft_size), output, max_landmarks);
+        free(spectrogram);
+    }
+
+    if (audio != samples) free(audio);
+    return written;
+}
+
+// ============================================================================
+// LANDMARK INVERTED INDEX
+// ============================================================================
+
+/**
+ * Hash -> (track, offset) index
+ * Landmarks are staged with landmark_index_add_track, then landmark_index_build
+ * groups them into power-of-two hash buckets (CSR layout) so a query is one
+ * bucket scan per landmark.
+ */
+struct LandmarkIndex {
+    uint32_t* hashes;
+    int* tracks;
+    int* offsets;
+    int count;
+    int capacity;
+    int* bucket_start;      // bucket_mask + 2 entries after build
+    uint32_t bucket_mask;
+    bool built;
+};
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+LandmarkIndex* create_landmark_index() {
+    return (LandmarkIndex*)calloc(1, sizeof(LandmarkIndex));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_landmark_index(LandmarkIndex* index) {
+    if (!index) return;
+    free(index->hashes); free(index->tracks); free(index->offsets);
+    free(index->bucket_start);
+    free(index);
+}
+
+/**
+ * Stage a track's landmarks ((hash, frame) pairs from extract_landmarks)
+ * Invalidates a previous build; returns total staged entries or -1 on failure
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int landmark_index_add_track(LandmarkIndex* index, int track_id, uint32_t* landmarks, int count) {
+    if (!index || !landmarks || count < 0) return -1;
+
+    if (index->count + count > index->capacity) {
+        int capacity = index->capacity ? index->capacity : 1024;
+        while (capacity < index->count + count) capacity *= 2;
+
+        uint32_t* hashes = (uint32_t*)realloc(index->hashes, capacity * sizeof(uint32_t));
+        if (hashes) index->hashes = hashes;
+        int* tracks = (int*)realloc(index->tracks, capacity * sizeof(int));
+        if (tracks) index->tracks = tracks;
+        int* offsets = (int*)realloc(index->offsets, capacity * sizeof(int));
+        if (offsets) index->offsets = offsets;
+        if (!hashes || !tracks || !offsets) return -1;
+
+        index->capacity = capacity;
+    }
+
+    for (int i = 0; i < count; i++) {
+        index->hashes[index->count] = landmarks[i * 2];
+        index->tracks[index->count] = track_id;
+        index->offsets[index->count] = (int)landmarks[i * 2 + 1];
+        index->count++;
+    }
+
+    index->built = false;
+    return index->count;
+}
+
+static inline uint32_t landmark_bucket(uint32_t hash, uint32_t mask) {
+    // Mix so the dt field does not dominate low bits
+    hash ^= hash >> 15;
+    hash *= 0x2C1B3C6Du;
+    hash ^= hash >> 12;
+    return hash & mask;
+}
+
+/**
+ * Group staged entries by hash bucket (counting sort)
+ * Returns 1 on success
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int landmark_index_build(LandmarkIndex* index) {
+    if (!index) return 0;
+
+    uint32_t buckets = 1024;
+    while (buckets < (uint32_t)index->count / 2) buckets <<= 1;
+
+    int* start = (int*)calloc(buckets + 1, sizeof(int));
+    uint32_t* hashes = (uint32_t*)malloc((index->count + 1) * sizeof(uint32_t));
+    int* tracks = (int*)malloc((index->count + 1) * sizeof(int));
+    int* offsets = (int*)malloc((index->count + 1) * sizeof(int));
+
+    if (!start || !hashes || !tracks || !offsets) {
+        free(start); free(hashes); free(tracks); free(offsets);
+        return 0;
+    }
+
+    uint32_t mask = buckets - 1;
+    for (int i = 0; i < index->count; i++) start[landmark_bucket(index->hashes[i], mask) + 1]++;
+    for (uint32_t b = 0; b < buckets; b++) start[b + 1] += start[b];
+
+    int* fill = (int*)malloc(buckets * sizeof(int));
+    if (!fill) {
+        free(start); free(hashes); free(tracks); free(offsets);
+        return 0;
+    }
+    memcpy(fill, start, buckets * sizeof(int));
+
+    for (int i = 0; i < index->count; i++) {
+        int pos = fill[landmark_bucket(index->hashes[i], mask)]++;
+        hashes[pos] = index->hashes[i];
+        tracks[pos] = index->tracks[i];
+        offsets[pos] = index->offsets[i];
+    }
+    free(fill);
+
+    free(index->hashes); free(index->tracks); free(index->offsets);
+    free(index->bucket_start);
+    index->hashes = hashes;
+    index->tracks = tracks;
+    index->offsets = offsets;
+    index->capacity = index->count + 1;
+    index->bucket_start = start;
+    index->bucket_mask = mask;
+    index->built = true;
+    return 1;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int landmark_index_size(LandmarkIndex* index) {
+    return index ? index->count : 0;
+}
+
+/**
+ * Open-addressing (track, offset) -> votes table, grown at half load
+ */
+struct OffsetVoteTable {
+    uint64_t* keys;
+    int* votes;
+    uint32_t mask;
+    uint32_t used;
+};
+
+static const uint64_t VOTE_EMPTY = ~0ULL;
+
+static inline uint64_t vote_key(int track, int offset) {
+    return (uint64_t)(uint32_t)track << 32 | (uint32_t)offset;
+}
+
+static bool vote_table_init(OffsetVoteTable* table, uint32_t slots) {
+    table->keys = (uint64_t*)malloc(slots * sizeof(uint64_t));
+    table->votes = (int*)calloc(slots, sizeof(int));
+    table->mask = slots - 1;
+    table->used = 0;
+    if (!table->keys || !table->votes) {
+        free(table->keys); free(table->votes);
+        table->keys = nullptr; table->votes = nullptr;
+        return false;
+    }
+    for (uint32_t s = 0; s < slots; s++) table->keys[s] = VOTE_EMPTY;
+    return true;
+}
+
+static void vote_table_free(OffsetVoteTable* table) {
+    free(table->keys);
+    free(table->votes);
+    table->keys = nullptr;
+    table->votes = nullptr;
+}
+
+static inline uint32_t vote_slot(uint64_t key, uint32_t mask) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+static bool vote_table_add(OffsetVoteTable* table, uint64_t key, int votes) {
+    if ((table->used + 1) * 2 > table->mask + 1) {
+        OffsetVoteTable grown;
+        if (!vote_table_init(&grown, (table->mask + 1) * 2)) return false;
+        for (uint32_t s = 0; s <= table->mask; s++) {
+            if (table->keys[s] == VOTE_EMPTY) continue;
+            uint32_t t = vote_slot(table->keys[s], grown.mask);
+            while (grown.keys[t] != VOTE_EMPTY) t = (t + 1) & grown.mask;
+            grown.keys[t] = table->keys[s];
+            grown.votes[t] = table->votes[s];
+        }
+        grown.used = table->used;
+        vote_table_free(table);
+        *table = grown;
+    }
+
+    uint32_t s = vote_slot(key, table->mask);
+    while (table->keys[s] != VOTE_EMPTY && table->keys[s] != key) s = (s + 1) & table->mask;
+    if (table->keys[s] == VOTE_EMPTY) {
+        table->keys[s] = key;
+        table->used++;
+    }
+    table->votes[s] += votes;
+    return true;
+}
+
+/**
+ * Match query landmarks against the index by offset-histogram voting
+ * Every hash hit votes for (track, index_frame - query_frame); aligned
+ * matches pile up on one offset. Writes up to max_results best
+ * (track, offset, votes) triples with votes >= min_votes, strongest first.
+ * Returns number of results (0 if the index is not built)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int landmark_index_query(LandmarkIndex* index, uint32_t* landmarks, int count, int min_votes,
+                         int* out_tracks, int* out_offsets, int* out_votes, int max_results) {
+    if (!index || !index->built || !landmarks || count < 1 || max_results < 1) return 0;
+    if (!out_tracks || !out_offsets || !out_votes) return 0;
+
+    OffsetVoteTable table;
+    if (!vote_table_init(&table, 1024)) return 0;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t hash = landmarks[i * 2];
+        int query_frame = (int)landmarks[i * 2 + 1];
+        uint32_t b = landmark_bucket(hash, index->bucket_mask);
+
+        for (int e = index->bucket_start[b]; e < index->bucket_start[b + 1]; e++) {
+            if (index->hashes[e] != hash) continue;
+            if (!vote_table_add(&table, vote_key(index->tracks[e], index->offsets[e] - query_frame), 1)) {
+                vote_table_free(&table);
+                return 0;
+            }
+        }
+    }
+
+    // Best offset per track, then keep the top max_results tracks
+    int found = 0;
+    for (uint32_t s = 0; s <= table.mask; s++) {
+        if (table.keys[s] == VOTE_EMPTY || table.votes[s] < min_votes) continue;
+
+        int track = (int)(table.keys[s] >> 32);
+        int offset = (int)(uint32_t)table.keys[s];
+        int v = table.votes[s];
+
+        int existing = -1;
+        for (int r = 0; r < found; r++) if (out_tracks[r] == track) { existing = r; break; }
+
+        if (existing >= 0) {
+            if (v <= out_votes[existing]) continue;
+            // Remove and re-insert in order below
+            for (int r = existing; r < found - 1; r++) {
+                out_tracks[r] = out_tracks[r + 1];
+                out_offsets[r] = out_offsets[r + 1];
+                out_votes[r] = out_votes[r + 1];
+            }
+            found--;
+        } else if (found == max_results && v <= out_votes[found - 1]) {
+            continue;
+        }
+
+        int pos = (found < max_results) ? found++ : found - 1;
+        while (pos > 0 && out_votes[pos - 1] < v) {
+            out_tracks[pos] = out_tracks[pos - 1];
+            out_offsets[pos] = out_offsets[pos - 1];
+            out_votes[pos] = out_votes[pos - 1];
+            pos--;
+        }
+        out_tracks[pos] = track;
+        out_offsets[pos] = offset;
+        out_votes[pos] = v;
+    }
+
+    vote_table_free(&table);
+    return found;
+}
+
+// ============================================================================
+// CROSS-EPISODE SEGMENT DETECTION (intro / recap / credits)
+// ============================================================================
+
+// Search windows and segment rules (seconds unless noted)
+static const float SERIES_DEFAULT_HEAD_SECONDS = 600.0f;
+static const float SERIES_DEFAULT_TAIL_SECONDS = 300.0f;
+static const float SERIES_DEFAULT_MIN_SEGMENT = 10.0f;
+static const int SERIES_MAX_GAP_SECONDS = 2;
+static const int SERIES_CHUNK_FRAMES = 1024;        // spectrogram frames per chunk
+static const int SERIES_OFFSETS_PER_PAIR = 4;       // distinct alignments kept per episode pair
+static const int SERIES_MIN_AUDIO_VOTES = 24;       // aligned landmark hits
+static const int SERIES_MIN_AUDIO_HITS = 2;         // per second, to count as covered
+static const int SERIES_MIN_VIDEO_VOTES = 5;        // aligned pHash matches
+static const int SERIES_PHASH_MAX_DISTANCE = 10;
+static const int SERIES_RESULT_STRIDE = 9;
+
+/**
+ * Per-episode inputs (borrowed) and landmarks (owned)
+ */
+struct SeriesEpisode {
+    const float* samples;
+    int sample_count;
+    float* owned_samples;       // resampled copy (series_set_episode_source_audio)
+    const uint64_t* hashes;
+    int hash_count;
+    float hashes_per_second;
+    uint32_t* landmarks;
+    int landmark_count;
+    int seconds;
+};
+
+struct SeriesAnalyzer {
+    int episode_count;
+    int sample_rate;
+    int fft_size;
+    int hop_size;
+    float head_seconds;
+    float tail_seconds;
+    float min_segment_seconds;
+    SeriesEpisode* episodes;
+};
+
+/**
+ * Run fn(0..count-1) on up to num_threads workers (serially without threads)
+ */
+template <typename Fn>
+static void series_parallel_for(int count, int num_threads, Fn fn) {
+#ifdef SERIES_THREADS
+    if (num_threads <= 0) num_threads = (int)std::thread::hardware_concurrency();
+    if (num_threads > count) num_threads = count;
+
+    if (num_threads > 1) {
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) fn(i);
+        };
+
+        std::thread* threads = new std::thread[num_threads - 1];
+        for (int t = 0; t < num_threads - 1; t++) threads[t] = std::thread(worker);
+        worker();
+        for (int t = 0; t < num_threads - 1; t++) threads[t].join();
+        delete[] threads;
+        return;
+    }
+#endif
+    for (int i = 0; i < count; i++) fn(i);
+}
+
+/**
+ * Create an analyzer for episode_count episodes of one series
+ * Audio is expected mono at sample_rate (8-16 kHz is plenty; <= 0 uses
+ * ANALYSIS_SAMPLE_RATE); fft_size <= 0 uses 1024
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+SeriesAnalyzer* create_series_analyzer(int episode_count, int sample_rate, int fft_size) {
+    if (sample_rate <= 0) sample_rate = ANALYSIS_SAMPLE_RATE;
+    if (fft_size <= 0) fft_size = 1024;
+    if (episode_count < 2 || sample_rate < 1000 || fft_size < 64 || (fft_size & (fft_size - 1)) != 0) {
+        return nullptr;
+    }
+
+    SeriesAnalyzer* analyzer = (SeriesAnalyzer*)calloc(1, sizeof(SeriesAnalyzer));
+    if (!analyzer) return nullptr;
+
+    analyzer->episodes = (SeriesEpisode*)calloc(episode_count, sizeof(SeriesEpisode));
+    if (!analyzer->episodes) { free(analyzer); return nullptr; }
+
+    analyzer->episode_count = episode_count;
+    analyzer->sample_rate = sample_rate;
+    analyzer->fft_size = fft_size;
+    analyzer->hop_size = fft_size / 4;
+    analyzer->head_seconds = SERIES_DEFAULT_HEAD_SECONDS;
+    analyzer->tail_seconds = SERIES_DEFAULT_TAIL_SECONDS;
+    analyzer->min_segment_seconds = SERIES_DEFAULT_MIN_SEGMENT;
+    return analyzer;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_series_analyzer(SeriesAnalyzer* analyzer) {
+    if (!analyzer) return;
+    for (int e = 0; e < analyzer->episode_count; e++) {
+        free(analyzer->episodes[e].landmarks);
+        free(analyzer->episodes[e].owned_samples);
+    }
+    free(analyzer->episodes);
+    free(analyzer);
+}
+
+/**
+ * Intros/recaps are located in the first head_seconds of each episode and
+ * credits in the last tail_seconds (matched against the whole of every other
+ * episode); values <= 0 keep the current setting
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int series_configure(SeriesAnalyzer* analyzer, float head_seconds, float tail_seconds, float min_segment_seconds) {
+    if (!analyzer) return 0;
+    if (head_seconds > 0.0f) analyzer->head_seconds = head_seconds;
+    if (tail_seconds > 0.0f) analyzer->tail_seconds = tail_seconds;
+    if (min_segment_seconds > 0.0f) analyzer->min_segment_seconds = min_segment_seconds;
+    return 1;
+}
+
+static void series_update_duration(SeriesAnalyzer* analyzer, SeriesEpisode* ep) {
+    int audio_seconds = (ep->sample_count + analyzer->sample_rate - 1) / analyzer->sample_rate;
+    int video_seconds = (ep->hash_count > 0) ? (int)ceilf(ep->hash_count / ep->hashes_per_second) : 0;
+    ep->seconds = (audio_seconds > video_seconds) ? audio_seconds : video_seconds;
+}
+
+/**
+ * Attach an episode's audio; the buffer must stay valid until series_analyze returns
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int series_set_episode_audio(SeriesAnalyzer* analyzer, int episode, float* samples, int sample_count) {
+    if (!analyzer || episode < 0 || episode >= analyzer->episode_count || !samples || sample_count < 0) return 0;
+
+    SeriesEpisode* ep = &analyzer->episodes[episode];
+    free(ep->owned_samples);
+    ep->owned_samples = nullptr;
+    ep->samples = samples;
+    ep->sample_count = sample_count;
+    series_update_duration(analyzer, ep);
+    return 1;
+}
+
+/**
+ * Attach an episode's decoded audio as it comes from the demuxer
+ * (interleaved, channels at source_rate); it is downmixed and resampled to
+ * the analyzer's rate once into a copy the analyzer owns, so the source
+ * buffer can be released right away
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int series_set_episode_source_audio(SeriesAnalyzer* analyzer, int episode, float* samples, int frames,
+                                    int channels, int source_rate) {
+    if (!analyzer || episode < 0 || episode >= analyzer->episode_count || !samples || frames < 1) return 0;
+
+    int length = 0;
+    float* audio = analysis_audio(samples, frames, channels, source_rate, analyzer->sample_rate, &length);
+    if (!audio) return 0;
+
+    if (audio == samples) {
+        audio = (float*)malloc((size_t)frames * sizeof(float));
+        if (!audio) return 0;
+        memcpy(audio, samples, (size_t)frames * sizeof(float));
+    }
+
+    series_set_episode_audio(analyzer, episode, audio, length);
+    analyzer->episodes[episode].owned_samples = audio;
+    return 1;
+}
+
+/**
+ * Optionally attach an episode's pHash sequence (compute_video_fingerprint),
+ * sampled at hashes_per_second; same lifetime rule as the audio
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int series_set_episode_hashes(SeriesAnalyzer* analyzer, int episode, uint64_t* hashes, int hash_count,
+                              float hashes_per_second) {
+    if (!analyzer || episode < 0 || episode >= analyzer->episode_count) return 0;
+    if (!hashes || hash_count < 1 || hashes_per_second <= 0.0f) return 0;
+
+    SeriesEpisode* ep = &analyzer->episodes[episode];
+    ep->hashes = hashes;
+    ep->hash_count = hash_count;
+    ep->hashes_per_second = hashes_per_second;
+    series_update_duration(analyzer, ep);
+    return 1;
+}
+
+/**
+ * Landmarks of a whole episode (recap sources can sit anywhere in it)
+ * The spectrogram is produced SERIES_CHUNK_FRAMES at a time with peak-picking
+ * halo, so memory stays bounded by the chunk rather than the episode.
+ */
+static bool series_fingerprint_episode(const SeriesAnalyzer* analyzer, SeriesEpisode* ep) {
+    free(ep->landmarks);
+    ep->landmarks = nullptr;
+    ep->landmark_count = 0;
+
+    int n = analyzer->fft_size;
+    int hop = analyzer->hop_size;
+    if (!ep->samples || ep->sample_count < n) return true;
+
+    int total_frames = (ep->sample_count - n) / hop + 1;
+    int num_bins = n / 2 + 1;
+    int halo = PEAK_TIME_RADIUS;
+
+    FFTPlan* plan = create_plan(n);
+    float* spectrogram = (float*)malloc((size_t)(SERIES_CHUNK_FRAMES + 2 * halo) * num_bins * sizeof(float));
+    SpectralPeak* peaks = (SpectralPeak*)malloc((size_t)total_frames * MAX_PEAKS_PER_FRAME * sizeof(SpectralPeak));
+    bool ok = plan && spectrogram && peaks;
+    int peak_count = 0;
+
+    for (int c0 = 0; c0 < total_frames && ok; c0 += SERIES_CHUNK_FRAMES) {
+        int c1 = (c0 + SERIES_CHUNK_FRAMES < total_frames) ? c0 + SERIES_CHUNK_FRAMES : total_frames;
+        int f0 = (c0 - halo > 0) ? c0 - halo : 0;
+        int f1 = (c1 + halo < total_frames) ? c1 + halo : total_frames;
+
+        int frames = compute_spectrogram_with_plan(plan, (float*)ep->samples + (size_t)f0 * hop,
+                                                   (f1 - f0 - 1) * hop + n, spectrogram);
+        int picked = pick_spectral_peaks(spectrogram, frames, num_bins, c0 - f0, c1 - f0, peaks + peak_count);
+        if (picked < 0) { ok = false; break; }
+
+        for (int p = peak_count; p < peak_count + picked; p++) peaks[p].frame += f0;
+        peak_count += picked;
+    }
+
+    destroy_plan(plan);
+    free(spectrogram);
+
+    if (ok && peak_count > 0) {
+        int max_landmarks = peak_count * TARGET_FAN_OUT;
+        ep->landmarks = (uint32_t*)malloc((size_t)max_landmarks * 2 * sizeof(uint32_t));
+        if (ep->landmarks) {
+            ep->landmark_count = pair_landmarks(peaks, peak_count, landmark_bin_shift(num_bins),
+                                                ep->landmarks, max_landmarks);
+            uint32_t* shrunk = (uint32_t*)realloc(ep->landmarks, ((size_t)ep->landmark_count * 2 + 2) * sizeof(uint32_t));
+            if (shrunk) ep->landmarks = shrunk;
+        } else {
+            ok = false;
+        }
+    }
+
+    free(peaks);
+    return ok;
+}
+
+/**
+ * Up to SERIES_OFFSETS_PER_PAIR strongest alignments per partner, at least
+ * 3 apart so the split votes of neighbouring offsets do not count twice
+ */
+struct SeriesAlignments {
+    int offsets[SERIES_OFFSETS_PER_PAIR * 2];
+    int votes[SERIES_OFFSETS_PER_PAIR * 2];
+    int count;
+};
+
+static void alignments_insert(SeriesAlignments* a, int offset, int votes) {
+    const int CAPACITY = SERIES_OFFSETS_PER_PAIR * 2;
+    if (a->count == CAPACITY && votes <= a->votes[CAPACITY - 1]) return;
+
+    int pos = (a->count < CAPACITY) ? a->count++ : CAPACITY - 1;
+    while (pos > 0 && a->votes[pos - 1] < votes) {
+        a->offsets[pos] = a->offsets[pos - 1];
+        a->votes[pos] = a->votes[pos - 1];
+        pos--;
+    }
+    a->offsets[pos] = offset;
+    a->votes[pos] = votes;
+}
+
+static void alignments_finalize(SeriesAlignments* a) {
+    int kept = 0;
+    for (int i = 0; i < a->count && kept < SERIES_OFFSETS_PER_PAIR; i++) {
+        bool distinct = true;
+        for (int k = 0; k < kept; k++) {
+            if (abs(a->offsets[k] - a->offsets[i]) < 3) { distinct = false; break; }
+        }
+        if (!distinct) continue;
+        a->offsets[kept] = a->offsets[i];
+        a->votes[kept] = a->votes[i];
+        kept++;
+    }
+    a->count = kept;
+}
+
+static inline int series_match_alignment(const SeriesAlignments* a, int offset) {
+    for (int k = 0; k < a->count; k++) {
+        if (abs(a->offsets[k] - offset) <= 1) return k;
+    }
+    return -1;
+}
+
+/**
+ * Mark every run of covered seconds (gaps <= SERIES_MAX_GAP_SECONDS,
+ * length >= min_len) as shared with `partner`; a second counts once per partner
+ */
+static void series_mark_runs(const uint16_t* hits, int seconds, int min_hits, int min_len, int partner,
+                             bool earlier, int* stamp, uint16_t* shared, uint16_t* from_earlier) {
+    int start = -1, last = -1;
+
+    for (int s = 0; s <= seconds; s++) {
+        bool covered = (s < seconds) && hits[s] >= min_hits;
+        if (covered) {
+            if (start < 0) start = s;
+            last = s;
+            continue;
+        }
+        if (start < 0 || (s < seconds && s - last <= SERIES_MAX_GAP_SECONDS)) continue;
+
+        if (last - start + 1 >= min_len) {
+            for (int k = start; k <= last; k++) {
+                if (stamp[k] == partner) continue;
+                stamp[k] = partner;
+                shared[k]++;
+                if (earlier) from_earlier[k]++;
+            }
+        }
+        start = -1;
+    }
+}
+
+/**
+ * Longest run in [from, to) satisfying pred (gaps <= SERIES_MAX_GAP_SECONDS)
+ * Returns run length, 0 if none reaches min_len
+ */
+template <typename Pred>
+static int series_longest_run(int from, int to, int min_len, Pred pred, int* out_start, int* out_end) {
+    int best = 0, start = -1, last = -1;
+
+    for (int s = from; s <= to; s++) {
+        bool ok = (s < to) && pred(s);
+        if (ok) {
+            if (start < 0) start = s;
+            last = s;
+            continue;
+        }
+        if (start < 0 || (s < to && s - last <= SERIES_MAX_GAP_SECONDS)) continue;
+
+        int len = last - start + 1;
+        if (len >= min_len && len > best) {
+            best = len;
+            *out_start = start;
+            *out_end = last + 1;
+        }
+        start = -1;
+    }
+
+    return best;
+}
+
+static inline bool phash_informative(uint64_t hash) {
+    // Near-uniform frames (black, white, fades) hash to almost all 0s or 1s
+    int bits = __builtin_popcountll(hash);
+    return bits >= 8 && bits <= 56;
+}
+
+static inline bool series_in_window(int second, int head_end, int tail_start) {
+    return second < head_end || second >= tail_start;
+}
+
+/**
+ * Align episode i against every other episode and classify its segments
+ * row: SERIES_RESULT_STRIDE floats; returns false on allocation failure
+ */
+static bool series_match_episode(const SeriesAnalyzer* analyzer, const LandmarkIndex* index, int i, float* row) {
+    const SeriesEpisode* ep = &analyzer->episodes[i];
+    int n_eps = analyzer->episode_count;
+    int seconds = ep->seconds;
+    int hop = analyzer->hop_size;
+    int rate = analyzer->sample_rate;
+    int min_len = (int)ceilf(analyzer->min_segment_seconds);
+
+    for (int k = 0; k < SERIES_RESULT_STRIDE; k++) row[k] = (k % 3 == 2) ? 0.0f : -1.0f;
+    if (seconds < 1) return true;
+
+    int head_end = (int)analyzer->head_seconds;
+    int tail_start = seconds - (int)analyzer->tail_seconds;
+    if (head_end > seconds) head_end = seconds;
+    if (tail_start < head_end) tail_start = head_end;
+
+    SeriesAlignments* audio = (SeriesAlignments*)calloc(n_eps, sizeof(SeriesAlignments));
+    uint16_t* hits = (uint16_t*)malloc((size_t)n_eps * SERIES_OFFSETS_PER_PAIR * seconds * sizeof(uint16_t));
+    int* stamp = (int*)malloc(seconds * sizeof(int));
+    uint16_t* shared = (uint16_t*)calloc(seconds, sizeof(uint16_t));
+    uint16_t* from_earlier = (uint16_t*)calloc(seconds, sizeof(uint16_t));
+    OffsetVoteTable table = { nullptr, nullptr, 0, 0 };
+
+    bool ok = audio && hits && stamp && shared && from_earlier && vote_table_init(&table, 4096);
+
+    // 1. Vote on (partner, frame offset) for every landmark hit inside the search windows
+    for (int l = 0; l < ep->landmark_count && ok; l++) {
+        uint32_t hash = ep->landmarks[l * 2];
+        int t = (int)ep->landmarks[l * 2 + 1];
+        int second = (int)((long long)t * hop / rate);
+        if (second >= seconds || !series_in_window(second, head_end, tail_start)) continue;
+        uint32_t b = landmark_bucket(hash, index->bucket_mask);
+
+        for (int e = index->bucket_start[b]; e < index->bucket_start[b + 1]; e++) {
+            if (index->hashes[e] != hash || index->tracks[e] == i) continue;
+            if (!vote_table_add(&table, vote_key(index->tracks[e], index->offsets[e] - t), 1)) { ok = false; break; }
+        }
+    }
+
+    // 2. Strongest distinct alignments per partner
+    if (ok) {
+        for (uint32_t s = 0; s <= table.mask; s++) {
+            if (table.keys[s] == VOTE_EMPTY || table.votes[s] < SERIES_MIN_AUDIO_VOTES) continue;
+            alignments_insert(&audio[table.keys[s] >> 32], (int)(uint32_t)table.keys[s], table.votes[s]);
+        }
+        for (int j = 0; j < n_eps; j++) alignments_finalize(&audio[j]);
+        memset(hits, 0, (size_t)n_eps * SERIES_OFFSETS_PER_PAIR * seconds * sizeof(uint16_t));
+    }
+
+    // 3. Per-second hit counts along each alignment
+    for (int l = 0; l < ep->landmark_count && ok; l++) {
+        uint32_t hash = ep->landmarks[l * 2];
+        int t = (int)ep->landmarks[l * 2 + 1];
+        int second = (int)((long long)t * hop / rate);
+        if (second >= seconds || !series_in_window(second, head_end, tail_start)) continue;
+        uint32_t b = landmark_bucket(hash, index->bucket_mask);
+
+        for (int e = index->bucket_start[b]; e < index->bucket_start[b + 1]; e++) {
+            int j = index->tracks[e];
+            if (index->hashes[e] != hash || j == i) continue;
+
+            int k = series_match_alignment(&audio[j], index->offsets[e] - t);
+            if (k < 0) continue;
+            uint16_t* h = &hits[((size_t)j * SERIES_OFFSETS_PER_PAIR + k) * seconds + second];
+            if (*h < 0xFFFF) (*h)++;
+        }
+    }
+
+    // 4. Coverage per partner from audio alignments and, when present, pHash alignments
+    int* video_votes = nullptr;
+    if (ok) {
+        for (int s = 0; s < seconds; s++) stamp[s] = -1;
+    }
+
+    for (int j = 0; j < n_eps && ok; j++) {
+        if (j == i) continue;
+
+        for (int k = 0; k < audio[j].count; k++) {
+            series_mark_runs(&hits[((size_t)j * SERIES_OFFSETS_PER_PAIR + k) * seconds], seconds,
+                             SERIES_MIN_AUDIO_HITS, min_len, j, j < i, stamp, shared, from_earlier);
+        }
+
+        const SeriesEpisode* other = &analyzer->episodes[j];
+        if (!ep->hashes || !other->hashes || other->seconds < 1) continue;
+
+        // Offsets in seconds span [-seconds, other->seconds]
+        int span = seconds + other->seconds + 1;
+        int* grown = (int*)realloc(video_votes, span * sizeof(int));
+        if (!grown) { ok = false; break; }
+        video_votes = grown;
+        memset(video_votes, 0, span * sizeof(int));
+
+        for (int a = 0; a < ep->hash_count; a++) {
+            int sa = (int)(a / ep->hashes_per_second);
+            if (sa >= seconds || !series_in_window(sa, head_end, tail_start) || !phash_informative(ep->hashes[a])) continue;
+            for (int c = 0; c < other->hash_count; c++) {
+                int sc = (int)(c / other->hashes_per_second);
+                if (sc >= other->seconds) continue;
+                if (__builtin_popcountll(ep->hashes[a] ^ other->hashes[c]) <= SERIES_PHASH_MAX_DISTANCE) {
+                    video_votes[sc - sa + seconds]++;
+                }
+            }
+        }
+
+        SeriesAlignments video = {};
+        for (int d = 0; d < span; d++) {
+            if (video_votes[d] >= SERIES_MIN_VIDEO_VOTES) alignments_insert(&video, d - seconds, video_votes[d]);
+        }
+        alignments_finalize(&video);
+        if (video.count == 0) continue;
+
+        // The partner's audio rows are already consumed; reuse them for pHash hits
+        uint16_t* video_hits = &hits[(size_t)j * SERIES_OFFSETS_PER_PAIR * seconds];
+        memset(video_hits, 0, (size_t)SERIES_OFFSETS_PER_PAIR * seconds * sizeof(uint16_t));
+
+        for (int a = 0; a < ep->hash_count; a++) {
+            int sa = (int)(a / ep->hashes_per_second);
+            if (sa >= seconds || !series_in_window(sa, head_end, tail_start) || !phash_informative(ep->hashes[a])) continue;
+            for (int c = 0; c < other->hash_count; c++) {
+                int sc = (int)(c / other->hashes_per_second);
+                if (sc >= other->seconds) continue;
+                int k = series_match_alignment(&video, sc - sa);
+                if (k < 0) continue;
+                if (__builtin_popcountll(ep->hashes[a] ^ other->hashes[c]) <= SERIES_PHASH_MAX_DISTANCE) {
+                    uint16_t* h = &video_hits[(size_t)k * seconds + sa];
+                    if (*h < 0xFFFF) (*h)++;
+                }
+            }
+        }
+
+        for (int k = 0; k < video.count; k++) {
+            series_mark_runs(&video_hits[(size_t)k * seconds], seconds, 1, min_len, j, j < i,
+                             stamp, shared, from_earlier);
+        }
+    }
+
+    // 5. Classify: intro and credits are shared by most of the season,
+    //    a recap repeats material from earlier episodes only
+    if (ok) {
+        int partners = n_eps - 1;
+        int majority = (partners + 1) / 2;
+        int start = 0, end = 0;
+
+        auto score = [&](int from, int to) {
+            float sum = 0.0f;
+            for (int s = from; s < to; s++) sum += shared[s];
+            return sum / ((to - from) * (float)partners);
+        };
+
+        int intro_start = -1, intro_end = -1;
+        if (series_longest_run(0, head_end, min_len, [&](int s) { return shared[s] >= majority; }, &start, &end)) {
+            intro_start = start;
+            intro_end = end;
+            row[0] = (float)start;
+            row[1] = (float)end;
+            row[2] = score(start, end);
+        }
+
+        auto is_recap = [&](int s) {
+            return from_earlier[s] > 0 && shared[s] < majority && (s < intro_start || s >= intro_end);
+        };
+        if (series_longest_run(0, head_end, min_len, is_recap, &start, &end)) {
+            row[3] = (float)start;
+            row[4] = (float)end;
+            row[5] = score(start, end);
+        }
+
+        int credits_from = (tail_start > intro_end) ? tail_start : intro_end;
+        if (series_longest_run(credits_from, seconds, min_len, [&](int s) { return shared[s] >= majority; }, &start, &end)) {
+            row[6] = (float)start;
+            row[7] = (float)end;
+            row[8] = score(start, end);
         }
     }
-    
-    return best_match;
+
+    vote_table_free(&table);
+    free(video_votes);
+    free(audio);
+    free(hits);
+    free(stamp);
+    free(shared);
+    free(from_earlier);
+    return ok;
+}
+
+/**
+ * Find intro, recap and credits ranges across all attached episodes
+ * Episodes are fingerprinted and matched in parallel (num_threads <= 0 uses
+ * every core; builds without thread support run serially).
+ * output: episode_count * 9 floats per episode:
+ *   [intro_start, intro_end, intro_score, recap_start, recap_end, recap_score,
+ *    credits_start, credits_end, credits_score]
+ * times in seconds (-1 when not found), score = share of other episodes with
+ * the same material. Returns number of episodes with an intro, or -1 on failure
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int series_analyze(SeriesAnalyzer* analyzer, int num_threads, float* output) {
+    if (!analyzer || !output) return -1;
+
+    int n_eps = analyzer->episode_count;
+    std::atomic<bool> failed(false);
+
+    series_parallel_for(n_eps, num_threads, [&](int e) {
+        if (!series_fingerprint_episode(analyzer, &analyzer->episodes[e])) failed = true;
+    });
+    if (failed) return -1;
+
+    LandmarkIndex* index = create_landmark_index();
+    if (!index) return -1;
+
+    for (int e = 0; e < n_eps && !failed; e++) {
+        const SeriesEpisode* ep = &analyzer->episodes[e];
+        if (ep->landmark_count == 0) continue;
+        if (landmark_index_add_track(index, e, ep->landmarks, ep->landmark_count) < 0) failed = true;
+    }
+    if (!failed && !landmark_index_build(index)) failed = true;
+
+    // Each episode's own landmarks query the shared index (read-only from here on)
+    if (!failed) {
+        series_parallel_for(n_eps, num_threads, [&](int e) {
+            if (failed) return;
+            if (!series_match_episode(analyzer, index, e, output + (size_t)e * SERIES_RESULT_STRIDE)) failed = true;
+        });
+    }
+
+    destroy_landmark_index(index);
+    if (failed) return -1;
+
+    int found = 0;
+    for (int e = 0; e < n_eps; e++) {
+        if (output[(size_t)e * SERIES_RESULT_STRIDE] >= 0.0f) found++;
+    }
+    return found;
 }
 
 // ============================================================================
 // AUDIO PEAK DETECTION
 // ============================================================================
 
+static inline bool is_audio_peak(const float* data, int i, float threshold) {
+    return data[i] > threshold && data[i] > data[i - 1] && data[i] > data[i + 1];
+}
+
 /**
  * Detect peaks in audio signal for onset detection
+ * Single scan; the result grows geometrically and is trimmed at the end
+ * Returns [count, idx1, val1, idx2, val2, ...]
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
 float* detect_audio_peaks(float* audio_data, int length, float threshold) {
     if (!audio_data || length < 3) return nullptr;
-    
-    // Count peaks first
+
+    int capacity = 64;
+    float* peaks = (float*)malloc((1 + capacity * 2) * sizeof(float));
+    if (!peaks) return nullptr;
+
     int peak_count = 0;
     for (int i = 1; i < length - 1; i++) {
-        if (audio_data[i] > threshold &&
-            audio_data[i] > audio_data[i-1] &&
-            audio_data[i] > audio_data[i+1]) {
-            peak_count++;
+        if (!is_audio_peak(audio_data, i, threshold)) continue;
+
+        if (peak_count == capacity) {
+            capacity *= 2;
+            float* grown = (float*)realloc(peaks, (1 + (size_t)capacity * 2) * sizeof(float));
+            if (!grown) {
+                free(peaks);
+                return nullptr;
+            }
+            peaks = grown;
         }
+
+        peaks[1 + peak_count * 2] = (float)i;
+        peaks[2 + peak_count * 2] = audio_data[i];
+        peak_count++;
     }
-    
-    // Allocate result array: [count, idx1, val1, idx2, val2, ...]
-    float* peaks = (float*)malloc((1 + peak_count * 2) * sizeof(float));
-    if (!peaks) return nullptr;
-    
+
     peaks[0] = (float)peak_count;
-    int j = 1;
-    
-    for (int i = 1; i < length - 1; i++) {
-        if (audio_data[i] > threshold &&
-            audio_data[i] > audio_data[i-1] &&
-            audio_data[i] > audio_data[i+1]) {
-            peaks[j++] = (float)i;
-            peaks[j++] = audio_data[i];
-        }
-    }
-    
-    return peaks;
+    float* trimmed = (float*)realloc(peaks, (1 + (size_t)peak_count * 2) * sizeof(float));
+    return trimmed ? trimmed : peaks;
 }
 
+// ============================================================================
+// INTRO BOUNDARY ENERGY ANALYSIS (streaming)
+// ============================================================================
+
+static const int INTRO_BASELINE_WINDOWS = 50;   // 5s reference level after the intro starts
+static const int INTRO_LOCAL_WINDOWS = 10;      // 1s moving average
+static const int INTRO_DEFAULT_WINDOWS = 100;   // ~10s when no change is found
+
 /**
- * Detect intro boundaries using audio analysis
- * Returns [intro_start_frame, intro_end_frame]
+ * Per-100ms RMS accumulated from PCM pushed in arbitrary chunks
+ * Only the RMS series is kept (40 bytes per second), never the samples.
  */
+struct IntroEnergyAnalyzer {
+    int sample_rate;
+    int window_size;
+    float partial_sum;      // sum of squares of the incomplete window
+    int partial_count;
+    float* energy;
+    int num_windows;
+    int capacity;
+};
+
 extern "C" EMSCRIPTEN_KEEPALIVE
-float* detect_intro_boundaries(float* audio_samples, int sample_count, int sample_rate) {
-    if (!audio_samples || sample_count < sample_rate * 5) return nullptr;
-    
-    float* result = (float*)malloc(4 * sizeof(float));
-    if (!result) return nullptr;
-    
-    int window_size = sample_rate / 10; // 100ms windows
-    int num_windows = sample_count / window_size;
-    
-    // Calculate energy for each window
-    float* energy = (float*)malloc(num_windows * sizeof(float));
-    if (!energy) { free(result); return nullptr; }
-    
-    for (int w = 0; w < num_windows; w++) {
-        float sum = 0.0f;
-        for (int i = 0; i < window_size; i++) {
-            float val = audio_samples[w * window_size + i];
-            sum += val * val;
+IntroEnergyAnalyzer* create_intro_energy_analyzer(int sample_rate) {
+    if (sample_rate < 10) return nullptr;
+
+    IntroEnergyAnalyzer* analyzer = (IntroEnergyAnalyzer*)calloc(1, sizeof(IntroEnergyAnalyzer));
+    if (!analyzer) return nullptr;
+
+    analyzer->sample_rate = sample_rate;
+    analyzer->window_size = sample_rate / 10; // 100ms windows
+    return analyzer;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_intro_energy_analyzer(IntroEnergyAnalyzer* analyzer) {
+    if (!analyzer) return;
+    free(analyzer->energy);
+    free(analyzer);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void reset_intro_energy_analyzer(IntroEnergyAnalyzer* analyzer) {
+    if (!analyzer) return;
+    analyzer->partial_sum = 0.0f;
+    analyzer->partial_count = 0;
+    analyzer->num_windows = 0;
+}
+
+/**
+ * Feed the next chunk of mono PCM
+ * Returns number of complete windows so far, or -1 on allocation failure
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int intro_energy_push(IntroEnergyAnalyzer* analyzer, float* samples, int count) {
+    if (!analyzer || !samples || count < 0) return -1;
+
+    int window_size = analyzer->window_size;
+    float sum = analyzer->partial_sum;
+    int filled = analyzer->partial_count;
+
+    for (int i = 0; i < count; i++) {
+        sum += samples[i] * samples[i];
+
+        if (++filled == window_size) {
+            if (analyzer->num_windows == analyzer->capacity) {
+                int capacity = analyzer->capacity ? analyzer->capacity * 2 : 1024;
+                float* grown = (float*)realloc(analyzer->energy, capacity * sizeof(float));
+                if (!grown) {
+                    analyzer->partial_sum = sum - samples[i] * samples[i];
+                    analyzer->partial_count = filled - 1;
+                    return -1;
+                }
+                analyzer->energy = grown;
+                analyzer->capacity = capacity;
+            }
+
+            analyzer->energy[analyzer->num_windows++] = sqrtf(sum / window_size);
+            sum = 0.0f;
+            filled = 0;
         }
-        energy[w] = sqrtf(sum / window_size);
     }
-    
+
+    analyzer->partial_sum = sum;
+    analyzer->partial_count = filled;
+    return analyzer->num_windows;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int intro_energy_window_count(IntroEnergyAnalyzer* analyzer) {
+    return analyzer ? analyzer->num_windows : 0;
+}
+
+/**
+ * Locate the intro from the RMS series in O(windows)
+ * All moving-window means come from one prefix-sum pass; the trailing
+ * partial window is ignored. result: [start_sec, end_sec, intro_energy, duration_sec]
+ * Returns 1, or 0 with less than 5 seconds of audio
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int intro_energy_analyze(IntroEnergyAnalyzer* analyzer, float* result) {
+    if (!analyzer || !result) return 0;
+
+    int num_windows = analyzer->num_windows;
+    if (num_windows < INTRO_BASELINE_WINDOWS) return 0;
+
+    const float* energy = analyzer->energy;
+    double* prefix = (double*)malloc((num_windows + 1) * sizeof(double));
+    if (!prefix) return 0;
+
+    prefix[0] = 0.0;
+    for (int w = 0; w < num_windows; w++) prefix[w + 1] = prefix[w] + energy[w];
+
+    auto window_mean = [&](int from, int to) {
+        if (to > num_windows) to = num_windows;
+        return (to > from) ? (float)((prefix[to] - prefix[from]) / (to - from)) : 0.0f;
+    };
+
     // Find sudden energy changes (intro typically starts/ends with fade/cut)
-    float avg_energy = 0.0f;
-    for (int w = 0; w < num_windows; w++) avg_energy += energy[w];
-    avg_energy /= num_windows;
-    
+    float avg_energy = window_mean(0, num_windows);
+
     // Look for intro start (first significant energy after silence)
     int intro_start = 0;
     for (int w = 1; w < num_windows / 4; w++) { // First 25% of video
-        if (energy[w] > avg_energy * 0.5f && energy[w-1] < avg_energy * 0.2f) {
+        if (energy[w] > avg_energy * 0.5f && energy[w - 1] < avg_energy * 0.2f) {
             intro_start = w;
             break;
         }
     }
-    
-    // Look for intro end (energy pattern change)
-    int intro_end = intro_start + 100; // Default ~10 seconds
-    float intro_avg = 0.0f;
-    for (int w = intro_start; w < intro_start + 50 && w < num_windows; w++) {
-        intro_avg += energy[w];
-    }
-    intro_avg /= 50;
-    
-    for (int w = intro_start + 50; w < num_windows / 3; w++) {
-        float local_avg = 0.0f;
-        for (int i = 0; i < 10 && w + i < num_windows; i++) {
-            local_avg += energy[w + i];
-        }
-        local_avg /= 10;
-        
+
+    // Look for intro end (first 1s level that departs from the intro's first 5s)
+    int intro_end = intro_start + INTRO_DEFAULT_WINDOWS;
+    float intro_avg = window_mean(intro_start, intro_start + INTRO_BASELINE_WINDOWS);
+
+    for (int w = intro_start + INTRO_BASELINE_WINDOWS; w < num_windows / 3; w++) {
+        float local_avg = window_mean(w, w + INTRO_LOCAL_WINDOWS);
+
         if (fabsf(local_avg - intro_avg) > intro_avg * 0.5f) {
             intro_end = w;
             break;
         }
     }
-    
-    result[0] = (float)intro_start * window_size / sample_rate; // Start time in seconds
-    result[1] = (float)intro_end * window_size / sample_rate;   // End time in seconds
-    result[2] = intro_avg; // Intro energy (confidence indicator)
-    result[3] = (float)(intro_end - intro_start) / 10.0f; // Duration in seconds
-    
-    free(energy);
+
+    free(prefix);
+
+    float window_seconds = (float)analyzer->window_size / analyzer->sample_rate;
+    result[0] = intro_start * window_seconds;                 // Start time in seconds
+    result[1] = intro_end * window_seconds;                   // End time in seconds
+    result[2] = intro_avg;                                    // Intro energy (confidence indicator)
+    result[3] = (intro_end - intro_start) * window_seconds;   // Duration in seconds
+    return 1;
+}
+
+/**
+ * Detect intro boundaries using audio analysis
+ * One-shot wrapper over the streaming analyzer for a resident buffer
+ * Returns [start_sec, end_sec, intro_energy, duration_sec]
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* detect_intro_boundaries(float* audio_samples, int sample_count, int sample_rate) {
+    if (!audio_samples || sample_count < sample_rate * 5) return nullptr;
+
+    IntroEnergyAnalyzer* analyzer = create_intro_energy_analyzer(sample_rate);
+    if (!analyzer) return nullptr;
+
+    float* result = (float*)malloc(4 * sizeof(float));
+    if (!result || intro_energy_push(analyzer, audio_samples, sample_count) < 0 ||
+        !intro_energy_analyze(analyzer, result)) {
+        free(result);
+        result = nullptr;
+    }
+
+    destroy_intro_energy_analyzer(analyzer);
     return result;
 }
 
+// ============================================================================
+// FUSED AUDIO ANALYSIS (single pass)
+// ============================================================================
+
+// Integrated loudness (ITU-R BS.1770-4 / EBU R128)
+static const float LOUDNESS_ABSOLUTE_GATE = -70.0f;   // LUFS
+static const float LOUDNESS_RELATIVE_GATE = -10.0f;   // LU below the absolute-gated mean
+static const int LOUDNESS_HIST_BINS = 800;            // 0.1 LU bins over [-70, +10) LUFS
+static const int LOUDNESS_BLOCK_STEPS = 4;            // 400 ms blocks from 100 ms steps (75% overlap)
+
+/**
+ * K-weighted gated loudness of a mono stream
+ * Gating blocks are kept as a 0.1 LU histogram (energy and count per bin),
+ * so memory is constant; only the bin straddling the relative gate is
+ * approximated.
+ */
+struct LoudnessMeter {
+    double b[2][3];         // pre-filter (high shelf), RLB high-pass
+    double a[2][2];         // a1, a2 per stage
+    double z[2][2];         // transposed direct form II state
+    double step_energy[LOUDNESS_BLOCK_STEPS];
+    int steps;
+    double hist_energy[LOUDNESS_HIST_BINS];
+    int hist_count[LOUDNESS_HIST_BINS];
+};
+
+/**
+ * K-weighting biquads for any sample rate (BS.1770 analog prototypes,
+ * bilinear transform; matches the published 48 kHz coefficients)
+ */
+static void loudness_meter_init(LoudnessMeter* meter, int sample_rate) {
+    memset(meter, 0, sizeof(LoudnessMeter));
+
+    double k = tan(M_PI * 1681.974450955533 / sample_rate);
+    double q = 0.7071752369554196;
+    double vh = pow(10.0, 3.999843853973347 / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    meter->b[0][0] = (vh + vb * k / q + k * k) / a0;
+    meter->b[0][1] = 2.0 * (k * k - vh) / a0;
+    meter->b[0][2] = (vh - vb * k / q + k * k) / a0;
+    meter->a[0][0] = 2.0 * (k * k - 1.0) / a0;
+    meter->a[0][1] = (1.0 - k / q + k * k) / a0;
+
+    k = tan(M_PI * 38.13547087602444 / sample_rate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    meter->b[1][0] = 1.0;
+    meter->b[1][1] = -2.0;
+    meter->b[1][2] = 1.0;
+    meter->a[1][0] = 2.0 * (k * k - 1.0) / a0;
+    meter->a[1][1] = (1.0 - k / q + k * k) / a0;
+}
+
+static inline double k_weight(LoudnessMeter* meter, double x) {
+    for (int s = 0; s < 2; s++) {
+        const double* b = meter->b[s];
+        double* z = meter->z[s];
+        double y = b[0] * x + z[0];
+        z[0] = b[1] * x - meter->a[s][0] * y + z[1];
+        z[1] = b[2] * x - meter->a[s][1] * y;
+        x = y;
+    }
+    return x;
+}
+
+static inline float block_loudness(double mean_square) {
+    return -0.691f + 10.0f * log10f((float)fmax(mean_square, 1e-20));
+}
+
+static inline int loudness_bin(float lufs) {
+    int bin = (int)((lufs - LOUDNESS_ABSOLUTE_GATE) * 10.0f);
+    return bin < 0 ? 0 : (bin >= LOUDNESS_HIST_BINS ? LOUDNESS_HIST_BINS - 1 : bin);
+}
+
+/**
+ * Close one 100 ms step (mean square of K-weighted samples)
+ */
+static void loudness_push_step(LoudnessMeter* meter, double mean_square) {
+    memmove(meter->step_energy, meter->step_energy + 1, (LOUDNESS_BLOCK_STEPS - 1) * sizeof(double));
+    meter->step_energy[LOUDNESS_BLOCK_STEPS - 1] = mean_square;
+    if (++meter->steps < LOUDNESS_BLOCK_STEPS) return;
+
+    double block = 0.0;
+    for (int i = 0; i < LOUDNESS_BLOCK_STEPS; i++) block += meter->step_energy[i];
+    block /= LOUDNESS_BLOCK_STEPS;
+
+    float lufs = block_loudness(block);
+    if (lufs <= LOUDNESS_ABSOLUTE_GATE) return;
+
+    int bin = loudness_bin(lufs);
+    meter->hist_energy[bin] += block;
+    meter->hist_count[bin]++;
+}
+
+/**
+ * Integrated loudness in LUFS (-70 when no block passes the absolute gate)
+ */
+static float loudness_integrated(const LoudnessMeter* meter) {
+    double energy = 0.0;
+    long long count = 0;
+    for (int i = 0; i < LOUDNESS_HIST_BINS; i++) {
+        energy += meter->hist_energy[i];
+        count += meter->hist_count[i];
+    }
+    if (count == 0) return LOUDNESS_ABSOLUTE_GATE;
+
+    float relative_gate = block_loudness(energy / count) + LOUDNESS_RELATIVE_GATE;
+
+    energy = 0.0;
+    count = 0;
+    for (int i = loudness_bin(relative_gate); i < LOUDNESS_HIST_BINS; i++) {
+        energy += meter->hist_energy[i];
+        count += meter->hist_count[i];
+    }
+    return block_loudness(energy / count);
+}
+
+/**
+ * Caller-owned inputs/outputs of analyze_audio
+ * On wasm32 every field is 4 bytes, so JS fills it through HEAP32/HEAPF32 at
+ * word offsets 0-9. Arrays and capacities are set by the caller; counts
+ * report everything found, of which the first `capacity` are written.
+ */
+struct AudioAnalysis {
+    float* spectrogram;         // [0] capacity * (fft_size/2+1) dB values; nullptr skips the STFT
+    int spectrogram_capacity;   // [1] frames
+    int spectrogram_frames;     // [2] fft_size window, hop fft_size/4 (as compute_audio_spectrogram)
+    float* rms;                 // [3] RMS per 100 ms window (as the intro energy analyzer)
+    int rms_capacity;           // [4]
+    int rms_windows;            // [5]
+    float* peaks;               // [6] [sample_index, value] pairs (as detect_audio_peaks)
+    int peak_capacity;          // [7] pairs
+    int peak_count;             // [8]
+    float integrated_lufs;      // [9] EBU R128 integrated loudness, K-weighted, gated
+};
+
+/**
+ * Spectrogram, RMS windows, onset peaks and integrated loudness in one pass
+ * The PCM is walked once in hop-sized blocks; per-sample work (energy,
+ * K-weighting, peak test) runs as the block streams in, and every STFT
+ * frame ending in the block is transformed while its samples are still in
+ * cache. Returns 1, or 0 on invalid input
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int analyze_audio(float* samples, int sample_count, int sample_rate, int fft_size, float peak_threshold,
+                  AudioAnalysis* result) {
+    if (!samples || !result || sample_count < 3 || sample_rate < 10) return 0;
+
+    FFTPlan* plan = nullptr;
+    if (result->spectrogram) {
+        plan = get_cached_plan(fft_size);
+        if (!plan) return 0;
+    }
+
+    LoudnessMeter* meter = (LoudnessMeter*)malloc(sizeof(LoudnessMeter));
+    if (!meter) return 0;
+    loudness_meter_init(meter, sample_rate);
+
+    int step = sample_rate / 10;
+    int hop = plan ? plan->n / 4 : step;
+    int num_bins = plan ? plan->m + 1 : 0;
+    long long next_frame_end = plan ? plan->n : -1;
+
+    int frames = 0, windows = 0, peak_count = 0;
+    float raw_energy = 0.0f;
+    double weighted_energy = 0.0;
+    int filled = 0;
+
+    for (int start = 0; start < sample_count; start += hop) {
+        int end = (sample_count - start > hop) ? start + hop : sample_count;
+
+        for (int i = start; i < end; i++) {
+            float x = samples[i];
+            double y = k_weight(meter, x);
+            raw_energy += x * x;
+            weighted_energy += y * y;
+
+            if (++filled == step) {
+                if (windows < result->rms_capacity && result->rms) result->rms[windows] = sqrtf(raw_energy / step);
+                windows++;
+                loudness_push_step(meter, weighted_energy / step);
+                raw_energy = 0.0f;
+                weighted_energy = 0.0;
+                filled = 0;
+            }
+
+            if (i > 0 && i < sample_count - 1 && is_audio_peak(samples, i, peak_threshold)) {
+                if (peak_count < result->peak_capacity && result->peaks) {
+                    result->peaks[peak_count * 2] = (float)i;
+                    result->peaks[peak_count * 2 + 1] = x;
+                }
+                peak_count++;
+            }
+        }
+
+        // Frames are hop-aligned, so at most one ends in each block
+        if (plan && next_frame_end <= end) {
+            if (frames < result->spectrogram_capacity) {
+                frame_power_db(plan, samples + (next_frame_end - plan->n),
+                               result->spectrogram + (size_t)frames * num_bins);
+            }
+            frames++;
+            next_frame_end += hop;
+        }
+    }
+
+    result->spectrogram_frames = frames;
+    result->rms_windows = windows;
+    result->peak_count = peak_count;
+    result->integrated_lufs = loudness_integrated(meter);
+
+    free(meter);
+    return 1;
+}
+
 // ============================================================================
 // AUDIO SIMILARITY
 // ============================================================================
@@ -340,6 +2985,296 @@ float calculate_audio_similarity(float* audio1, float* audio2, int length) {
     return dot_product / (sqrtf(norm1) * sqrtf(norm2));
 }
 
+// ============================================================================
+// CROSS-CORRELATION ALIGNMENT (GCC-PHAT)
+// ============================================================================
+
+static const int GCC_MIN_FFT = 1024;
+static const int GCC_MAX_FFT = 1 << 24;
+static const float GCC_MIN_CONFIDENCE = 0.1f;    // drift windows below this are skipped (noise peaks sit near 0.07-0.12)
+static const double GCC_PHAT_BETA = 0.8;         // 1 = pure PHAT; < 1 keeps near-empty bins from dominating
+static const int GCC_DIRECT_MAX_LAG = 1 << 14;   // larger searches go coarse-to-fine
+static const int GCC_MIN_BLOCK = 16;             // envelope block (samples) for the coarse search
+static const int GCC_REFINE_BLOCKS = 4;          // full-rate refinement radius, in blocks
+static const int GCC_REFINE_SPAN = 128;          // refined overlap, in multiples of the radius
+
+/**
+ * Frame-averaged GCC-PHAT correlation for lags in [-max_lag, max_lag]
+ * Both signals are cut into the same Hann-windowed frames of F >= 4*max_lag
+ * samples (50% overlap; the delayed frames start delayed_offset later) and
+ * zero-padded to 2F, so no lag wraps around. Equal windows keep spectral
+ * leakage coherent between the two signals, which matters for tonal content.
+ * Cross-spectra are summed, whitened once (PHAT-beta, |G|^-beta) and inverted once.
+ * corr: 2*max_lag+1 values, corr[max_lag + lag], scaled so a perfectly
+ * coherent spectrum peaks at 1
+ */
+static bool gcc_phat_correlate(const float* reference, int ref_count, const float* delayed, int delayed_count,
+                               int delayed_offset, int max_lag, float* corr) {
+    long long frame_length = GCC_MIN_FFT / 2;
+    while (frame_length < 4LL * max_lag) frame_length <<= 1;
+    while (frame_length > GCC_MIN_FFT / 2 && frame_length / 2 >= ref_count && frame_length / 2 >= 4LL * max_lag) {
+        frame_length >>= 1;
+    }
+    if (frame_length * 2 > GCC_MAX_FFT) return false;
+
+    int f = (int)frame_length;
+    int n = 2 * f;
+    int m = f;
+    int hop = f / 2;
+
+    FFTPlan* plan = create_plan(n);
+    float* window = (float*)malloc(f * sizeof(float));
+    float* frame = (float*)calloc(n, sizeof(float));
+    float* x_re = (float*)malloc((m + 1) * sizeof(float));
+    float* x_im = (float*)malloc((m + 1) * sizeof(float));
+    double* cross_re = (double*)calloc(m + 1, sizeof(double));
+    double* cross_im = (double*)calloc(m + 1, sizeof(double));
+
+    bool ok = plan && window && frame && x_re && x_im && cross_re && cross_im;
+    if (ok) {
+        for (int i = 0; i < f; i++) window[i] = (float)(0.5 * (1.0 - cos(2.0 * M_PI * (i + 0.5) / f)));
+    }
+
+    for (int t0 = 0; ok && t0 < ref_count; t0 += hop) {
+        long long y0 = (long long)delayed_offset + t0;
+        if (y0 >= delayed_count) break;
+
+        // Upper half of frame stays zero (padding)
+        for (int i = 0; i < f; i++) frame[i] = (t0 + i < ref_count) ? reference[t0 + i] * window[i] : 0.0f;
+        fft_real_forward(plan, frame, false);
+        memcpy(x_re, plan->spec_re, (m + 1) * sizeof(float));
+        memcpy(x_im, plan->spec_im, (m + 1) * sizeof(float));
+
+        for (int i = 0; i < f; i++) {
+            long long y = y0 + i;
+            frame[i] = (y >= 0 && y < delayed_count) ? delayed[y] * window[i] : 0.0f;
+        }
+        fft_real_forward(plan, frame, false);
+
+        // conj(X) * Y
+        for (int k = 0; k <= m; k++) {
+            float yr = plan->spec_re[k], yi = plan->spec_im[k];
+            cross_re[k] += (double)x_re[k] * yr + (double)x_im[k] * yi;
+            cross_im[k] += (double)x_re[k] * yi - (double)x_im[k] * yr;
+        }
+
+        if (t0 + f >= ref_count) break;
+    }
+
+    if (ok) {
+        // Whiten towards phase only; `bound` is the correlation peak if every bin agreed
+        double bound = 0.0;
+        for (int k = 0; k <= m; k++) {
+            double mag = sqrt(cross_re[k] * cross_re[k] + cross_im[k] * cross_im[k]);
+            double gain = (mag > 1e-30) ? pow(mag, -GCC_PHAT_BETA) : 0.0;
+            plan->spec_re[k] = (float)(cross_re[k] * gain);
+            plan->spec_im[k] = (float)(cross_im[k] * gain);
+            bound += ((k == 0 || k == m) ? 1.0 : 2.0) * mag * gain;
+        }
+        fft_real_inverse(plan, plan->spec_re, plan->spec_im, frame);
+
+        // Circular lag l sits at index l (mod n)
+        float scale = (bound > 0.0) ? (float)(n / bound) : 0.0f;
+        for (int lag = -max_lag; lag <= max_lag; lag++) {
+            corr[max_lag + lag] = frame[(lag + n) % n] * scale;
+        }
+    }
+
+    destroy_plan(plan);
+    free(window);
+    free(frame);
+    free(x_re); free(x_im);
+    free(cross_re); free(cross_im);
+    return ok;
+}
+
+/**
+ * Peak of a correlation with parabolic sub-sample refinement
+ * Returns peak value; *lag receives the offset from corr[max_lag]
+ */
+static float correlation_peak(const float* corr, int max_lag, float* lag) {
+    int best = 0;
+    for (int i = 1; i <= 2 * max_lag; i++) {
+        if (corr[i] > corr[best]) best = i;
+    }
+
+    float delta = 0.0f;
+    if (best > 0 && best < 2 * max_lag) {
+        float y0 = corr[best - 1], y1 = corr[best], y2 = corr[best + 1];
+        float denom = y0 - 2.0f * y1 + y2;
+        if (denom < 0.0f) delta = 0.5f * (y0 - y2) / denom;
+    }
+
+    *lag = (float)(best - max_lag) + delta;
+    return corr[best];
+}
+
+/**
+ * Mean-removed log energy of consecutive blocks (coarse-search signal)
+ */
+static float* gcc_envelope(const float* x, int count, int block, int* out_count) {
+    int blocks = (count + block - 1) / block;
+    float* env = (float*)malloc((size_t)blocks * sizeof(float));
+    if (!env) return nullptr;
+
+    double mean = 0.0;
+    for (int b = 0; b < blocks; b++) {
+        int start = b * block;
+        int end = (start + block < count) ? start + block : count;
+        float energy = 0.0f;
+        for (int i = start; i < end; i++) energy += x[i] * x[i];
+        env[b] = logf(1e-10f + energy / (end - start));
+        mean += env[b];
+    }
+
+    mean /= blocks;
+    for (int b = 0; b < blocks; b++) env[b] -= (float)mean;
+    *out_count = blocks;
+    return env;
+}
+
+/**
+ * Lag between two recordings by generalized cross-correlation (PHAT-beta weighting)
+ * delayed[t + lag] ~ reference[t], searched over |lag| <= max_lag samples
+ * (max_lag <= 0: every overlap). Up to GCC_DIRECT_MAX_LAG the full-rate
+ * correlation is searched directly; wider searches correlate block energy
+ * envelopes first (blocks sized so the envelope lag stays within
+ * GCC_DIRECT_MAX_LAG) and then refine at full rate within GCC_REFINE_BLOCKS
+ * blocks of that estimate, over a bounded stretch of the overlap. Cost is
+ * linear in the signal length either way.
+ * result: [lag_samples (sub-sample), confidence 0..1 = coherent share of the spectrum]
+ * Returns 1 on success
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int gcc_phat_lag(float* reference, int ref_count, float* delayed, int delayed_count, int max_lag, float* result) {
+    if (!reference || !delayed || !result || ref_count < 1 || delayed_count < 1) return 0;
+    if (max_lag <= 0) max_lag = (ref_count > delayed_count ? ref_count : delayed_count) - 1;
+    if (max_lag < 1) max_lag = 1;
+
+    int base = 0;
+    int search_lag = max_lag;
+    int ref_start = 0;
+
+    if (max_lag > GCC_DIRECT_MAX_LAG) {
+        int block = GCC_MIN_BLOCK;
+        while ((long long)block * GCC_DIRECT_MAX_LAG < max_lag) block <<= 1;
+
+        int ref_blocks = 0, delayed_blocks = 0;
+        float* ref_env = gcc_envelope(reference, ref_count, block, &ref_blocks);
+        float* delayed_env = gcc_envelope(delayed, delayed_count, block, &delayed_blocks);
+        int coarse_lag = (max_lag + block - 1) / block;
+        float* coarse = (float*)malloc(((size_t)2 * coarse_lag + 1) * sizeof(float));
+
+        bool ok = ref_env && delayed_env && coarse &&
+                  gcc_phat_correlate(ref_env, ref_blocks, delayed_env, delayed_blocks, 0, coarse_lag, coarse);
+        if (ok) {
+            float lag;
+            correlation_peak(coarse, coarse_lag, &lag);
+            base = (int)lrintf(lag * block);
+        }
+
+        free(ref_env);
+        free(delayed_env);
+        free(coarse);
+        if (!ok) return 0;
+        search_lag = GCC_REFINE_BLOCKS * block;
+
+        // Refine only where the aligned recordings overlap
+        ref_start = (base < 0) ? -base : 0;
+        int ref_end = (delayed_count - base < ref_count) ? delayed_count - base : ref_count;
+        if (ref_end - ref_start < 2 * search_lag) return 0;
+        if (ref_end - ref_start > GCC_REFINE_SPAN * search_lag) ref_end = ref_start + GCC_REFINE_SPAN * search_lag;
+        ref_count = ref_end - ref_start;
+    }
+
+    float* corr = (float*)malloc(((size_t)2 * search_lag + 1) * sizeof(float));
+    if (!corr) return 0;
+
+    int ok = gcc_phat_correlate(reference + ref_start, ref_count, delayed, delayed_count, base + ref_start,
+                                search_lag, corr);
+    if (ok) {
+        float lag;
+        float peak = correlation_peak(corr, search_lag, &lag);
+        result[0] = lag + base;
+        result[1] = fminf(fmaxf(peak, 0.0f), 1.0f);
+    }
+
+    free(corr);
+    return ok;
+}
+
+/**
+ * Clock drift between two recordings of the same content (e.g. A/V sync)
+ * Both signals are sampled at sample_rate. The starting offset is found by
+ * GCC-PHAT within +-max_lag samples on a short head segment (drift would
+ * smear a whole-signal correlation); each window of window_seconds is then
+ * searched within +-min(window/8, max_lag) of the last confident lag, so
+ * the track follows the drift, and the lags are fitted with a
+ * confidence-weighted line.
+ * result: [offset_seconds at t=0, drift_ppm, mean_confidence, windows_used]
+ * Returns 1 when at least two windows were usable
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int estimate_audio_drift(float* reference, float* delayed, int sample_count, int sample_rate,
+                         float window_seconds, int max_lag, float* result) {
+    if (!reference || !delayed || !result || sample_rate < 1 || window_seconds <= 0.0f || max_lag < 1) return 0;
+
+    int window = (int)(window_seconds * sample_rate);
+    int local_lag = window / 8;
+    if (local_lag > max_lag) local_lag = max_lag;
+    if (local_lag < 1 || sample_count < 2 * window) return 0;
+
+    int corr_size = 2 * max_lag + 1;
+    float* corr = (float*)malloc(corr_size * sizeof(float));
+    if (!corr) return 0;
+
+    int head = 16 * max_lag;
+    if (head < 2 * window) head = 2 * window;
+    if (head > sample_count) head = sample_count;
+
+    float start_lag;
+    if (!gcc_phat_correlate(reference, head, delayed, sample_count, 0, max_lag, corr)) {
+        free(corr);
+        return 0;
+    }
+    correlation_peak(corr, max_lag, &start_lag);
+    int base = (int)lrintf(start_lag);
+
+    double sw = 0.0, st = 0.0, sl = 0.0, stt = 0.0, stl = 0.0;
+    int used = 0;
+
+    for (int t0 = 0; t0 + window <= sample_count; t0 += window) {
+        if (!gcc_phat_correlate(reference + t0, window, delayed, sample_count, t0 + base, local_lag, corr)) break;
+
+        float lag;
+        float confidence = correlation_peak(corr, local_lag, &lag);
+        if (confidence < GCC_MIN_CONFIDENCE) continue;
+
+        double t = (t0 + window * 0.5) / sample_rate;
+        lag += base;
+        base = (int)lrintf(lag);
+        sw += confidence;
+        st += confidence * t;
+        sl += confidence * lag;
+        stt += confidence * t * t;
+        stl += confidence * t * lag;
+        used++;
+    }
+
+    free(corr);
+    if (used < 2) return 0;
+
+    double denom = sw * stt - st * st;
+    double slope = (denom > 0.0) ? (sw * stl - st * sl) / denom : 0.0;  // samples per second
+    double intercept = (sl - slope * st) / sw;
+
+    result[0] = (float)(intercept / sample_rate);
+    result[1] = (float)(slope / sample_rate * 1e6);
+    result[2] = (float)(sw / used);
+    result[3] = (float)used;
+    return 1;
+}
+
 // Memory management
 extern "C" EMSCRIPTEN_KEEPALIVE
 void* wasm_malloc(int size) { return malloc(size); }
@@ -22,6 +22,12 @@ echo ""
 COMMON_FLAGS="-O3 -s WASM=1 -s ALLOW_MEMORY_GROWTH=1 -s MODULARIZE=1"
 EXPORT_FLAGS="-s EXPORTED_RUNTIME_METHODS=['ccall','cwrap','getValue','setValue']"
 
+# Lets JS register frame callbacks (addFunction) for streaming APIs
+CALLBACK_FLAGS="-s ALLOW_TABLE_GROWTH=1 -s EXPORTED_RUNTIME_METHODS=['ccall','cwrap','getValue','setValue','addFunction','removeFunction']"
+
+# WebAssembly SIMD (lets the batched kernels auto-vectorize to 128-bit lanes)
+SIMD_FLAGS="-msimd128"
+
 # ============================================================================
 # 1. Frame Analyzer Module
 # ============================================================================
@@ -41,6 +47,18 @@ emcc "$CPP_DIR/frame_analyzer.cpp" \
         "_calculate_frame_quality",
         "_select_best_keyframe",
         "_select_representative_keyframes",
+        "_detect_active_area",
+        "_calculate_scene_change_score_roi",
+        "_detect_scene_changes_roi",
+        "_detect_black_frames_roi",
+        "_calculate_frame_brightness_roi",
+        "_calculate_motion_intensity_roi",
+        "_calculate_average_motion_roi",
+        "_calculate_sharpness_roi",
+        "_calculate_contrast_roi",
+        "_calculate_frame_quality_roi",
+        "_select_best_keyframe_roi",
+        "_select_representative_keyframes_roi",
         "_wasm_malloc",
         "_wasm_free"
     ]' \
@@ -50,7 +68,7 @@ emcc "$CPP_DIR/frame_analyzer.cpp" \
 # Also build standalone WASM for non-JS environments
 emcc "$CPP_DIR/frame_analyzer.cpp" \
     -O3 -s WASM=1 -s STANDALONE_WASM=1 \
-    -s EXPORTED_FUNCTIONS='["_calculate_scene_change_score","_detect_black_frames","_calculate_frame_quality","_select_best_keyframe","_wasm_malloc","_wasm_free"]' \
+    -s EXPORTED_FUNCTIONS='["_calculate_scene_change_score","_detect_black_frames","_calculate_frame_quality","_select_best_keyframe","_detect_active_area","_calculate_frame_quality_roi","_select_best_keyframe_roi","_wasm_malloc","_wasm_free"]' \
     -o "$WASM_OUTPUT_DIR/frame_analyzer.wasm"
 
 echo "✅ Frame Analyzer built successfully"
@@ -61,26 +79,80 @@ echo ""
 # ============================================================================
 echo "🎵 Building Audio Fingerprint..."
 emcc "$CPP_DIR/audio_fingerprint.cpp" \
-    $COMMON_FLAGS \
+    $COMMON_FLAGS $SIMD_FLAGS \
     -s EXPORT_NAME='AudioFingerprint' \
     -s EXPORTED_FUNCTIONS='[
+        "_create_audio_resampler",
+        "_destroy_audio_resampler",
+        "_reset_audio_resampler",
+        "_audio_resampler_max_output",
+        "_audio_resampler_process",
+        "_audio_resampler_flush",
+        "_get_resampled_length",
+        "_resample_audio",
+        "_create_fft_plan",
+        "_destroy_fft_plan",
+        "_compute_spectrogram_with_plan",
+        "_create_streaming_stft",
+        "_destroy_streaming_stft",
+        "_reset_streaming_stft",
+        "_stft_push_samples",
+        "_stft_pull_frames",
+        "_stft_queued_frames",
+        "_stft_frames_emitted",
+        "_stft_num_bins",
         "_compute_audio_spectrogram",
         "_get_spectrogram_frames",
         "_get_spectrogram_bins",
+        "_get_quantized_spectrogram_size",
+        "_compute_spectrogram_quantized_with_plan",
+        "_compute_audio_spectrogram_quantized",
+        "_create_mel_filterbank",
+        "_destroy_mel_filterbank",
+        "_mel_set_quantization_range",
+        "_get_mel_features_size",
+        "_compute_mel_features",
         "_compute_audio_fingerprint",
+        "_compute_audio_fingerprint_quantized",
+        "_compute_audio_fingerprint_from_audio",
         "_match_intro_fingerprint",
+        "_extract_landmarks",
+        "_extract_landmarks_quantized",
+        "_extract_landmarks_from_audio",
+        "_create_landmark_index",
+        "_destroy_landmark_index",
+        "_landmark_index_add_track",
+        "_landmark_index_build",
+        "_landmark_index_size",
+        "_landmark_index_query",
+        "_create_series_analyzer",
+        "_destroy_series_analyzer",
+        "_series_configure",
+        "_series_set_episode_audio",
+        "_series_set_episode_source_audio",
+        "_series_set_episode_hashes",
+        "_series_analyze",
         "_detect_audio_peaks",
         "_detect_intro_boundaries",
+        "_create_intro_energy_analyzer",
+        "_destroy_intro_energy_analyzer",
+        "_reset_intro_energy_analyzer",
+        "_intro_energy_push",
+        "_intro_energy_window_count",
+        "_intro_energy_analyze",
+        "_analyze_audio",
         "_calculate_audio_similarity",
+        "_gcc_phat_lag",
+        "_estimate_audio_drift",
         "_wasm_malloc",
         "_wasm_free"
     ]' \
-    $EXPORT_FLAGS \
+    $EXPORT_FLAGS $CALLBACK_FLAGS \
     -o "$JS_OUTPUT_DIR/audio_fingerprint.js"
 
 emcc "$CPP_DIR/audio_fingerprint.cpp" \
-    -O3 -s WASM=1 -s STANDALONE_WASM=1 \
-    -s EXPORTED_FUNCTIONS='["_compute_audio_spectrogram","_detect_intro_boundaries","_match_intro_fingerprint","_wasm_malloc","_wasm_free"]' \
+    -O3 -s WASM=1 -s STANDALONE_WASM=1 $SIMD_FLAGS \
+    -s EXPORTED_FUNCTIONS='["_create_audio_resampler","_destroy_audio_resampler","_audio_resampler_max_output","_audio_resampler_process","_audio_resampler_flush","_get_resampled_length","_resample_audio","_create_fft_plan","_destroy_fft_plan","_compute_spectrogram_with_plan","_create_streaming_stft","_destroy_streaming_stft","_stft_push_samples","_stft_pull_frames","_compute_audio_spectrogram","_compute_audio_spectrogram_quantized","_create_mel_filterbank","_destroy_mel_filterbank","_get_mel_features_size","_compute_mel_features","_detect_intro_boundaries","_create_intro_energy_analyzer","_destroy_intro_energy_analyzer","_intro_energy_push","_intro_energy_analyze","_analyze_audio","_match_intro_fingerprint","_extract_landmarks","_extract_landmarks_quantized","_extract_landmarks_from_audio","_compute_audio_fingerprint_from_audio","_create_landmark_index","_destroy_landmark_index","_landmark_index_add_track","_landmark_index_build","_landmark_index_query","_create_series_analyzer","_destroy_series_analyzer","_series_configure","_series_set_episode_audio","_series_set_episode_source_audio","_series_set_episode_hashes","_series_analyze","_gcc_phat_lag","_estimate_audio_drift","_wasm_malloc","_wasm_free"]' \
     -o "$WASM_OUTPUT_DIR/audio_fingerprint.wasm"
 
 echo "✅ Audio Fingerprint built successfully"
@@ -91,7 +163,7 @@ echo ""
 # ============================================================================
 echo "📊 Building ABR Controller..."
 emcc "$CPP_DIR/abr_controller.cpp" \
-    $COMMON_FLAGS \
+    $COMMON_FLAGS $SIMD_FLAGS \
     -s EXPORT_NAME='ABRController' \
     -s EXPORTED_FUNCTIONS='[
         "_predict_bandwidth",
@@ -105,6 +177,43 @@ emcc "$CPP_DIR/abr_controller.cpp" \
         "_select_quality_maximize_qoe",
         "_calculate_bandwidth_variance",
         "_get_comprehensive_recommendation",
+        "_create_abr_ladder",
+        "_create_abr_ladder_from_playlist",
+        "_destroy_abr_ladder",
+        "_abr_ladder_set_segment_sizes",
+        "_abr_ladder_size",
+        "_abr_ladder_rung",
+        "_select_quality_level_ladder",
+        "_select_quality_stable_ladder",
+        "_estimate_qoe_ladder",
+        "_select_quality_maximize_qoe_ladder",
+        "_get_comprehensive_recommendation_ladder",
+        "_select_quality_level_batch",
+        "_get_recommendation_batch",
+        "_predict_next_requests_batch",
+        "_create_abr_session",
+        "_destroy_abr_session",
+        "_reset_abr_session",
+        "_abr_session_on_segment_downloaded",
+        "_abr_session_set_quality",
+        "_abr_session_seek",
+        "_abr_session_predicted_bandwidth",
+        "_abr_session_bandwidth_variance",
+        "_abr_session_trend",
+        "_abr_session_recommend",
+        "_abr_session_on_chunk",
+        "_abr_session_recommend_low_latency",
+        "_select_quality_mpc",
+        "_create_mpc_table",
+        "_create_mpc_table_from_data",
+        "_destroy_mpc_table",
+        "_mpc_table_data",
+        "_mpc_table_size",
+        "_mpc_table_lookup",
+        "_abr_session_recommend_mpc",
+        "_select_quality_bola",
+        "_abr_session_recommend_bola",
+        "_simulate_abr_trace",
         "_wasm_malloc",
         "_wasm_free"
     ]' \
@@ -112,8 +221,8 @@ emcc "$CPP_DIR/abr_controller.cpp" \
     -o "$JS_OUTPUT_DIR/abr_controller.js"
 
 emcc "$CPP_DIR/abr_controller.cpp" \
-    -O3 -s WASM=1 -s STANDALONE_WASM=1 \
-    -s EXPORTED_FUNCTIONS='["_select_quality_level","_predict_bandwidth","_calculate_buffer_health","_get_comprehensive_recommendation","_wasm_malloc","_wasm_free"]' \
+    -O3 -s WASM=1 -s STANDALONE_WASM=1 $SIMD_FLAGS \
+    -s EXPORTED_FUNCTIONS='["_select_quality_level","_predict_bandwidth","_calculate_buffer_health","_get_comprehensive_recommendation","_create_abr_ladder","_create_abr_ladder_from_playlist","_destroy_abr_ladder","_abr_ladder_set_segment_sizes","_select_quality_level_ladder","_get_comprehensive_recommendation_ladder","_select_quality_level_batch","_get_recommendation_batch","_predict_next_requests_batch","_create_abr_session","_destroy_abr_session","_abr_session_on_segment_downloaded","_abr_session_set_quality","_abr_session_seek","_abr_session_recommend","_abr_session_on_chunk","_abr_session_recommend_low_latency","_create_mpc_table","_destroy_mpc_table","_mpc_table_lookup","_abr_session_recommend_mpc","_select_quality_bola","_abr_session_recommend_bola","_wasm_malloc","_wasm_free"]' \
     -o "$WASM_OUTPUT_DIR/abr_controller.wasm"
 
 echo "✅ ABR Controller built successfully"
@@ -137,6 +246,10 @@ emcc "$CPP_DIR/video_hash.cpp" \
         "_compute_video_fingerprint",
         "_get_fingerprint_length",
         "_find_matching_scene",
+        "_compute_phash_roi",
+        "_compute_ahash_roi",
+        "_compute_dhash_roi",
+        "_compute_video_fingerprint_roi",
         "_wasm_malloc",
         "_wasm_free"
     ]' \
@@ -145,7 +258,7 @@ emcc "$CPP_DIR/video_hash.cpp" \
 
 emcc "$CPP_DIR/video_hash.cpp" \
     -O3 -s WASM=1 -s STANDALONE_WASM=1 \
-    -s EXPORTED_FUNCTIONS='["_compute_phash","_compare_video_hashes","_detect_duplicate_content","_wasm_malloc","_wasm_free"]' \
+    -s EXPORTED_FUNCTIONS='["_compute_phash","_compute_phash_roi","_compare_video_hashes","_detect_duplicate_content","_wasm_malloc","_wasm_free"]' \
     -o "$WASM_OUTPUT_DIR/video_hash.wasm"
 
 echo "✅ Video Hash built successfully"
@@ -156,7 +269,7 @@ echo ""
 # ============================================================================
 echo "🎨 Building Color Analyzer..."
 emcc "$CPP_DIR/color_analyzer.cpp" \
-    $COMMON_FLAGS \
+    $COMMON_FLAGS $SIMD_FLAGS \
     -s EXPORT_NAME='ColorAnalyzer' \
     -s EXPORTED_FUNCTIONS='[
         "_calculate_color_histogram",
@@ -167,8 +280,21 @@ emcc "$CPP_DIR/color_analyzer.cpp" \
         "_calculate_thumbnail_score",
         "_select_best_thumbnail_frame",
         "_select_best_thumbnail_from_histograms",
+        "_convert_rgb_to_lab",
         "_calculate_color_distance",
+        "_calculate_delta_e_batch",
+        "_match_color_palettes",
+        "_match_palette_against_catalog",
         "_compare_color_histograms",
+        "_compute_histogram_similarity_matrix",
+        "_compute_histogram_top_k",
+        "_calculate_color_histogram_roi",
+        "_calculate_hsv_histogram_roi",
+        "_calculate_colorfulness_score_roi",
+        "_calculate_dominant_color_roi",
+        "_extract_color_palette_roi",
+        "_calculate_thumbnail_score_roi",
+        "_select_best_thumbnail_frame_roi",
         "_wasm_malloc",
         "_wasm_free"
     ]' \
@@ -176,13 +302,40 @@ emcc "$CPP_DIR/color_analyzer.cpp" \
     -o "$JS_OUTPUT_DIR/color_analyzer.js"
 
 emcc "$CPP_DIR/color_analyzer.cpp" \
-    -O3 -s WASM=1 -s STANDALONE_WASM=1 \
-    -s EXPORTED_FUNCTIONS='["_calculate_colorfulness_score","_select_best_thumbnail_frame","_extract_color_palette","_wasm_malloc","_wasm_free"]' \
+    -O3 -s WASM=1 -s STANDALONE_WASM=1 $SIMD_FLAGS \
+    -s EXPORTED_FUNCTIONS='["_calculate_colorfulness_score","_select_best_thumbnail_frame","_extract_color_palette","_select_best_thumbnail_frame_roi","_compute_histogram_similarity_matrix","_compute_histogram_top_k","_convert_rgb_to_lab","_match_palette_against_catalog","_wasm_malloc","_wasm_free"]' \
     -o "$WASM_OUTPUT_DIR/color_analyzer.wasm"
 
 echo "✅ Color Analyzer built successfully"
 echo ""
 
+# ============================================================================
+# 6. Storyboard Module
+# ============================================================================
+echo "🎞️  Building Storyboard..."
+emcc "$CPP_DIR/storyboard.cpp" \
+    $COMMON_FLAGS $SIMD_FLAGS \
+    -s EXPORT_NAME='Storyboard' \
+    -s EXPORTED_FUNCTIONS='[
+        "_resample_frame_rgb",
+        "_get_storyboard_sheet_count",
+        "_generate_storyboard",
+        "_build_storyboard_index",
+        "_generate_storyboard_vtt",
+        "_wasm_malloc",
+        "_wasm_free"
+    ]' \
+    $EXPORT_FLAGS \
+    -o "$JS_OUTPUT_DIR/storyboard.js"
+
+emcc "$CPP_DIR/storyboard.cpp" \
+    -O3 -s WASM=1 -s STANDALONE_WASM=1 $SIMD_FLAGS \
+    -s EXPORTED_FUNCTIONS='["_generate_storyboard","_get_storyboard_sheet_count","_generate_storyboard_vtt","_wasm_malloc","_wasm_free"]' \
+    -o "$WASM_OUTPUT_DIR/storyboard.wasm"
+
+echo "✅ Storyboard built successfully"
+echo ""
+
 # ============================================================================
 # Summary
 # ============================================================================
@@ -9,91 +9,140 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "histogram_engine.h"
+#include "frame_region.h"
+
 // ============================================================================
 // COLOR HISTOGRAM
 // ============================================================================
 
+template <int BINS>
+static void color_histogram_fixed(const FrameRegion& region, float* histogram) {
+    HistogramEngine<BINS, RgbLayout> engine;
+    for (int y = 0; y < region.height; y++) {
+        engine.accumulate(region.row(y), region.width);
+    }
+    engine.merge_normalized(histogram);
+}
+
 /**
- * Calculate RGB color histogram
- * Returns array of size bins*3 (R, G, B histograms concatenated)
+ * Runtime bin counts: bin at full resolution, then fold into `bins` bins
  */
-extern "C" EMSCRIPTEN_KEEPALIVE
-float* calculate_color_histogram(uint8_t* frame_data, int width, int height, int bins) {
-    if (!frame_data || width <= 0 || height <= 0 || bins < 1) return nullptr;
+static void color_histogram_folded(const FrameRegion& region, int bins, float* histogram) {
+    HistogramEngine<256, RgbLayout> engine;
+    for (int y = 0; y < region.height; y++) {
+        engine.accumulate(region.row(y), region.width);
+    }
+
+    uint32_t full[3 * 256];
+    uint32_t folded[256];
+    engine.merge(full);
+
+    int total_pixels = region.pixel_count();
+    for (int c = 0; c < 3; c++) {
+        fold_histogram_256(full + c * 256, bins, folded);
+        for (int b = 0; b < bins; b++) {
+            histogram[c * bins + b] = (float)folded[b] / total_pixels;
+        }
+    }
+}
+
+static float* color_histogram_region(const FrameRegion& region, int bins) {
+    if (region.pixel_count() <= 0 || bins < 1 || bins > 256) return nullptr;
     
     float* histogram = (float*)calloc(bins * 3, sizeof(float));
     if (!histogram) return nullptr;
     
-    int total_pixels = width * height;
-    int bin_size = 256 / bins;
-    
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        histogram[frame_data[idx] / bin_size]++;                    // R
-        histogram[bins + frame_data[idx + 1] / bin_size]++;         // G
-        histogram[2 * bins + frame_data[idx + 2] / bin_size]++;     // B
-    }
-    
-    // Normalize
-    for (int i = 0; i < bins * 3; i++) {
-        histogram[i] /= total_pixels;
+    switch (bins) {
+        case 1:   color_histogram_fixed<1>(region, histogram); break;
+        case 2:   color_histogram_fixed<2>(region, histogram); break;
+        case 4:   color_histogram_fixed<4>(region, histogram); break;
+        case 8:   color_histogram_fixed<8>(region, histogram); break;
+        case 16:  color_histogram_fixed<16>(region, histogram); break;
+        case 32:  color_histogram_fixed<32>(region, histogram); break;
+        case 64:  color_histogram_fixed<64>(region, histogram); break;
+        case 128: color_histogram_fixed<128>(region, histogram); break;
+        case 256: color_histogram_fixed<256>(region, histogram); break;
+        default:  color_histogram_folded(region, bins, histogram); break;
     }
     
     return histogram;
 }
 
 /**
- * Calculate HSV histogram (more perceptually meaningful)
+ * Calculate RGB color histogram
+ * Returns array of size bins*3 (R, G, B histograms concatenated)
+ * bins must be in [1, 256]; counts that do not divide 256 get near-equal-width bins
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-float* calculate_hsv_histogram(uint8_t* frame_data, int width, int height, 
-                               int h_bins, int s_bins, int v_bins) {
+float* calculate_color_histogram(uint8_t* frame_data, int width, int height, int bins) {
+    if (!frame_data || width <= 0 || height <= 0) return nullptr;
+    
+    return color_histogram_region(full_frame_region(frame_data, width, height), bins);
+}
+
+/**
+ * Calculate RGB color histogram over a region of interest
+ * roi_w / roi_h <= 0 extend to the frame edge; stride <= 0 means width * 3
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* calculate_color_histogram_roi(uint8_t* frame_data, int width, int height, int bins,
+                                     int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
     if (!frame_data || width <= 0 || height <= 0) return nullptr;
     
+    return color_histogram_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride), bins);
+}
+
+static float* hsv_histogram_region(const FrameRegion& region, int h_bins, int s_bins, int v_bins) {
+    int total_pixels = region.pixel_count();
+    if (total_pixels <= 0 || h_bins < 1 || s_bins < 1 || v_bins < 1) return nullptr;
+
     int total_bins = h_bins + s_bins + v_bins;
     float* histogram = (float*)calloc(total_bins, sizeof(float));
     if (!histogram) return nullptr;
     
-    int total_pixels = width * height;
+    for (int y = 0; y < region.height; y++) {
+        const uint8_t* row = region.row(y);
     
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        float r = frame_data[idx] / 255.0f;
-        float g = frame_data[idx + 1] / 255.0f;
-        float b = frame_data[idx + 2] / 255.0f;
+        for (int x = 0; x < region.width; x++) {
+            int idx = x * 3;
+            float r = row[idx] / 255.0f;
+            float g = row[idx + 1] / 255.0f;
+            float b = row[idx + 2] / 255.0f;
         
-        // RGB to HSV conversion
-        float max_val = fmaxf(r, fmaxf(g, b));
-        float min_val = fminf(r, fminf(g, b));
-        float delta = max_val - min_val;
+            // RGB to HSV conversion
+            float max_val = fmaxf(r, fmaxf(g, b));
+            float min_val = fminf(r, fminf(g, b));
+            float delta = max_val - min_val;
         
-        float h = 0, s = 0, v = max_val;
+            float h = 0, s = 0, v = max_val;
         
-        if (max_val > 0 && delta > 0) {
-            s = delta / max_val;
+            if (max_val > 0 && delta > 0) {
+                s = delta / max_val;
             
-            if (r == max_val) {
-                h = 60.0f * fmodf((g - b) / delta, 6.0f);
-            } else if (g == max_val) {
-                h = 60.0f * ((b - r) / delta + 2.0f);
-            } else {
-                h = 60.0f * ((r - g) / delta + 4.0f);
-            }
+                if (r == max_val) {
+                    h = 60.0f * fmodf((g - b) / delta, 6.0f);
+                } else if (g == max_val) {
+                    h = 60.0f * ((b - r) / delta + 2.0f);
+                } else {
+                    h = 60.0f * ((r - g) / delta + 4.0f);
+                }
             
-            if (h < 0) h += 360.0f;
-        }
+                if (h < 0) h += 360.0f;
+            }
         
-        // Bin the values
-        int h_bin = (int)(h / 360.0f * h_bins) % h_bins;
-        int s_bin = (int)(s * s_bins);
-        int v_bin = (int)(v * v_bins);
+            // Bin the values
+            int h_bin = (int)(h / 360.0f * h_bins) % h_bins;
+            int s_bin = (int)(s * s_bins);
+            int v_bin = (int)(v * v_bins);
         
-        if (s_bin >= s_bins) s_bin = s_bins - 1;
-        if (v_bin >= v_bins) v_bin = v_bins - 1;
+            if (s_bin >= s_bins) s_bin = s_bins - 1;
+            if (v_bin >= v_bins) v_bin = v_bins - 1;
         
-        histogram[h_bin]++;
-        histogram[h_bins + s_bin]++;
-        histogram[h_bins + s_bins + v_bin]++;
+            histogram[h_bin]++;
+            histogram[h_bins + s_bin]++;
+            histogram[h_bins + s_bins + v_bin]++;
+        }
     }
     
     // Normalize
@@ -104,37 +153,56 @@ float* calculate_hsv_histogram(uint8_t* frame_data, int width, int height,
     return histogram;
 }
 
-// ============================================================================
-// COLOR METRICS
-// ============================================================================
-
 /**
- * Calculate colorfulness score using Hasler & Süsstrunk method
- * Higher values indicate more colorful images
+ * Calculate HSV histogram (more perceptually meaningful)
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-float calculate_colorfulness_score(uint8_t* frame_data, int width, int height) {
-    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+float* calculate_hsv_histogram(uint8_t* frame_data, int width, int height, 
+                               int h_bins, int s_bins, int v_bins) {
+    if (!frame_data || width <= 0 || height <= 0) return nullptr;
+    
+    return hsv_histogram_region(full_frame_region(frame_data, width, height), h_bins, s_bins, v_bins);
+}
     
-    int total_pixels = width * height;
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* calculate_hsv_histogram_roi(uint8_t* frame_data, int width, int height,
+                                   int h_bins, int s_bins, int v_bins,
+                                   int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return nullptr;
+    
+    return hsv_histogram_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride),
+                                h_bins, s_bins, v_bins);
+}
+
+// ============================================================================
+// COLOR METRICS
+// ============================================================================
+    
+static float colorfulness_region(const FrameRegion& region) {
+    int total_pixels = region.pixel_count();
+    if (total_pixels <= 0) return 0.0f;
     
     double sum_rg = 0, sum_yb = 0;
     double sum_rg_sq = 0, sum_yb_sq = 0;
     
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        float r = frame_data[idx];
-        float g = frame_data[idx + 1];
-        float b = frame_data[idx + 2];
+    for (int y = 0; y < region.height; y++) {
+        const uint8_t* row = region.row(y);
+        
+        for (int x = 0; x < region.width; x++) {
+            int idx = x * 3;
+            float r = row[idx];
+            float g = row[idx + 1];
+            float b = row[idx + 2];
         
-        // rg = R - G, yb = 0.5*(R+G) - B
-        float rg = r - g;
-        float yb = 0.5f * (r + g) - b;
+            // rg = R - G, yb = 0.5*(R+G) - B
+            float rg = r - g;
+            float yb = 0.5f * (r + g) - b;
         
-        sum_rg += rg;
-        sum_yb += yb;
-        sum_rg_sq += rg * rg;
-        sum_yb_sq += yb * yb;
+            sum_rg += rg;
+            sum_yb += yb;
+            sum_rg_sq += rg * rg;
+            sum_yb_sq += yb * yb;
+        }
     }
     
     // Calculate standard deviations and means
@@ -151,34 +219,47 @@ float calculate_colorfulness_score(uint8_t* frame_data, int width, int height) {
 }
 
 /**
- * Calculate dominant color (mode of histogram)
- * Returns [R, G, B] of dominant color
+ * Calculate colorfulness score using Hasler & Süsstrunk method
+ * Higher values indicate more colorful images
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-float* calculate_dominant_color(uint8_t* frame_data, int width, int height) {
-    if (!frame_data || width <= 0 || height <= 0) return nullptr;
+float calculate_colorfulness_score(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    return colorfulness_region(full_frame_region(frame_data, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_colorfulness_score_roi(uint8_t* frame_data, int width, int height,
+                                       int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    return colorfulness_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride));
+}
+
+static float* dominant_color_region(const FrameRegion& region) {
+    if (region.pixel_count() <= 0) return nullptr;
     
     float* result = (float*)malloc(3 * sizeof(float));
     if (!result) return nullptr;
     
     // Use 16-bin histogram for each channel
-    int bins = 16;
-    int histogram_r[16] = {0};
-    int histogram_g[16] = {0};
-    int histogram_b[16] = {0};
+    const int bins = 16;
+    const int bin_size = 256 / bins;
     
-    int total_pixels = width * height;
-    int bin_size = 256 / bins;
-    
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        histogram_r[frame_data[idx] / bin_size]++;
-        histogram_g[frame_data[idx + 1] / bin_size]++;
-        histogram_b[frame_data[idx + 2] / bin_size]++;
+    HistogramEngine<bins, RgbLayout> engine;
+    for (int y = 0; y < region.height; y++) {
+        engine.accumulate(region.row(y), region.width);
     }
     
+    uint32_t counts[3 * bins];
+    engine.merge(counts);
+    const uint32_t* histogram_r = counts;
+    const uint32_t* histogram_g = counts + bins;
+    const uint32_t* histogram_b = counts + 2 * bins;
+    
     // Find peak bins
-    int max_r = 0, max_g = 0, max_b = 0;
+    uint32_t max_r = 0, max_g = 0, max_b = 0;
     int peak_r = 0, peak_g = 0, peak_b = 0;
     
     for (int i = 0; i < bins; i++) {
@@ -196,26 +277,45 @@ float* calculate_dominant_color(uint8_t* frame_data, int width, int height) {
 }
 
 /**
- * Calculate color palette (top N colors)
- * Uses k-means clustering
+ * Calculate dominant color (mode of histogram)
+ * Returns [R, G, B] of dominant color
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-float* extract_color_palette(uint8_t* frame_data, int width, int height, int num_colors) {
-    if (!frame_data || width <= 0 || height <= 0 || num_colors < 1) return nullptr;
+float* calculate_dominant_color(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width <= 0 || height <= 0) return nullptr;
+
+    return dominant_color_region(full_frame_region(frame_data, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* calculate_dominant_color_roi(uint8_t* frame_data, int width, int height,
+                                    int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return nullptr;
+
+    return dominant_color_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride));
+}
+
+// n-th pixel of the region in raster order
+static inline const uint8_t* region_sample(const FrameRegion& region, int n) {
+    return region.pixel(n % region.width, n / region.width);
+}
+
+static float* color_palette_region(const FrameRegion& region, int num_colors) {
+    int total_pixels = region.pixel_count();
+    if (total_pixels <= 0 || num_colors < 1) return nullptr;
     
     float* palette = (float*)malloc(num_colors * 3 * sizeof(float));
     if (!palette) return nullptr;
     
-    int total_pixels = width * height;
     int sample_step = (total_pixels > 10000) ? total_pixels / 10000 : 1;
     int sample_count = total_pixels / sample_step;
     
     // Initialize centroids randomly from image
     for (int c = 0; c < num_colors; c++) {
-        int idx = ((c * total_pixels / num_colors) % total_pixels) * 3;
-        palette[c * 3] = frame_data[idx];
-        palette[c * 3 + 1] = frame_data[idx + 1];
-        palette[c * 3 + 2] = frame_data[idx + 2];
+        const uint8_t* p = region_sample(region, (int)((long long)c * total_pixels / num_colors % total_pixels));
+        palette[c * 3] = p[0];
+        palette[c * 3 + 1] = p[1];
+        palette[c * 3 + 2] = p[2];
     }
     
     // K-means iterations
@@ -231,10 +331,10 @@ float* extract_color_palette(uint8_t* frame_data, int width, int height, int num
     for (int iter = 0; iter < 10; iter++) {
         // Assign pixels to nearest centroid
         for (int i = 0; i < sample_count; i++) {
-            int pixel_idx = (i * sample_step) * 3;
-            float r = frame_data[pixel_idx];
-            float g = frame_data[pixel_idx + 1];
-            float b = frame_data[pixel_idx + 2];
+            const uint8_t* p = region_sample(region, i * sample_step);
+            float r = p[0];
+            float g = p[1];
+            float b = p[2];
             
             float min_dist = 1e10f;
             int best_c = 0;
@@ -259,12 +359,12 @@ float* extract_color_palette(uint8_t* frame_data, int width, int height, int num
         memset(counts, 0, num_colors * sizeof(int));
         
         for (int i = 0; i < sample_count; i++) {
-            int pixel_idx = (i * sample_step) * 3;
+            const uint8_t* p = region_sample(region, i * sample_step);
             int c = assignments[i];
             
-            new_centroids[c * 3] += frame_data[pixel_idx];
-            new_centroids[c * 3 + 1] += frame_data[pixel_idx + 1];
-            new_centroids[c * 3 + 2] += frame_data[pixel_idx + 2];
+            new_centroids[c * 3] += p[0];
+            new_centroids[c * 3 + 1] += p[1];
+            new_centroids[c * 3 + 2] += p[2];
             counts[c]++;
         }
         
@@ -284,45 +384,58 @@ float* extract_color_palette(uint8_t* frame_data, int width, int height, int num
     return palette;
 }
 
+/**
+ * Calculate color palette (top N colors)
+ * Uses k-means clustering
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* extract_color_palette(uint8_t* frame_data, int width, int height, int num_colors) {
+    if (!frame_data || width <= 0 || height <= 0) return nullptr;
+
+    return color_palette_region(full_frame_region(frame_data, width, height), num_colors);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* extract_color_palette_roi(uint8_t* frame_data, int width, int height, int num_colors,
+                                 int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return nullptr;
+
+    return color_palette_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride),
+                                num_colors);
+}
+
 // ============================================================================
 // THUMBNAIL SELECTION
 // ============================================================================
 
-/**
- * Calculate thumbnail score for a frame
- * Considers colorfulness, contrast, brightness, and sharpness
- */
-extern "C" EMSCRIPTEN_KEEPALIVE
-float calculate_thumbnail_score(uint8_t* frame_data, int width, int height) {
-    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+static float thumbnail_score_region(const FrameRegion& region) {
+    int total_pixels = region.pixel_count();
+    if (total_pixels <= 0) return 0.0f;
     
     // Calculate colorfulness
-    float colorfulness = calculate_colorfulness_score(frame_data, width, height);
+    float colorfulness = colorfulness_region(region);
     float norm_colorfulness = fminf(colorfulness / 100.0f, 1.0f);
     
-    // Calculate brightness
-    int total_pixels = width * height;
+    // Calculate brightness and contrast range in one pass
     float total_brightness = 0.0f;
+    float min_lum = 255.0f, max_lum = 0.0f;
     
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        total_brightness += 0.299f * frame_data[idx] + 
-                           0.587f * frame_data[idx + 1] + 
-                           0.114f * frame_data[idx + 2];
+    for (int y = 0; y < region.height; y++) {
+        const uint8_t* row = region.row(y);
+    
+        for (int x = 0; x < region.width; x++) {
+            int idx = x * 3;
+            float lum = 0.299f * row[idx] + 0.587f * row[idx + 1] + 0.114f * row[idx + 2];
+            total_brightness += lum;
+            if (lum < min_lum) min_lum = lum;
+            if (lum > max_lum) max_lum = lum;
+        }
     }
     float avg_brightness = total_brightness / total_pixels;
     
     // Brightness score (prefer mid-range brightness)
     float brightness_score = 1.0f - fabsf(avg_brightness - 127.5f) / 127.5f;
     
-    // Calculate contrast
-    float min_lum = 255.0f, max_lum = 0.0f;
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        float lum = 0.299f * frame_data[idx] + 0.587f * frame_data[idx + 1] + 0.114f * frame_data[idx + 2];
-        if (lum < min_lum) min_lum = lum;
-        if (lum > max_lum) max_lum = lum;
-    }
     float contrast = (max_lum + min_lum > 0) ? (max_lum - min_lum) / (max_lum + min_lum) : 0.0f;
     
     // Weighted score
@@ -334,29 +447,52 @@ float calculate_thumbnail_score(uint8_t* frame_data, int width, int height) {
 }
 
 /**
- * Select best thumbnail frame from multiple frames
+ * Calculate thumbnail score for a frame
+ * Considers colorfulness, contrast, brightness, and sharpness
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_thumbnail_score(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    return thumbnail_score_region(full_frame_region(frame_data, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_thumbnail_score_roi(uint8_t* frame_data, int width, int height,
+                                    int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    return thumbnail_score_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride));
+}
+
+/**
+ * Select best thumbnail frame from multiple frames, scoring only the ROI
+ * Frames are contiguous, each stride * height bytes
  * Returns index of best frame
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-int select_best_thumbnail_frame(uint8_t* frames_data, int frame_count, int width, int height) {
-    if (!frames_data || frame_count < 1) return 0;
+int select_best_thumbnail_frame_roi(uint8_t* frames_data, int frame_count, int width, int height,
+                                    int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frames_data || frame_count < 1 || width <= 0 || height <= 0) return 0;
     
-    int frame_size = width * height * 3;
     float best_score = -1.0f;
     int best_idx = 0;
     
     for (int i = 0; i < frame_count; i++) {
-        uint8_t* frame = frames_data + i * frame_size;
+        FrameRegion frame = sequence_frame_region(frames_data, i, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+        if (frame.pixel_count() <= 0) return 0;
         
         // Skip very dark frames
         float total_brightness = 0.0f;
-        for (int p = 0; p < width * height; p++) {
-            int idx = p * 3;
-            total_brightness += frame[idx] + frame[idx + 1] + frame[idx + 2];
+        for (int y = 0; y < frame.height; y++) {
+            const uint8_t* row = frame.row(y);
+            for (int x = 0; x < frame.width * 3; x++) {
+                total_brightness += row[x];
+            }
         }
-        if (total_brightness / (width * height * 3) < 30) continue;
+        if (total_brightness / (frame.pixel_count() * 3) < 30) continue;
         
-        float score = calculate_thumbnail_score(frame, width, height);
+        float score = thumbnail_score_region(frame);
         
         if (score > best_score) {
             best_score = score;
@@ -367,6 +503,15 @@ int select_best_thumbnail_frame(uint8_t* frames_data, int frame_count, int width
     return best_idx;
 }
 
+/**
+ * Select best thumbnail frame from multiple frames
+ * Returns index of best frame
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_best_thumbnail_frame(uint8_t* frames_data, int frame_count, int width, int height) {
+    return select_best_thumbnail_frame_roi(frames_data, frame_count, width, height, 0, 0, 0, 0, 0);
+}
+
 /**
  * Select best thumbnail using histogram comparison
  * Returns index of best frame (avoiding similar frames)
@@ -405,21 +550,286 @@ int select_best_thumbnail_from_histograms(float* histograms, int frame_count, in
     return best_idx;
 }
 
+// ============================================================================
+// CIELAB CONVERSION
+// ============================================================================
+
+// D65 reference white
+static const float LAB_XN = 0.95047f;
+static const float LAB_YN = 1.00000f;
+static const float LAB_ZN = 1.08883f;
+
+// sRGB transfer curve sampled at every 8-bit code value (plus one guard entry)
+static float srgb_linear_lut[257];
+static bool srgb_linear_lut_ready = false;
+
+static void init_srgb_linear_lut() {
+    if (srgb_linear_lut_ready) return;
+
+    for (int i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        srgb_linear_lut[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    srgb_linear_lut[256] = srgb_linear_lut[255];
+    srgb_linear_lut_ready = true;
+}
+
+/**
+ * Linearize an sRGB channel value in [0, 255]
+ * Interpolates between LUT entries so fractional palette values stay accurate
+ */
+static inline float srgb_to_linear(float v) {
+    if (v <= 0.0f) return 0.0f;
+    if (v >= 255.0f) return srgb_linear_lut[255];
+
+    int i = (int)v;
+    float t = v - i;
+    return srgb_linear_lut[i] + t * (srgb_linear_lut[i + 1] - srgb_linear_lut[i]);
+}
+
+/**
+ * Cube root for x > 0: exponent-divide bit trick followed by two Halley steps
+ */
+static inline float fast_cbrtf(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = bits / 3 + 709921077u;
+
+    float y;
+    memcpy(&y, &bits, sizeof(y));
+
+    float y3 = y * y * y;
+    y = y * (y3 + 2.0f * x) / (2.0f * y3 + x);
+    y3 = y * y * y;
+    y = y * (y3 + 2.0f * x) / (2.0f * y3 + x);
+    return y;
+}
+
+// CIE f(t): cube root above (6/29)^3, linear segment below
+static inline float lab_f(float t) {
+    const float EPSILON = 0.008856452f;   // (6/29)^3
+    const float KAPPA_SLOPE = 7.787037f;  // 1 / (3 * (6/29)^2)
+    return (t > EPSILON) ? fast_cbrtf(t) : KAPPA_SLOPE * t + 4.0f / 29.0f;
+}
+
+static inline void rgb_to_lab(float r, float g, float b, float* lab) {
+    float lr = srgb_to_linear(r);
+    float lg = srgb_to_linear(g);
+    float lb = srgb_to_linear(b);
+
+    float x = 0.4124564f * lr + 0.3575761f * lg + 0.1804375f * lb;
+    float y = 0.2126729f * lr + 0.7151522f * lg + 0.0721750f * lb;
+    float z = 0.0193339f * lr + 0.1191920f * lg + 0.9503041f * lb;
+
+    float fx = lab_f(x / LAB_XN);
+    float fy = lab_f(y / LAB_YN);
+    float fz = lab_f(z / LAB_ZN);
+
+    lab[0] = 116.0f * fy - 16.0f;
+    lab[1] = 500.0f * (fx - fy);
+    lab[2] = 200.0f * (fy - fz);
+}
+
+/**
+ * Convert packed RGB colors (0-255 floats, e.g. extract_color_palette output) to CIELAB
+ * rgb and lab_out are count * 3 floats; returns number of colors converted
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int convert_rgb_to_lab(float* rgb, int count, float* lab_out) {
+    if (!rgb || !lab_out || count < 1) return 0;
+
+    init_srgb_linear_lut();
+    for (int i = 0; i < count; i++) {
+        rgb_to_lab(rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2], lab_out + i * 3);
+    }
+    return count;
+}
+
 // ============================================================================
 // COLOR DISTANCE
 // ============================================================================
 
+// Color difference formulas for the batched kernels
+static const int DELTA_E_76 = 0;
+static const int DELTA_E_2000 = 1;
+
+static inline float delta_e76(const float* lab1, const float* lab2) {
+    float dl = lab1[0] - lab2[0];
+    float da = lab1[1] - lab2[1];
+    float db = lab1[2] - lab2[2];
+    return sqrtf(dl * dl + da * da + db * db);
+}
+
+/**
+ * CIEDE2000 color difference (kL = kC = kH = 1)
+ */
+static inline float delta_e2000(const float* lab1, const float* lab2) {
+    const float PI = 3.14159265358979323846f;
+    const float DEG = PI / 180.0f;
+    const float POW25_7 = 6103515625.0f; // 25^7
+
+    float l1 = lab1[0], a1 = lab1[1], b1 = lab1[2];
+    float l2 = lab2[0], a2 = lab2[1], b2 = lab2[2];
+
+    float c1 = sqrtf(a1 * a1 + b1 * b1);
+    float c2 = sqrtf(a2 * a2 + b2 * b2);
+    float c_bar = 0.5f * (c1 + c2);
+    float c_bar7 = powf(c_bar, 7.0f);
+    float g = 0.5f * (1.0f - sqrtf(c_bar7 / (c_bar7 + POW25_7)));
+
+    float a1p = (1.0f + g) * a1;
+    float a2p = (1.0f + g) * a2;
+    float c1p = sqrtf(a1p * a1p + b1 * b1);
+    float c2p = sqrtf(a2p * a2p + b2 * b2);
+
+    float h1p = (a1p == 0.0f && b1 == 0.0f) ? 0.0f : atan2f(b1, a1p);
+    float h2p = (a2p == 0.0f && b2 == 0.0f) ? 0.0f : atan2f(b2, a2p);
+    if (h1p < 0.0f) h1p += 2.0f * PI;
+    if (h2p < 0.0f) h2p += 2.0f * PI;
+
+    float dlp = l2 - l1;
+    float dcp = c2p - c1p;
+
+    float dhp = 0.0f;
+    if (c1p * c2p != 0.0f) {
+        dhp = h2p - h1p;
+        if (dhp > PI) dhp -= 2.0f * PI;
+        else if (dhp < -PI) dhp += 2.0f * PI;
+    }
+    float dHp = 2.0f * sqrtf(c1p * c2p) * sinf(0.5f * dhp);
+
+    float l_bar = 0.5f * (l1 + l2);
+    float cp_bar = 0.5f * (c1p + c2p);
+
+    float hp_bar = h1p + h2p;
+    if (c1p * c2p != 0.0f) {
+        if (fabsf(h1p - h2p) > PI) {
+            hp_bar += (hp_bar < 2.0f * PI) ? 2.0f * PI : -2.0f * PI;
+        }
+        hp_bar *= 0.5f;
+    }
+
+    float t = 1.0f - 0.17f * cosf(hp_bar - 30.0f * DEG) + 0.24f * cosf(2.0f * hp_bar) +
+              0.32f * cosf(3.0f * hp_bar + 6.0f * DEG) - 0.20f * cosf(4.0f * hp_bar - 63.0f * DEG);
+
+    float dtheta = 30.0f * DEG * expf(-powf((hp_bar / DEG - 275.0f) / 25.0f, 2.0f));
+    float cp_bar7 = powf(cp_bar, 7.0f);
+    float rc = 2.0f * sqrtf(cp_bar7 / (cp_bar7 + POW25_7));
+
+    float l_off = (l_bar - 50.0f) * (l_bar - 50.0f);
+    float sl = 1.0f + 0.015f * l_off / sqrtf(20.0f + l_off);
+    float sc = 1.0f + 0.045f * cp_bar;
+    float sh = 1.0f + 0.015f * cp_bar * t;
+    float rt = -sinf(2.0f * dtheta) * rc;
+
+    float tl = dlp / sl;
+    float tc = dcp / sc;
+    float th = dHp / sh;
+
+    return sqrtf(tl * tl + tc * tc + th * th + rt * tc * th);
+}
+
+static inline float delta_e(const float* lab1, const float* lab2, int formula) {
+    return (formula == DELTA_E_2000) ? delta_e2000(lab1, lab2) : delta_e76(lab1, lab2);
+}
+
 /**
  * Calculate color distance (CIE76)
+ * Inputs are sRGB values (0-255); distance is measured in CIELAB
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
 float calculate_color_distance(float r1, float g1, float b1, float r2, float g2, float b2) {
-    // Simple Euclidean distance in RGB (CIE76 approximation)
-    float dr = r1 - r2;
-    float dg = g1 - g2;
-    float db = b1 - b2;
-    
-    return sqrtf(dr * dr + dg * dg + db * db);
+    init_srgb_linear_lut();
+
+    float lab1[3], lab2[3];
+    rgb_to_lab(r1, g1, b1, lab1);
+    rgb_to_lab(r2, g2, b2, lab2);
+
+    return delta_e76(lab1, lab2);
+}
+
+/**
+ * Element-wise color difference over two arrays of CIELAB colors
+ * lab1, lab2: count * 3 floats; output: count floats
+ * formula: 0 = CIE76, 1 = CIEDE2000; returns number of distances written
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int calculate_delta_e_batch(float* lab1, float* lab2, int count, int formula, float* output) {
+    if (!lab1 || !lab2 || !output || count < 1) return 0;
+
+    if (formula == DELTA_E_2000) {
+        for (int i = 0; i < count; i++) {
+            output[i] = delta_e2000(lab1 + i * 3, lab2 + i * 3);
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            output[i] = delta_e76(lab1 + i * 3, lab2 + i * 3);
+        }
+    }
+    return count;
+}
+
+/**
+ * Average nearest-neighbour distance from each color of palette A to palette B
+ * Optionally records the matched index in B for every color of A
+ */
+static float palette_directed_distance(const float* lab_a, int count_a, const float* lab_b, int count_b,
+                                       int formula, int* matches) {
+    float total = 0.0f;
+
+    for (int i = 0; i < count_a; i++) {
+        float best = 1e10f;
+        int best_j = 0;
+
+        for (int j = 0; j < count_b; j++) {
+            float d = delta_e(lab_a + i * 3, lab_b + j * 3, formula);
+            if (d < best) {
+                best = d;
+                best_j = j;
+            }
+        }
+
+        if (matches) matches[i] = best_j;
+        total += best;
+    }
+
+    return total / count_a;
+}
+
+/**
+ * Match two CIELAB palettes
+ * Returns symmetric mean nearest-color distance (lower = more similar), -1 on invalid input
+ * matches (optional): count_a entries, index of the closest color in palette B
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float match_color_palettes(float* lab_a, int count_a, float* lab_b, int count_b, int formula, int* matches) {
+    if (!lab_a || !lab_b || count_a < 1 || count_b < 1) return -1.0f;
+
+    float ab = palette_directed_distance(lab_a, count_a, lab_b, count_b, formula, matches);
+    float ba = palette_directed_distance(lab_b, count_b, lab_a, count_a, formula, nullptr);
+
+    return 0.5f * (ab + ba);
+}
+
+/**
+ * Score a query palette against a catalog of palettes in one call
+ * catalog_lab: catalog_count palettes of colors_per_palette CIELAB colors
+ * output: catalog_count palette distances (see match_color_palettes)
+ * Returns number of palettes scored
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int match_palette_against_catalog(float* query_lab, int query_colors,
+                                  float* catalog_lab, int catalog_count, int colors_per_palette,
+                                  int formula, float* output) {
+    if (!query_lab || !catalog_lab || !output || query_colors < 1 ||
+        catalog_count < 1 || colors_per_palette < 1) return 0;
+
+    for (int p = 0; p < catalog_count; p++) {
+        output[p] = match_color_palettes(query_lab, query_colors,
+                                         catalog_lab + (size_t)p * colors_per_palette * 3,
+                                         colors_per_palette, formula, nullptr);
+    }
+    return catalog_count;
 }
 
 /**
@@ -440,6 +850,191 @@ float compare_color_histograms(float* hist1, float* hist2, int size) {
     return intersection;
 }
 
+// ============================================================================
+// BATCHED HISTOGRAM SIMILARITY
+// ============================================================================
+
+// Similarity metrics for the batched kernels
+// 0: histogram intersection  sum(min(a, b))            (same as compare_color_histograms)
+// 1: chi-square              1 / (1 + sum((a-b)^2 / (a+b)))
+// 2: Bhattacharyya           sum(sqrt(a * b))
+static const int HIST_METRIC_INTERSECTION = 0;
+static const int HIST_METRIC_CHI_SQUARE = 1;
+static const int HIST_METRIC_BHATTACHARYYA = 2;
+
+// Histograms per cache tile (a tile of 32 x 48-float histograms is ~6 KB)
+static const int HIST_BLOCK = 32;
+
+// Independent accumulators so the reductions map onto SIMD lanes
+static const int HIST_LANES = 8;
+
+static inline float hist_intersection(const float* a, const float* b, int size) {
+    float acc[HIST_LANES] = {0};
+    int i = 0;
+    for (; i + HIST_LANES <= size; i += HIST_LANES) {
+        for (int l = 0; l < HIST_LANES; l++) {
+            acc[l] += fminf(a[i + l], b[i + l]);
+        }
+    }
+    float sum = 0.0f;
+    for (int l = 0; l < HIST_LANES; l++) sum += acc[l];
+    for (; i < size; i++) sum += fminf(a[i], b[i]);
+    return sum;
+}
+
+static inline float hist_chi_square(const float* a, const float* b, int size) {
+    float acc[HIST_LANES] = {0};
+    int i = 0;
+    for (; i + HIST_LANES <= size; i += HIST_LANES) {
+        for (int l = 0; l < HIST_LANES; l++) {
+            float d = a[i + l] - b[i + l];
+            float s = a[i + l] + b[i + l];
+            acc[l] += (s > 0.0f) ? d * d / s : 0.0f;
+        }
+    }
+    float sum = 0.0f;
+    for (int l = 0; l < HIST_LANES; l++) sum += acc[l];
+    for (; i < size; i++) {
+        float d = a[i] - b[i];
+        float s = a[i] + b[i];
+        if (s > 0.0f) sum += d * d / s;
+    }
+    return 1.0f / (1.0f + sum);
+}
+
+// Expects square-rooted histograms, so Bhattacharyya reduces to a dot product
+static inline float hist_dot(const float* a, const float* b, int size) {
+    float acc[HIST_LANES] = {0};
+    int i = 0;
+    for (; i + HIST_LANES <= size; i += HIST_LANES) {
+        for (int l = 0; l < HIST_LANES; l++) {
+            acc[l] += a[i + l] * b[i + l];
+        }
+    }
+    float sum = 0.0f;
+    for (int l = 0; l < HIST_LANES; l++) sum += acc[l];
+    for (; i < size; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static inline float hist_similarity(const float* a, const float* b, int size, int metric) {
+    if (metric == HIST_METRIC_CHI_SQUARE) return hist_chi_square(a, b, size);
+    if (metric == HIST_METRIC_BHATTACHARYYA) return hist_dot(a, b, size);
+    return hist_intersection(a, b, size);
+}
+
+/**
+ * Prepare histogram matrix for the selected metric
+ * Bhattacharyya works on a square-rooted copy; returns nullptr on failure.
+ * Caller frees the result only when it differs from the input.
+ */
+static const float* prepare_histogram_matrix(const float* histograms, int count, int size, int metric) {
+    if (metric != HIST_METRIC_BHATTACHARYYA) return histograms;
+
+    float* roots = (float*)malloc((size_t)count * size * sizeof(float));
+    if (!roots) return nullptr;
+
+    for (int i = 0; i < count * size; i++) {
+        roots[i] = sqrtf(fmaxf(histograms[i], 0.0f));
+    }
+    return roots;
+}
+
+/**
+ * Compute N x N similarity matrix over contiguous histograms
+ * histograms: count rows of `size` floats; output: count * count floats (row-major)
+ * Only the upper triangle is evaluated, tile by tile, then mirrored.
+ * Returns 1 on success, 0 on invalid input or allocation failure
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int compute_histogram_similarity_matrix(float* histograms, int count, int size, int metric, float* output) {
+    if (!histograms || !output || count < 1 || size < 1) return 0;
+    if (metric < HIST_METRIC_INTERSECTION || metric > HIST_METRIC_BHATTACHARYYA) return 0;
+
+    const float* data = prepare_histogram_matrix(histograms, count, size, metric);
+    if (!data) return 0;
+
+    for (int bi = 0; bi < count; bi += HIST_BLOCK) {
+        int i_end = (bi + HIST_BLOCK < count) ? bi + HIST_BLOCK : count;
+
+        for (int bj = bi; bj < count; bj += HIST_BLOCK) {
+            int j_end = (bj + HIST_BLOCK < count) ? bj + HIST_BLOCK : count;
+
+            for (int i = bi; i < i_end; i++) {
+                const float* hi = data + (size_t)i * size;
+                int j_start = (bj > i) ? bj : i;
+
+                for (int j = j_start; j < j_end; j++) {
+                    float sim = hist_similarity(hi, data + (size_t)j * size, size, metric);
+                    output[(size_t)i * count + j] = sim;
+                    output[(size_t)j * count + i] = sim;
+                }
+            }
+        }
+    }
+
+    if (data != histograms) free((void*)data);
+    return 1;
+}
+
+/**
+ * Insert a candidate into a row's top-k list (kept sorted, best first)
+ */
+static inline void insert_top_k(int* indices, float* scores, int k, int candidate, float score) {
+    if (score <= scores[k - 1]) return;
+
+    int pos = k - 1;
+    while (pos > 0 && scores[pos - 1] < score) {
+        scores[pos] = scores[pos - 1];
+        indices[pos] = indices[pos - 1];
+        pos--;
+    }
+    scores[pos] = score;
+    indices[pos] = candidate;
+}
+
+/**
+ * Find the k most similar histograms for every row (self excluded)
+ * out_indices / out_scores: count * k entries, best first; unused slots are -1 / -inf
+ * Returns number of neighbours written per row (min(k, count - 1))
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int compute_histogram_top_k(float* histograms, int count, int size, int metric, int k,
+                            int* out_indices, float* out_scores) {
+    if (!histograms || !out_indices || !out_scores || count < 1 || size < 1 || k < 1) return 0;
+    if (metric < HIST_METRIC_INTERSECTION || metric > HIST_METRIC_BHATTACHARYYA) return 0;
+
+    for (int i = 0; i < count * k; i++) {
+        out_indices[i] = -1;
+        out_scores[i] = -INFINITY;
+    }
+
+    const float* data = prepare_histogram_matrix(histograms, count, size, metric);
+    if (!data) return 0;
+
+    for (int bi = 0; bi < count; bi += HIST_BLOCK) {
+        int i_end = (bi + HIST_BLOCK < count) ? bi + HIST_BLOCK : count;
+
+        for (int bj = bi; bj < count; bj += HIST_BLOCK) {
+            int j_end = (bj + HIST_BLOCK < count) ? bj + HIST_BLOCK : count;
+
+            for (int i = bi; i < i_end; i++) {
+                const float* hi = data + (size_t)i * size;
+                int j_start = (bj > i + 1) ? bj : i + 1;
+
+                for (int j = j_start; j < j_end; j++) {
+                    float sim = hist_similarity(hi, data + (size_t)j * size, size, metric);
+                    insert_top_k(out_indices + (size_t)i * k, out_scores + (size_t)i * k, k, j, sim);
+                    insert_top_k(out_indices + (size_t)j * k, out_scores + (size_t)j * k, k, i, sim);
+                }
+            }
+        }
+    }
+
+    if (data != histograms) free((void*)data);
+    return (k < count - 1) ? k : count - 1;
+}
+
 // Memory management
 extern "C" EMSCRIPTEN_KEEPALIVE
 void* wasm_malloc(int size) { return malloc(size); }
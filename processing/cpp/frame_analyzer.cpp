@@ -9,30 +9,127 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "histogram_engine.h"
+#include "frame_region.h"
+
+static inline float pixel_luma(const uint8_t* p) {
+    return 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+}
+
 // ============================================================================
-// SCENE CHANGE DETECTION
+// ACTIVE AREA (LETTERBOX / PILLARBOX) DETECTION
 // ============================================================================
 
+// A row/column is a border line when its mean luma and variance are both low
+static const float BORDER_MAX_VARIANCE = 16.0f;
+
+/**
+ * Detect the content rectangle of letterboxed / pillarboxed video
+ * Samples up to max_samples frames evenly, scans per-row and per-column luma
+ * mean/variance, and keeps every line that carries content in any sample.
+ * out_rect receives [x, y, w, h] (always written; full frame if nothing found)
+ * Returns 1 if borders were found, 0 otherwise
+ */
 extern "C" EMSCRIPTEN_KEEPALIVE
-float calculate_scene_change_score(uint8_t* prev_frame, uint8_t* curr_frame, int width, int height) {
-    if (!prev_frame || !curr_frame || width <= 0 || height <= 0) return 0.0f;
+int detect_active_area(uint8_t* frames_data, int frame_count, int width, int height,
+                       int max_samples, float luma_threshold, int* out_rect) {
+    if (!out_rect) return 0;
+    out_rect[0] = 0; out_rect[1] = 0; out_rect[2] = width; out_rect[3] = height;
+    if (!frames_data || frame_count < 1 || width <= 0 || height <= 0) return 0;
+
+    if (max_samples < 1) max_samples = 1;
+    int samples = (frame_count < max_samples) ? frame_count : max_samples;
+    int frame_size = width * height * 3;
+
+    uint32_t* col_sum = (uint32_t*)malloc(width * sizeof(uint32_t));
+    uint32_t* col_sum_sq = (uint32_t*)malloc(width * sizeof(uint32_t));
+    uint8_t* row_active = (uint8_t*)calloc(height, 1);
+    uint8_t* col_active = (uint8_t*)calloc(width, 1);
+
+    if (!col_sum || !col_sum_sq || !row_active || !col_active) {
+        free(col_sum); free(col_sum_sq); free(row_active); free(col_active);
+        return 0;
+    }
+
+    for (int s = 0; s < samples; s++) {
+        // Spread samples over the whole sequence (skip the very first frame when possible)
+        int index = (int)((s + 0.5f) * frame_count / samples);
+        uint8_t* frame = frames_data + (size_t)index * frame_size;
+
+        memset(col_sum, 0, width * sizeof(uint32_t));
+        memset(col_sum_sq, 0, width * sizeof(uint32_t));
+
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = frame + y * width * 3;
+            uint32_t row_sum = 0, row_sum_sq = 0;
+
+            for (int x = 0; x < width; x++) {
+                const uint8_t* p = row + x * 3;
+                uint32_t lum = (77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8;
+                row_sum += lum;
+                row_sum_sq += lum * lum;
+                col_sum[x] += lum;
+                col_sum_sq[x] += lum * lum;
+            }
+
+            float mean = (float)row_sum / width;
+            float variance = (float)row_sum_sq / width - mean * mean;
+            if (mean >= luma_threshold || variance >= BORDER_MAX_VARIANCE) row_active[y] = 1;
+        }
+
+        for (int x = 0; x < width; x++) {
+            float mean = (float)col_sum[x] / height;
+            float variance = (float)col_sum_sq[x] / height - mean * mean;
+            if (mean >= luma_threshold || variance >= BORDER_MAX_VARIANCE) col_active[x] = 1;
+        }
+    }
+
+    int top = 0, bottom = height - 1, left = 0, right = width - 1;
+    while (top < height && !row_active[top]) top++;
+    while (bottom > top && !row_active[bottom]) bottom--;
+    while (left < width && !col_active[left]) left++;
+    while (right > left && !col_active[right]) right--;
     
+    free(col_sum); free(col_sum_sq); free(row_active); free(col_active);
+
+    // Entirely dark samples: nothing reliable to crop to
+    if (top >= height || left >= width) return 0;
+
+    // Keep the rectangle even-aligned for chroma-subsampled sources
+    top &= ~1;
+    left &= ~1;
+    int w = ((right - left + 2) & ~1);
+    int h = ((bottom - top + 2) & ~1);
+    if (left + w > width) w = width - left;
+    if (top + h > height) h = height - top;
+
+    // Ignore implausible crops (less than a quarter of the frame left)
+    if (w * h * 4 < width * height) return 0;
+
+    out_rect[0] = left; out_rect[1] = top; out_rect[2] = w; out_rect[3] = h;
+    return (w < width || h < height) ? 1 : 0;
+}
+
+// ============================================================================
+// SCENE CHANGE DETECTION
+// ============================================================================
+
+static float scene_change_score_region(const FrameRegion& prev, const FrameRegion& curr) {
     const int HISTOGRAM_BINS = 64;
-    int prev_hist[HISTOGRAM_BINS] = {0};
-    int curr_hist[HISTOGRAM_BINS] = {0};
-    
-    int total_pixels = width * height;
-    int bin_size = 256 / HISTOGRAM_BINS;
+    int total_pixels = prev.pixel_count();
     
     // Build luminance histograms
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        int prev_lum = (int)(0.299f * prev_frame[idx] + 0.587f * prev_frame[idx+1] + 0.114f * prev_frame[idx+2]);
-        int curr_lum = (int)(0.299f * curr_frame[idx] + 0.587f * curr_frame[idx+1] + 0.114f * curr_frame[idx+2]);
-        prev_hist[prev_lum / bin_size]++;
-        curr_hist[curr_lum / bin_size]++;
+    HistogramEngine<HISTOGRAM_BINS, LumaLayout> prev_engine, curr_engine;
+    for (int y = 0; y < prev.height; y++) {
+        prev_engine.accumulate(prev.row(y), prev.width);
+        curr_engine.accumulate(curr.row(y), curr.width);
     }
     
+    uint32_t prev_hist[HISTOGRAM_BINS];
+    uint32_t curr_hist[HISTOGRAM_BINS];
+    prev_engine.merge(prev_hist);
+    curr_engine.merge(curr_hist);
+    
     // Bhattacharyya distance
     float bc = 0.0f;
     for (int i = 0; i < HISTOGRAM_BINS; i++) {
@@ -44,122 +141,201 @@ float calculate_scene_change_score(uint8_t* prev_frame, uint8_t* curr_frame, int
 }
 
 extern "C" EMSCRIPTEN_KEEPALIVE
-int detect_scene_changes(uint8_t* frames_data, int frame_count, int width, int height, 
-                         float threshold, int* output_indices) {
-    if (!frames_data || frame_count < 2 || !output_indices) return 0;
+float calculate_scene_change_score(uint8_t* prev_frame, uint8_t* curr_frame, int width, int height) {
+    if (!prev_frame || !curr_frame || width <= 0 || height <= 0) return 0.0f;
+    
+    return scene_change_score_region(full_frame_region(prev_frame, width, height),
+                                     full_frame_region(curr_frame, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_scene_change_score_roi(uint8_t* prev_frame, uint8_t* curr_frame, int width, int height,
+                                       int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!prev_frame || !curr_frame || width <= 0 || height <= 0) return 0.0f;
+
+    FrameRegion prev = make_frame_region(prev_frame, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+    FrameRegion curr = make_frame_region(curr_frame, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+    if (prev.pixel_count() <= 0) return 0.0f;
+
+    return scene_change_score_region(prev, curr);
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int detect_scene_changes_roi(uint8_t* frames_data, int frame_count, int width, int height,
+                             float threshold, int* output_indices,
+                             int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frames_data || frame_count < 2 || !output_indices || width <= 0 || height <= 0) return 0;
     
-    int frame_size = width * height * 3;
     int count = 0;
     
     for (int i = 1; i < frame_count; i++) {
-        uint8_t* prev = frames_data + (i - 1) * frame_size;
-        uint8_t* curr = frames_data + i * frame_size;
+        FrameRegion prev = sequence_frame_region(frames_data, i - 1, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+        FrameRegion curr = sequence_frame_region(frames_data, i, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+        if (prev.pixel_count() <= 0) return 0;
         
-        if (calculate_scene_change_score(prev, curr, width, height) > threshold) {
+        if (scene_change_score_region(prev, curr) > threshold) {
             output_indices[count++] = i;
         }
     }
     return count;
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE
+int detect_scene_changes(uint8_t* frames_data, int frame_count, int width, int height,
+                         float threshold, int* output_indices) {
+    return detect_scene_changes_roi(frames_data, frame_count, width, height, threshold, output_indices,
+                                    0, 0, 0, 0, 0);
+}
+
 // ============================================================================
 // BLACK FRAME DETECTION
 // ============================================================================
 
+static int black_frame_region(const FrameRegion& region, float threshold) {
+    int total_pixels = region.pixel_count();
+    int dark_pixels = 0;
+
+    for (int y = 0; y < region.height; y++) {
+        const uint8_t* row = region.row(y);
+        for (int x = 0; x < region.width; x++) {
+            if (pixel_luma(row + x * 3) < threshold) dark_pixels++;
+        }
+    }
+
+    return (dark_pixels > total_pixels * 0.95f) ? 1 : 0;
+}
+
+static float brightness_region(const FrameRegion& region) {
+    float total_lum = 0.0f;
+
+    for (int y = 0; y < region.height; y++) {
+        const uint8_t* row = region.row(y);
+        for (int x = 0; x < region.width; x++) {
+            total_lum += pixel_luma(row + x * 3);
+        }
+    }
+    return total_lum / region.pixel_count();
+}
+
 extern "C" EMSCRIPTEN_KEEPALIVE
 int detect_black_frames(uint8_t* frame_data, int width, int height, float threshold) {
     if (!frame_data || width <= 0 || height <= 0) return 0;
     
-    int total_pixels = width * height;
-    int dark_pixels = 0;
+    return black_frame_region(full_frame_region(frame_data, width, height), threshold);
+}
     
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        float lum = 0.299f * frame_data[idx] + 0.587f * frame_data[idx+1] + 0.114f * frame_data[idx+2];
-        if (lum < threshold) dark_pixels++;
-    }
+extern "C" EMSCRIPTEN_KEEPALIVE
+int detect_black_frames_roi(uint8_t* frame_data, int width, int height, float threshold,
+                            int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return 0;
     
-    return (dark_pixels > total_pixels * 0.95f) ? 1 : 0;
+    FrameRegion region = make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+    if (region.pixel_count() <= 0) return 0;
+
+    return black_frame_region(region, threshold);
 }
 
 extern "C" EMSCRIPTEN_KEEPALIVE
 float calculate_frame_brightness(uint8_t* frame_data, int width, int height) {
     if (!frame_data || width <= 0 || height <= 0) return 0.0f;
     
-    int total_pixels = width * height;
-    float total_lum = 0.0f;
+    return brightness_region(full_frame_region(frame_data, width, height));
+}
     
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        total_lum += 0.299f * frame_data[idx] + 0.587f * frame_data[idx+1] + 0.114f * frame_data[idx+2];
-    }
-    return total_lum / total_pixels;
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_frame_brightness_roi(uint8_t* frame_data, int width, int height,
+                                     int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    FrameRegion region = make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+    if (region.pixel_count() <= 0) return 0.0f;
+
+    return brightness_region(region);
 }
 
 // ============================================================================
 // MOTION INTENSITY
 // ============================================================================
 
+static float motion_intensity_region(const FrameRegion& prev, const FrameRegion& curr) {
+    float total_diff = 0.0f;
+
+    for (int y = 0; y < prev.height; y++) {
+        const uint8_t* prev_row = prev.row(y);
+        const uint8_t* curr_row = curr.row(y);
+
+        for (int x = 0; x < prev.width; x++) {
+            int idx = x * 3;
+            int diff = abs((int)curr_row[idx] - (int)prev_row[idx]) +
+                       abs((int)curr_row[idx+1] - (int)prev_row[idx+1]) +
+                       abs((int)curr_row[idx+2] - (int)prev_row[idx+2]);
+            total_diff += diff / 3.0f;
+        }
+    }
+    return (total_diff / prev.pixel_count()) / 255.0f;
+}
+
 extern "C" EMSCRIPTEN_KEEPALIVE
 float calculate_motion_intensity(uint8_t* prev_frame, uint8_t* curr_frame, int width, int height) {
     if (!prev_frame || !curr_frame || width <= 0 || height <= 0) return 0.0f;
     
-    int total_pixels = width * height;
-    float total_diff = 0.0f;
+    return motion_intensity_region(full_frame_region(prev_frame, width, height),
+                                   full_frame_region(curr_frame, width, height));
+}
     
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        int diff = abs((int)curr_frame[idx] - (int)prev_frame[idx]) +
-                   abs((int)curr_frame[idx+1] - (int)prev_frame[idx+1]) +
-                   abs((int)curr_frame[idx+2] - (int)prev_frame[idx+2]);
-        total_diff += diff / 3.0f;
-    }
-    return (total_diff / total_pixels) / 255.0f;
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_motion_intensity_roi(uint8_t* prev_frame, uint8_t* curr_frame, int width, int height,
+                                     int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!prev_frame || !curr_frame || width <= 0 || height <= 0) return 0.0f;
+
+    FrameRegion prev = make_frame_region(prev_frame, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+    FrameRegion curr = make_frame_region(curr_frame, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+    if (prev.pixel_count() <= 0) return 0.0f;
+
+    return motion_intensity_region(prev, curr);
 }
 
 extern "C" EMSCRIPTEN_KEEPALIVE
-float calculate_average_motion(uint8_t* frames_data, int frame_count, int width, int height) {
-    if (!frames_data || frame_count < 2) return 0.0f;
+float calculate_average_motion_roi(uint8_t* frames_data, int frame_count, int width, int height,
+                                   int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frames_data || frame_count < 2 || width <= 0 || height <= 0) return 0.0f;
     
-    int frame_size = width * height * 3;
     float total = 0.0f;
     
     for (int i = 1; i < frame_count; i++) {
-        total += calculate_motion_intensity(
-            frames_data + (i-1) * frame_size,
-            frames_data + i * frame_size,
-            width, height
-        );
+        FrameRegion prev = sequence_frame_region(frames_data, i - 1, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+        FrameRegion curr = sequence_frame_region(frames_data, i, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+        if (prev.pixel_count() <= 0) return 0.0f;
+
+        total += motion_intensity_region(prev, curr);
     }
     return total / (frame_count - 1);
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_average_motion(uint8_t* frames_data, int frame_count, int width, int height) {
+    return calculate_average_motion_roi(frames_data, frame_count, width, height, 0, 0, 0, 0, 0);
+}
+
 // ============================================================================
 // FRAME QUALITY ASSESSMENT
 // ============================================================================
 
-extern "C" EMSCRIPTEN_KEEPALIVE
-float calculate_sharpness(uint8_t* frame_data, int width, int height) {
-    if (!frame_data || width < 3 || height < 3) return 0.0f;
+static float sharpness_region(const FrameRegion& region) {
+    if (region.width < 3 || region.height < 3) return 0.0f;
     
     float sum = 0.0f, sum_sq = 0.0f;
     int count = 0;
     
-    for (int y = 1; y < height - 1; y++) {
-        for (int x = 1; x < width - 1; x++) {
-            int idx = (y * width + x) * 3;
-            float center = 0.299f * frame_data[idx] + 0.587f * frame_data[idx+1] + 0.114f * frame_data[idx+2];
-            
-            int idx_up = ((y-1) * width + x) * 3;
-            int idx_down = ((y+1) * width + x) * 3;
-            int idx_left = (y * width + (x-1)) * 3;
-            int idx_right = (y * width + (x+1)) * 3;
+    for (int y = 1; y < region.height - 1; y++) {
+        for (int x = 1; x < region.width - 1; x++) {
+            float center = pixel_luma(region.pixel(x, y));
             
             float lap = -4.0f * center +
-                (0.299f * frame_data[idx_up] + 0.587f * frame_data[idx_up+1] + 0.114f * frame_data[idx_up+2]) +
-                (0.299f * frame_data[idx_down] + 0.587f * frame_data[idx_down+1] + 0.114f * frame_data[idx_down+2]) +
-                (0.299f * frame_data[idx_left] + 0.587f * frame_data[idx_left+1] + 0.114f * frame_data[idx_left+2]) +
-                (0.299f * frame_data[idx_right] + 0.587f * frame_data[idx_right+1] + 0.114f * frame_data[idx_right+2]);
+                pixel_luma(region.pixel(x, y - 1)) +
+                pixel_luma(region.pixel(x, y + 1)) +
+                pixel_luma(region.pixel(x - 1, y)) +
+                pixel_luma(region.pixel(x + 1, y));
             
             sum += lap;
             sum_sq += lap * lap;
@@ -171,28 +347,25 @@ float calculate_sharpness(uint8_t* frame_data, int width, int height) {
     return (sum_sq / count) - (mean * mean);
 }
 
-extern "C" EMSCRIPTEN_KEEPALIVE
-float calculate_contrast(uint8_t* frame_data, int width, int height) {
-    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
-    
+static float contrast_region(const FrameRegion& region) {
     float min_lum = 255.0f, max_lum = 0.0f;
-    int total_pixels = width * height;
     
-    for (int i = 0; i < total_pixels; i++) {
-        int idx = i * 3;
-        float lum = 0.299f * frame_data[idx] + 0.587f * frame_data[idx+1] + 0.114f * frame_data[idx+2];
-        if (lum < min_lum) min_lum = lum;
-        if (lum > max_lum) max_lum = lum;
+    for (int y = 0; y < region.height; y++) {
+        const uint8_t* row = region.row(y);
+        for (int x = 0; x < region.width; x++) {
+            float lum = pixel_luma(row + x * 3);
+            if (lum < min_lum) min_lum = lum;
+            if (lum > max_lum) max_lum = lum;
+        }
     }
     
     return (max_lum + min_lum > 0) ? (max_lum - min_lum) / (max_lum + min_lum) : 0.0f;
 }
 
-extern "C" EMSCRIPTEN_KEEPALIVE
-float calculate_frame_quality(uint8_t* frame_data, int width, int height) {
-    float brightness = calculate_frame_brightness(frame_data, width, height);
-    float contrast = calculate_contrast(frame_data, width, height);
-    float sharpness = calculate_sharpness(frame_data, width, height);
+static float frame_quality_region(const FrameRegion& region) {
+    float brightness = brightness_region(region);
+    float contrast = contrast_region(region);
+    float sharpness = sharpness_region(region);
     
     float norm_sharpness = fminf(sharpness / 5000.0f, 1.0f);
     float brightness_score = 1.0f - fabsf(brightness - 127.5f) / 127.5f;
@@ -200,23 +373,72 @@ float calculate_frame_quality(uint8_t* frame_data, int width, int height) {
     return fmaxf(0.0f, fminf(100.0f, (0.4f * norm_sharpness + 0.3f * contrast + 0.3f * brightness_score) * 100.0f));
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_sharpness(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width < 3 || height < 3) return 0.0f;
+
+    return sharpness_region(full_frame_region(frame_data, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_sharpness_roi(uint8_t* frame_data, int width, int height,
+                              int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width < 3 || height < 3) return 0.0f;
+
+    return sharpness_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_contrast(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    return contrast_region(full_frame_region(frame_data, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_contrast_roi(uint8_t* frame_data, int width, int height,
+                             int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    return contrast_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_frame_quality(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    return frame_quality_region(full_frame_region(frame_data, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_frame_quality_roi(uint8_t* frame_data, int width, int height,
+                                  int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width <= 0 || height <= 0) return 0.0f;
+
+    FrameRegion region = make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+    if (region.pixel_count() <= 0) return 0.0f;
+
+    return frame_quality_region(region);
+}
+
 // ============================================================================
 // KEYFRAME SELECTION
 // ============================================================================
 
 extern "C" EMSCRIPTEN_KEEPALIVE
-int select_best_keyframe(uint8_t* frames_data, int frame_count, int width, int height) {
-    if (!frames_data || frame_count < 1) return 0;
+int select_best_keyframe_roi(uint8_t* frames_data, int frame_count, int width, int height,
+                             int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frames_data || frame_count < 1 || width <= 0 || height <= 0) return 0;
     
-    int frame_size = width * height * 3;
     float best_score = -1.0f;
     int best_idx = 0;
     
     for (int i = 0; i < frame_count; i++) {
-        uint8_t* frame = frames_data + i * frame_size;
-        if (detect_black_frames(frame, width, height, 20)) continue;
+        FrameRegion frame = sequence_frame_region(frames_data, i, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+        if (frame.pixel_count() <= 0) return 0;
+        if (black_frame_region(frame, 20)) continue;
         
-        float quality = calculate_frame_quality(frame, width, height);
+        float quality = frame_quality_region(frame);
         if (quality > best_score) {
             best_score = quality;
             best_idx = i;
@@ -226,11 +448,16 @@ int select_best_keyframe(uint8_t* frames_data, int frame_count, int width, int h
 }
 
 extern "C" EMSCRIPTEN_KEEPALIVE
-int select_representative_keyframes(uint8_t* frames_data, int frame_count, int width, int height,
-                                    int num_keyframes, int* output_indices) {
-    if (!frames_data || frame_count < 1 || !output_indices) return 0;
+int select_best_keyframe(uint8_t* frames_data, int frame_count, int width, int height) {
+    return select_best_keyframe_roi(frames_data, frame_count, width, height, 0, 0, 0, 0, 0);
+}
+    
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_representative_keyframes_roi(uint8_t* frames_data, int frame_count, int width, int height,
+                                        int num_keyframes, int* output_indices,
+                                        int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frames_data || frame_count < 1 || !output_indices || num_keyframes < 1) return 0;
     
-    int frame_size = width * height * 3;
     int segment_size = frame_count / num_keyframes;
     int selected = 0;
     
@@ -242,10 +469,11 @@ int select_representative_keyframes(uint8_t* frames_data, int frame_count, int w
         int best_idx = start;
         
         for (int i = start; i < end; i++) {
-            uint8_t* frame = frames_data + i * frame_size;
-            if (detect_black_frames(frame, width, height, 20)) continue;
+            FrameRegion frame = sequence_frame_region(frames_data, i, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+            if (frame.pixel_count() <= 0) return 0;
+            if (black_frame_region(frame, 20)) continue;
             
-            float quality = calculate_frame_quality(frame, width, height);
+            float quality = frame_quality_region(frame);
             if (quality > best_score) {
                 best_score = quality;
                 best_idx = i;
@@ -256,6 +484,13 @@ int select_representative_keyframes(uint8_t* frames_data, int frame_count, int w
     return selected;
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE
+int select_representative_keyframes(uint8_t* frames_data, int frame_count, int width, int height,
+                                    int num_keyframes, int* output_indices) {
+    return select_representative_keyframes_roi(frames_data, frame_count, width, height,
+                                               num_keyframes, output_indices, 0, 0, 0, 0, 0);
+}
+
 // Memory helpers
 extern "C" EMSCRIPTEN_KEEPALIVE
 void* wasm_malloc(int size) { return malloc(size); }
@@ -0,0 +1,64 @@
+/**
+ * Frame Region
+ * Rectangular view into a packed RGB24 frame, shared by the frame, color
+ * and hash analyzers so every kernel can run on a cropped active area
+ */
+
+#ifndef FRAME_REGION_H
+#define FRAME_REGION_H
+
+#include <cstdint>
+
+/**
+ * data points at the top-left pixel of the region; stride is the byte
+ * distance between consecutive rows of the underlying frame
+ */
+struct FrameRegion {
+    uint8_t* data;
+    int width;
+    int height;
+    int stride;
+
+    inline uint8_t* row(int y) const { return data + y * stride; }
+    inline uint8_t* pixel(int x, int y) const { return data + y * stride + x * 3; }
+    inline int pixel_count() const { return width * height; }
+};
+
+/**
+ * Whole frame as a region (tightly packed rows)
+ */
+static inline FrameRegion full_frame_region(uint8_t* frame_data, int width, int height) {
+    FrameRegion region = { frame_data, width, height, width * 3 };
+    return region;
+}
+
+/**
+ * Build a region from an optional ROI, clamped to the frame
+ * roi_w / roi_h <= 0 extend to the frame edge; stride <= 0 means width * 3
+ */
+static inline FrameRegion make_frame_region(uint8_t* frame_data, int width, int height,
+                                            int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (stride <= 0) stride = width * 3;
+    if (roi_x < 0) roi_x = 0;
+    if (roi_y < 0) roi_y = 0;
+    if (roi_x > width) roi_x = width;
+    if (roi_y > height) roi_y = height;
+    if (roi_w <= 0 || roi_x + roi_w > width) roi_w = width - roi_x;
+    if (roi_h <= 0 || roi_y + roi_h > height) roi_h = height - roi_y;
+
+    FrameRegion region = { frame_data ? frame_data + roi_y * stride + roi_x * 3 : nullptr,
+                           roi_w, roi_h, stride };
+    return region;
+}
+
+/**
+ * Same ROI applied to frame `index` of a contiguous sequence of frames
+ */
+static inline FrameRegion sequence_frame_region(uint8_t* frames_data, int index, int width, int height,
+                                                int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (stride <= 0) stride = width * 3;
+    return make_frame_region(frames_data + (size_t)index * stride * height, width, height,
+                             roi_x, roi_y, roi_w, roi_h, stride);
+}
+
+#endif // FRAME_REGION_H
@@ -0,0 +1,161 @@
+/**
+ * Histogram Engine
+ * Compile-time specialised 8-bit histogram accumulation shared by the
+ * color analyzer and frame analyzer modules
+ */
+
+#ifndef HISTOGRAM_ENGINE_H
+#define HISTOGRAM_ENGINE_H
+
+#include <cstring>
+#include <cstdint>
+
+// ============================================================================
+// CHANNEL LAYOUTS
+// ============================================================================
+
+/**
+ * Packed RGB24 pixels, one histogram per channel (R, G, B)
+ */
+struct RgbLayout {
+    static const int CHANNELS = 3;
+    static const int STRIDE = 3;
+
+    static inline void sample(const uint8_t* p, uint8_t* v) {
+        v[0] = p[0];
+        v[1] = p[1];
+        v[2] = p[2];
+    }
+};
+
+/**
+ * Packed RGB24 pixels reduced to a single BT.601 luminance histogram
+ * Fixed-point weights (77, 150, 29) / 256 match 0.299 / 0.587 / 0.114
+ */
+struct LumaLayout {
+    static const int CHANNELS = 1;
+    static const int STRIDE = 3;
+
+    static inline void sample(const uint8_t* p, uint8_t* v) {
+        v[0] = (uint8_t)((77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8);
+    }
+};
+
+// ============================================================================
+// BIN MAPPING
+// ============================================================================
+
+constexpr int histogram_log2(int n) {
+    return (n <= 1) ? 0 : 1 + histogram_log2(n / 2);
+}
+
+constexpr bool histogram_is_pow2(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+/**
+ * Map an 8-bit value onto BINS equal-width bins
+ * Power-of-two counts reduce to a shift; other counts use (v * BINS) >> 8,
+ * which spreads 0-255 over every bin without overflowing the last one
+ */
+template <int BINS>
+static inline int histogram_bin(uint8_t v) {
+    static_assert(BINS >= 1 && BINS <= 256, "histogram bins must be in [1, 256]");
+    if (histogram_is_pow2(BINS)) return v >> (8 - histogram_log2(BINS));
+    return (v * BINS) >> 8;
+}
+
+static inline int histogram_bin_runtime(uint8_t v, int bins) {
+    return (v * bins) >> 8;
+}
+
+// ============================================================================
+// HISTOGRAM ENGINE
+// ============================================================================
+
+/**
+ * Histogram accumulator specialised on bin count and channel layout
+ *
+ * Consecutive pixels land in LANES interleaved sub-histograms so runs of
+ * identical values do not serialize on one counter; merge() sums them.
+ * accumulate() may be called repeatedly (e.g. once per row of a region).
+ */
+template <int BINS, typename Layout, int LANES = 4>
+class HistogramEngine {
+public:
+    static const int CHANNELS = Layout::CHANNELS;
+    static const int SIZE = CHANNELS * BINS;
+
+    HistogramEngine() { reset(); }
+
+    void reset() {
+        memset(counts_, 0, sizeof(counts_));
+        total_ = 0;
+    }
+
+    void accumulate(const uint8_t* pixels, int pixel_count) {
+        uint8_t v[CHANNELS];
+        int i = 0;
+
+        for (; i + LANES <= pixel_count; i += LANES) {
+            for (int lane = 0; lane < LANES; lane++) {
+                Layout::sample(pixels + (i + lane) * Layout::STRIDE, v);
+                for (int c = 0; c < CHANNELS; c++) {
+                    counts_[lane][c][histogram_bin<BINS>(v[c])]++;
+                }
+            }
+        }
+
+        for (; i < pixel_count; i++) {
+            Layout::sample(pixels + i * Layout::STRIDE, v);
+            for (int c = 0; c < CHANNELS; c++) {
+                counts_[0][c][histogram_bin<BINS>(v[c])]++;
+            }
+        }
+
+        total_ += pixel_count;
+    }
+
+    /**
+     * Sum sub-histograms into out (CHANNELS * BINS counts, channel-major)
+     */
+    void merge(uint32_t* out) const {
+        for (int c = 0; c < CHANNELS; c++) {
+            for (int b = 0; b < BINS; b++) {
+                uint32_t sum = 0;
+                for (int lane = 0; lane < LANES; lane++) sum += counts_[lane][c][b];
+                out[c * BINS + b] = sum;
+            }
+        }
+    }
+
+    /**
+     * Merge and normalize by pixel count into out (CHANNELS * BINS floats)
+     */
+    void merge_normalized(float* out) const {
+        uint32_t merged[SIZE];
+        merge(merged);
+
+        float scale = (total_ > 0) ? 1.0f / (float)total_ : 0.0f;
+        for (int i = 0; i < SIZE; i++) out[i] = merged[i] * scale;
+    }
+
+    uint32_t total() const { return total_; }
+
+private:
+    uint32_t counts_[LANES][CHANNELS][BINS];
+    uint32_t total_;
+};
+
+/**
+ * Fold a full-resolution (256-bin) channel histogram into `bins` bins
+ * Used for bin counts that are only known at runtime
+ */
+static inline void fold_histogram_256(const uint32_t* full, int bins, uint32_t* out) {
+    memset(out, 0, bins * sizeof(uint32_t));
+    for (int v = 0; v < 256; v++) {
+        out[histogram_bin_runtime((uint8_t)v, bins)] += full[v];
+    }
+}
+
+#endif // HISTOGRAM_ENGINE_H
@@ -0,0 +1,407 @@
+/**
+ * Storyboard WebAssembly Module
+ * Trickplay sprite-sheet generation from already-decoded keyframes
+ */
+
+#include <emscripten.h>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+#include "frame_region.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ============================================================================
+// SEPARABLE RESAMPLER
+// ============================================================================
+
+// Resampling filters
+static const int RESAMPLE_AREA = 0;      // box / pixel-area average (best for large downscales)
+static const int RESAMPLE_LANCZOS3 = 1;  // windowed sinc, a = 3
+
+/**
+ * Per-axis filter taps: output sample i reads `count[i]` source samples
+ * starting at `start[i]`, weighted by weights[i * max_taps + k]
+ */
+struct ResampleWeights {
+    int* start;
+    int* count;
+    float* weights;
+    int max_taps;
+};
+
+static void free_resample_weights(ResampleWeights& w) {
+    free(w.start); free(w.count); free(w.weights);
+    w.start = nullptr; w.count = nullptr; w.weights = nullptr;
+}
+
+static inline float lanczos3(float x) {
+    x = fabsf(x);
+    if (x < 1e-6f) return 1.0f;
+    if (x >= 3.0f) return 0.0f;
+    float px = (float)M_PI * x;
+    return 3.0f * sinf(px) * sinf(px / 3.0f) / (px * px);
+}
+
+static bool build_resample_weights(int src_size, int dst_size, int filter, ResampleWeights& w) {
+    float scale = (float)src_size / dst_size;
+    float support = (filter == RESAMPLE_LANCZOS3) ? 3.0f * fmaxf(scale, 1.0f) : fmaxf(scale, 1.0f);
+
+    w.max_taps = (int)ceilf(support * 2.0f) + 2;
+    w.start = (int*)malloc(dst_size * sizeof(int));
+    w.count = (int*)malloc(dst_size * sizeof(int));
+    w.weights = (float*)calloc((size_t)dst_size * w.max_taps, sizeof(float));
+
+    if (!w.start || !w.count || !w.weights) {
+        free_resample_weights(w);
+        return false;
+    }
+
+    for (int i = 0; i < dst_size; i++) {
+        float* taps = w.weights + (size_t)i * w.max_taps;
+        int first, last;
+
+        if (filter == RESAMPLE_LANCZOS3) {
+            float center = (i + 0.5f) * scale;
+            float filter_scale = fmaxf(scale, 1.0f);
+            first = (int)floorf(center - support);
+            last = (int)ceilf(center + support);
+            if (first < 0) first = 0;
+            if (last > src_size - 1) last = src_size - 1;
+            if (last - first + 1 > w.max_taps) last = first + w.max_taps - 1;
+
+            for (int j = first; j <= last; j++) {
+                taps[j - first] = lanczos3((j + 0.5f - center) / filter_scale);
+            }
+        } else {
+            // Fractional coverage of each source sample by [i * scale, (i + 1) * scale)
+            float lo = i * scale;
+            float hi = (i + 1) * scale;
+            if (scale < 1.0f) {
+                // Upscaling: nearest-area sample
+                lo = floorf((i + 0.5f) * scale);
+                hi = lo + 1.0f;
+            }
+            first = (int)floorf(lo);
+            last = (int)ceilf(hi) - 1;
+            if (first < 0) first = 0;
+            if (last > src_size - 1) last = src_size - 1;
+            if (last - first + 1 > w.max_taps) last = first + w.max_taps - 1;
+
+            for (int j = first; j <= last; j++) {
+                float overlap = fminf(hi, j + 1.0f) - fmaxf(lo, (float)j);
+                taps[j - first] = fmaxf(overlap, 0.0f);
+            }
+        }
+
+        // Normalize so flat regions stay flat
+        float sum = 0.0f;
+        for (int k = 0; k <= last - first; k++) sum += taps[k];
+        if (sum != 0.0f) {
+            for (int k = 0; k <= last - first; k++) taps[k] /= sum;
+        }
+
+        w.start[i] = first;
+        w.count[i] = last - first + 1;
+    }
+
+    return true;
+}
+
+static inline uint8_t clamp_to_u8(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 255.0f) return 255;
+    return (uint8_t)(v + 0.5f);
+}
+
+/**
+ * Taps and scratch for one src_w x src_h -> dst_w x dst_h resize, built once
+ * and reused for every region of that size
+ */
+struct Resampler {
+    ResampleWeights wx, wy;
+    float* scratch;     // src_h rows of dst_w RGB floats (horizontal pass)
+    float* acc;         // one output row (vertical pass)
+    int src_w, src_h, dst_w, dst_h;
+};
+
+static void free_resampler(Resampler& r) {
+    free_resample_weights(r.wx);
+    free_resample_weights(r.wy);
+    free(r.scratch); free(r.acc);
+    r.scratch = nullptr; r.acc = nullptr;
+}
+
+static bool build_resampler(int src_w, int src_h, int dst_w, int dst_h, int filter, Resampler& r) {
+    r = {};
+    r.src_w = src_w; r.src_h = src_h; r.dst_w = dst_w; r.dst_h = dst_h;
+    if (!build_resample_weights(src_w, dst_w, filter, r.wx) ||
+        !build_resample_weights(src_h, dst_h, filter, r.wy)) {
+        free_resampler(r);
+        return false;
+    }
+
+    r.scratch = (float*)malloc((size_t)src_h * dst_w * 3 * sizeof(float));
+    r.acc = (float*)malloc((size_t)dst_w * 3 * sizeof(float));
+    if (!r.scratch || !r.acc) {
+        free_resampler(r);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Resample an RGB region of the resampler's source size into dst (row pitch
+ * dst_stride bytes): horizontal pass into the float scratch, then vertical pass
+ */
+static void resample_region(Resampler& r, const FrameRegion& src, uint8_t* dst, int dst_stride) {
+    const ResampleWeights& wx = r.wx;
+    const ResampleWeights& wy = r.wy;
+    int dst_w = r.dst_w;
+
+    // Horizontal pass: only rows referenced by the vertical filter
+    int row_first = wy.start[0];
+    int row_last = wy.start[r.dst_h - 1] + wy.count[r.dst_h - 1] - 1;
+
+    for (int y = row_first; y <= row_last; y++) {
+        const uint8_t* row = src.row(y);
+        float* out = r.scratch + (size_t)y * dst_w * 3;
+
+        for (int x = 0; x < dst_w; x++) {
+            const uint8_t* p = row + wx.start[x] * 3;
+            const float* taps = wx.weights + (size_t)x * wx.max_taps;
+            float red = 0.0f, g = 0.0f, b = 0.0f;
+
+            for (int k = 0; k < wx.count[x]; k++) {
+                red += taps[k] * p[k * 3];
+                g += taps[k] * p[k * 3 + 1];
+                b += taps[k] * p[k * 3 + 2];
+            }
+
+            out[x * 3] = red;
+            out[x * 3 + 1] = g;
+            out[x * 3 + 2] = b;
+        }
+    }
+
+    // Vertical pass: accumulate whole scratch rows so the inner loop is contiguous
+    float* acc = r.acc;
+    for (int y = 0; y < r.dst_h; y++) {
+        const float* taps = wy.weights + (size_t)y * wy.max_taps;
+        memset(acc, 0, (size_t)dst_w * 3 * sizeof(float));
+
+        for (int k = 0; k < wy.count[y]; k++) {
+            const float* in = r.scratch + (size_t)(wy.start[y] + k) * dst_w * 3;
+            float t = taps[k];
+            for (int i = 0; i < dst_w * 3; i++) acc[i] += t * in[i];
+        }
+
+        uint8_t* out = dst + (size_t)y * dst_stride;
+        for (int i = 0; i < dst_w * 3; i++) out[i] = clamp_to_u8(acc[i]);
+    }
+}
+
+/**
+ * Resample an RGB frame (or ROI of it) to dst_w x dst_h
+ * filter: 0 = area, 1 = Lanczos-3; stride <= 0 means width * 3
+ * Returns 1 on success, 0 on failure
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int resample_frame_rgb(uint8_t* frame_data, int width, int height,
+                       int roi_x, int roi_y, int roi_w, int roi_h, int stride,
+                       uint8_t* output, int dst_w, int dst_h, int filter) {
+    if (!frame_data || !output || width <= 0 || height <= 0 || dst_w <= 0 || dst_h <= 0) return 0;
+
+    FrameRegion src = make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+    if (src.pixel_count() <= 0) return 0;
+
+    Resampler r;
+    if (!build_resampler(src.width, src.height, dst_w, dst_h, filter, r)) return 0;
+    resample_region(r, src, output, dst_w * 3);
+    free_resampler(r);
+    return 1;
+}
+
+// ============================================================================
+// SPRITE SHEETS
+// ============================================================================
+
+/**
+ * Number of sprite sheets needed for tile_count tiles
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int get_storyboard_sheet_count(int tile_count, int columns, int rows) {
+    if (tile_count < 1 || columns < 1 || rows < 1) return 0;
+    int per_sheet = columns * rows;
+    return (tile_count + per_sheet - 1) / per_sheet;
+}
+
+/**
+ * Pack selected frames into RGB sprite sheets
+ * frame_indices: tile_count indices into frames_data (e.g. select_representative_keyframes
+ * output); nullptr uses frames 0..tile_count-1. The ROI (e.g. detect_active_area) is
+ * cropped before scaling; pass roi_w = roi_h = 0 for the full frame.
+ * Returns get_storyboard_sheet_count() sheets back to back, each
+ * (columns * tile_w) x (rows * tile_h) RGB; unused cells are black
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint8_t* generate_storyboard(uint8_t* frames_data, int frame_count, int width, int height,
+                             int* frame_indices, int tile_count,
+                             int tile_w, int tile_h, int columns, int rows, int filter,
+                             int roi_x, int roi_y, int roi_w, int roi_h) {
+    if (!frames_data || frame_count < 1 || width <= 0 || height <= 0) return nullptr;
+    if (tile_w < 1 || tile_h < 1) return nullptr;
+
+    int sheet_count = get_storyboard_sheet_count(tile_count, columns, rows);
+    if (sheet_count < 1) return nullptr;
+
+    int sheet_stride = columns * tile_w * 3;
+    size_t sheet_size = (size_t)sheet_stride * rows * tile_h;
+
+    uint8_t* sheets = (uint8_t*)calloc(sheet_count, sheet_size);
+    if (!sheets) return nullptr;
+
+    int per_sheet = columns * rows;
+
+    // Every tile is the same ROI scaled to the same size: one set of taps
+    FrameRegion roi = sequence_frame_region(frames_data, 0, width, height, roi_x, roi_y, roi_w, roi_h, 0);
+    Resampler r;
+    if (roi.pixel_count() <= 0 || !build_resampler(roi.width, roi.height, tile_w, tile_h, filter, r)) {
+        free(sheets);
+        return nullptr;
+    }
+
+    for (int t = 0; t < tile_count; t++) {
+        int frame = frame_indices ? frame_indices[t] : t;
+        if (frame < 0 || frame >= frame_count) continue;
+
+        int cell = t % per_sheet;
+        uint8_t* sheet = sheets + (size_t)(t / per_sheet) * sheet_size;
+        uint8_t* dst = sheet + (size_t)(cell / columns) * tile_h * sheet_stride + (cell % columns) * tile_w * 3;
+
+        FrameRegion src = sequence_frame_region(frames_data, frame, width, height, roi_x, roi_y, roi_w, roi_h, 0);
+        resample_region(r, src, dst, sheet_stride);
+    }
+
+    free_resampler(r);
+    return sheets;
+}
+
+// ============================================================================
+// TILE INDEX (WebVTT)
+// ============================================================================
+
+/**
+ * Tile index for a storyboard
+ * timestamps: tile_count presentation times in seconds (ascending)
+ * Returns tile_count records of [sheet, x, y, w, h, start_time, end_time];
+ * each tile lasts until the next timestamp, the last one until `duration`
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+float* build_storyboard_index(float* timestamps, int tile_count, float duration,
+                              int tile_w, int tile_h, int columns, int rows) {
+    if (!timestamps || tile_count < 1 || columns < 1 || rows < 1) return nullptr;
+
+    float* index = (float*)malloc((size_t)tile_count * 7 * sizeof(float));
+    if (!index) return nullptr;
+
+    int per_sheet = columns * rows;
+
+    for (int t = 0; t < tile_count; t++) {
+        int cell = t % per_sheet;
+        float* rec = index + t * 7;
+        rec[0] = (float)(t / per_sheet);
+        rec[1] = (float)((cell % columns) * tile_w);
+        rec[2] = (float)((cell / columns) * tile_h);
+        rec[3] = (float)tile_w;
+        rec[4] = (float)tile_h;
+        rec[5] = timestamps[t];
+        rec[6] = (t + 1 < tile_count) ? timestamps[t + 1] : fmaxf(duration, timestamps[t]);
+    }
+
+    return index;
+}
+
+static int format_vtt_time(char* out, size_t size, float seconds) {
+    if (seconds < 0.0f) seconds = 0.0f;
+    long long ms = (long long)(seconds * 1000.0f + 0.5f);
+    int h = (int)(ms / 3600000);
+    int m = (int)(ms / 60000 % 60);
+    int s = (int)(ms / 1000 % 60);
+    return snprintf(out, size, "%02d:%02d:%02d.%03d", h, m, s, (int)(ms % 1000));
+}
+
+/**
+ * Write the sheet URL, replacing the first "{sheet}" in the pattern with the sheet number
+ */
+static int format_sheet_url(char* out, size_t size, const char* pattern, int sheet) {
+    const char* token = strstr(pattern, "{sheet}");
+    if (!token) return snprintf(out, size, "%s", pattern);
+    return snprintf(out, size, "%.*s%d%s", (int)(token - pattern), pattern, sheet, token + 7);
+}
+
+/**
+ * Write one cue (pass out = nullptr, size = 0 to measure it)
+ */
+static int format_vtt_cue(char* out, size_t size, const float* rec, char* url, size_t url_size,
+                          const char* url_pattern) {
+    char start[16], end[16];
+    format_vtt_time(start, sizeof(start), rec[5]);
+    format_vtt_time(end, sizeof(end), rec[6]);
+    format_sheet_url(url, url_size, url_pattern, (int)rec[0]);
+
+    return snprintf(out, size, "%s --> %s\n%s#xywh=%d,%d,%d,%d\n\n",
+                    start, end, url, (int)rec[1], (int)rec[2], (int)rec[3], (int)rec[4]);
+}
+
+/**
+ * Generate a WebVTT thumbnail track for a storyboard
+ * url_pattern: sheet URL with "{sheet}" placeholder, e.g. "storyboard_{sheet}.jpg"
+ * Cues look like "storyboard_0.jpg#xywh=160,0,160,90"
+ * The buffer is sized from a measuring pass, so every cue is written in full
+ * Returns NUL-terminated string (free with wasm_free), nullptr on failure
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+char* generate_storyboard_vtt(float* timestamps, int tile_count, float duration,
+                              int tile_w, int tile_h, int columns, int rows, const char* url_pattern) {
+    if (!url_pattern) return nullptr;
+
+    float* index = build_storyboard_index(timestamps, tile_count, duration, tile_w, tile_h, columns, rows);
+    if (!index) return nullptr;
+
+    size_t url_size = strlen(url_pattern) + 16;
+    char* url = (char*)malloc(url_size);
+    if (!url) { free(index); return nullptr; }
+
+    const char* header = "WEBVTT\n\n";
+    size_t capacity = strlen(header) + 1;
+    for (int t = 0; t < tile_count; t++) {
+        int len = format_vtt_cue(nullptr, 0, index + t * 7, url, url_size, url_pattern);
+        if (len < 0) { free(url); free(index); return nullptr; }
+        capacity += (size_t)len;
+    }
+
+    char* vtt = (char*)malloc(capacity);
+    if (!vtt) { free(url); free(index); return nullptr; }
+
+    size_t pos = (size_t)snprintf(vtt, capacity, "%s", header);
+    for (int t = 0; t < tile_count; t++) {
+        pos += (size_t)format_vtt_cue(vtt + pos, capacity - pos, index + t * 7, url, url_size, url_pattern);
+    }
+
+    free(url);
+    free(index);
+    return vtt;
+}
+
+// Memory management
+extern "C" EMSCRIPTEN_KEEPALIVE
+void* wasm_malloc(int size) { return malloc(size); }
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void wasm_free(void* ptr) { free(ptr); }
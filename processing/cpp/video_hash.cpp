@@ -9,6 +9,8 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "frame_region.h"
+
 // ============================================================================
 // PERCEPTUAL HASHING (pHash)
 // ============================================================================
@@ -41,7 +43,9 @@ static void compute_dct_8x8(float* input, float* output) {
 /**
  * Resize image to 32x32 using bilinear interpolation
  */
-static void resize_to_32x32(uint8_t* input, int width, int height, float* output) {
+static void resize_to_32x32(const FrameRegion& region, float* output) {
+    int width = region.width;
+    int height = region.height;
     float x_ratio = (float)(width - 1) / 31.0f;
     float y_ratio = (float)(height - 1) / 31.0f;
     
@@ -53,17 +57,19 @@ static void resize_to_32x32(uint8_t* input, int width, int height, float* output
             int gyi = (int)gy;
             float dx = gx - gxi;
             float dy = gy - gyi;
+            int gxi1 = (gxi + 1 < width) ? gxi + 1 : gxi;
+            int gyi1 = (gyi + 1 < height) ? gyi + 1 : gyi;
             
-            int idx00 = (gyi * width + gxi) * 3;
-            int idx01 = (gyi * width + gxi + 1) * 3;
-            int idx10 = ((gyi + 1) * width + gxi) * 3;
-            int idx11 = ((gyi + 1) * width + gxi + 1) * 3;
+            const uint8_t* p00 = region.pixel(gxi, gyi);
+            const uint8_t* p01 = region.pixel(gxi1, gyi);
+            const uint8_t* p10 = region.pixel(gxi, gyi1);
+            const uint8_t* p11 = region.pixel(gxi1, gyi1);
             
             // Convert to grayscale and interpolate
-            float v00 = 0.299f * input[idx00] + 0.587f * input[idx00+1] + 0.114f * input[idx00+2];
-            float v01 = 0.299f * input[idx01] + 0.587f * input[idx01+1] + 0.114f * input[idx01+2];
-            float v10 = 0.299f * input[idx10] + 0.587f * input[idx10+1] + 0.114f * input[idx10+2];
-            float v11 = 0.299f * input[idx11] + 0.587f * input[idx11+1] + 0.114f * input[idx11+2];
+            float v00 = 0.299f * p00[0] + 0.587f * p00[1] + 0.114f * p00[2];
+            float v01 = 0.299f * p01[0] + 0.587f * p01[1] + 0.114f * p01[2];
+            float v10 = 0.299f * p10[0] + 0.587f * p10[1] + 0.114f * p10[2];
+            float v11 = 0.299f * p11[0] + 0.587f * p11[1] + 0.114f * p11[2];
             
             output[y * 32 + x] = v00 * (1-dx) * (1-dy) + v01 * dx * (1-dy) +
                                  v10 * (1-dx) * dy + v11 * dx * dy;
@@ -71,19 +77,14 @@ static void resize_to_32x32(uint8_t* input, int width, int height, float* output
     }
 }
 
-/**
- * Compute perceptual hash (pHash) for a frame
- * Returns 64-bit hash value
- */
-extern "C" EMSCRIPTEN_KEEPALIVE
-uint64_t compute_phash(uint8_t* frame_data, int width, int height) {
-    if (!frame_data || width < 32 || height < 32) return 0;
+static uint64_t phash_region(const FrameRegion& region) {
+    if (region.width < 32 || region.height < 32) return 0;
     
     // Step 1: Resize to 32x32
     float* small = (float*)malloc(32 * 32 * sizeof(float));
     if (!small) return 0;
     
-    resize_to_32x32(frame_data, width, height, small);
+    resize_to_32x32(region, small);
     
     // Step 2: Compute DCT
     float* dct = (float*)malloc(32 * 32 * sizeof(float));
@@ -123,11 +124,33 @@ uint64_t compute_phash(uint8_t* frame_data, int width, int height) {
 }
 
 /**
- * Compute average hash (aHash) - simpler but less robust
+ * Compute perceptual hash (pHash) for a frame
+ * Returns 64-bit hash value
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-uint64_t compute_ahash(uint8_t* frame_data, int width, int height) {
-    if (!frame_data || width < 8 || height < 8) return 0;
+uint64_t compute_phash(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width < 32 || height < 32) return 0;
+    
+    return phash_region(full_frame_region(frame_data, width, height));
+}
+
+/**
+ * Compute pHash over a region of interest (e.g. the detected active area)
+ * roi_w / roi_h <= 0 extend to the frame edge; stride <= 0 means width * 3
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint64_t compute_phash_roi(uint8_t* frame_data, int width, int height,
+                           int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width < 32 || height < 32) return 0;
+    
+    return phash_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride));
+}
+
+static uint64_t ahash_region(const FrameRegion& region) {
+    if (region.width < 8 || region.height < 8) return 0;
+    
+    int width = region.width;
+    int height = region.height;
     
     // Resize to 8x8
     float x_ratio = (float)(width - 1) / 7.0f;
@@ -138,10 +161,10 @@ uint64_t compute_ahash(uint8_t* frame_data, int width, int height) {
         for (int x = 0; x < 8; x++) {
             int gx = (int)(x * x_ratio);
             int gy = (int)(y * y_ratio);
-            int idx = (gy * width + gx) * 3;
-            small[y * 8 + x] = 0.299f * frame_data[idx] + 
-                               0.587f * frame_data[idx+1] + 
-                               0.114f * frame_data[idx+2];
+            const uint8_t* p = region.pixel(gx, gy);
+            small[y * 8 + x] = 0.299f * p[0] + 
+                               0.587f * p[1] + 
+                               0.114f * p[2];
         }
     }
     
@@ -160,11 +183,28 @@ uint64_t compute_ahash(uint8_t* frame_data, int width, int height) {
 }
 
 /**
- * Compute difference hash (dHash) - good for similar image detection
+ * Compute average hash (aHash) - simpler but less robust
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-uint64_t compute_dhash(uint8_t* frame_data, int width, int height) {
-    if (!frame_data || width < 9 || height < 8) return 0;
+uint64_t compute_ahash(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width < 8 || height < 8) return 0;
+    
+    return ahash_region(full_frame_region(frame_data, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint64_t compute_ahash_roi(uint8_t* frame_data, int width, int height,
+                           int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width < 8 || height < 8) return 0;
+    
+    return ahash_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride));
+}
+
+static uint64_t dhash_region(const FrameRegion& region) {
+    if (region.width < 9 || region.height < 8) return 0;
+    
+    int width = region.width;
+    int height = region.height;
     
     // Resize to 9x8 (9 columns for 8 horizontal differences)
     float x_ratio = (float)(width - 1) / 8.0f;
@@ -175,10 +215,10 @@ uint64_t compute_dhash(uint8_t* frame_data, int width, int height) {
         for (int x = 0; x < 9; x++) {
             int gx = (int)(x * x_ratio);
             int gy = (int)(y * y_ratio);
-            int idx = (gy * width + gx) * 3;
-            small[y * 9 + x] = 0.299f * frame_data[idx] + 
-                               0.587f * frame_data[idx+1] + 
-                               0.114f * frame_data[idx+2];
+            const uint8_t* p = region.pixel(gx, gy);
+            small[y * 9 + x] = 0.299f * p[0] + 
+                               0.587f * p[1] + 
+                               0.114f * p[2];
         }
     }
     
@@ -197,6 +237,24 @@ uint64_t compute_dhash(uint8_t* frame_data, int width, int height) {
     return hash;
 }
 
+/**
+ * Compute difference hash (dHash) - good for similar image detection
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint64_t compute_dhash(uint8_t* frame_data, int width, int height) {
+    if (!frame_data || width < 9 || height < 8) return 0;
+    
+    return dhash_region(full_frame_region(frame_data, width, height));
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint64_t compute_dhash_roi(uint8_t* frame_data, int width, int height,
+                           int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frame_data || width < 9 || height < 8) return 0;
+    
+    return dhash_region(make_frame_region(frame_data, width, height, roi_x, roi_y, roi_w, roi_h, stride));
+}
+
 // ============================================================================
 // HASH COMPARISON
 // ============================================================================
@@ -300,29 +358,41 @@ float* find_similar_videos(uint64_t* query_hashes, int hash_count,
 // ============================================================================
 
 /**
- * Compute video fingerprint from multiple frames
+ * Compute video fingerprint from multiple frames, hashing only the ROI
+ * Frames are contiguous, each stride * height bytes
  * Returns array of hashes for the video
  */
 extern "C" EMSCRIPTEN_KEEPALIVE
-uint64_t* compute_video_fingerprint(uint8_t* frames_data, int frame_count, 
-                                    int width, int height, int sample_interval) {
-    if (!frames_data || frame_count < 1) return nullptr;
+uint64_t* compute_video_fingerprint_roi(uint8_t* frames_data, int frame_count,
+                                        int width, int height, int sample_interval,
+                                        int roi_x, int roi_y, int roi_w, int roi_h, int stride) {
+    if (!frames_data || frame_count < 1 || sample_interval < 1) return nullptr;
     
     int sampled_count = (frame_count + sample_interval - 1) / sample_interval;
     uint64_t* fingerprint = (uint64_t*)malloc(sampled_count * sizeof(uint64_t));
     if (!fingerprint) return nullptr;
     
-    int frame_size = width * height * 3;
     int hash_idx = 0;
     
     for (int i = 0; i < frame_count && hash_idx < sampled_count; i += sample_interval) {
-        uint8_t* frame = frames_data + i * frame_size;
-        fingerprint[hash_idx++] = compute_phash(frame, width, height);
+        FrameRegion frame = sequence_frame_region(frames_data, i, width, height, roi_x, roi_y, roi_w, roi_h, stride);
+        fingerprint[hash_idx++] = phash_region(frame);
     }
     
     return fingerprint;
 }
 
+/**
+ * Compute video fingerprint from multiple frames
+ * Returns array of hashes for the video
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+uint64_t* compute_video_fingerprint(uint8_t* frames_data, int frame_count, 
+                                    int width, int height, int sample_interval) {
+    return compute_video_fingerprint_roi(frames_data, frame_count, width, height, sample_interval,
+                                         0, 0, 0, 0, 0);
+}
+
 /**
  * Get fingerprint length
  */
@@ -2,16 +2,20 @@ from pyflink.datastream import StreamExecutionEnvironment, ProcessFunction, Keye
 from pyflink.datastream.connectors import KafkaSource, KafkaSink
 from pyflink.common.serialization import JsonRowDeserializationSchema, JsonRowSerializationSchema
 from pyflink.common.watermark_strategy import WatermarkStrategy
-from pyflink.common.time import Time
-from pyflink.datastream.window import TumblingEventTimeWindows
+from pyflink.common.typeinfo import Types
+from pyflink.datastream.state import ListStateDescriptor
 import wasmtime
+import numpy as np
 import json
 import logging
 
-class WasmQoEProcessor(KeyedProcessFunction):
+class WasmQoEProcessor(ProcessFunction):
+    """Scores the window batches WasmSessionAggregator emits, one Wasm call
+    per column op per batch; nothing is buffered between records"""
     def __init__(self, wasm_path):
         self.wasm_path = wasm_path
         self.engine = None
+        self.store = None
         self.instance = None
         
     def open(self, runtime_context):
@@ -19,37 +23,58 @@ class WasmQoEProcessor(KeyedProcessFunction):
         with open(self.wasm_path, 'rb') as f:
             wasm_bytes = f.read()
         module = wasmtime.Module(self.engine, wasm_bytes)
-        store = wasmtime.Store(self.engine)
-        self.instance = wasmtime.Instance(store, module, [])
-        self.calculate_qoe = self.instance.exports["calculate_qoe"]
-        self.classify_qoe = self.instance.exports["classify_qoe"]
+        self.store = wasmtime.Store(self.engine)
+        self.instance = wasmtime.Instance(self.store, module, [])
+        exports = self.instance.exports(self.store)
+        self.memory = exports["memory"]
+        self.malloc = exports["malloc"]
+        self.free = exports["free"]
+        self.calculate_qoe_batch = exports["calculate_qoe_batch"]
+        self.classify_qoe_batch = exports["classify_qoe_batch"]
+        
+    def score_sessions(self, sessions):
+        """QoE scores and classes for a mini-batch: one Wasm call per column op, not per record"""
+        count = len(sessions)
+        column_bytes = count * 4
+        base = self.malloc(self.store, column_bytes * 5)
+        bitrate_ptr, buffering_ptr, startup_ptr, qoe_ptr, class_ptr = (base + i * column_bytes for i in range(5))
         
-    def process_element(self, session, ctx):
         try:
-            # Calculate QoE using Wasm
-            qoe_score = self.calculate_qoe(
-                ctx.get_current_key(),
-                session['avg_bitrate'],
-                session['buffering_ratio'],
-                session['startup_delay']
-            )
+            for ptr, field in ((bitrate_ptr, 'avg_bitrate'), (buffering_ptr, 'buffering_ratio'), (startup_ptr, 'startup_delay')):
+                column = np.array([s[field] for s in sessions], dtype=np.float32)
+                self.memory.write(self.store, column.tobytes(), ptr)
             
-            # Classify QoE
-            qoe_class = self.classify_qoe(ctx.get_current_key(), qoe_score)
-            
-            # Enrich session data
-            enriched_session = {
-                **session,
-                'qoe_score': qoe_score,
-                'qoe_class': qoe_class,
-                'timestamp': ctx.timestamp()
-            }
-            
-            yield enriched_session
+            self.calculate_qoe_batch(self.store, bitrate_ptr, buffering_ptr, startup_ptr, count, qoe_ptr)
+            self.classify_qoe_batch(self.store, qoe_ptr, count, class_ptr)
             
+            scores = np.frombuffer(self.memory.read(self.store, qoe_ptr, qoe_ptr + column_bytes), dtype=np.float32)
+            classes = np.frombuffer(self.memory.read(self.store, class_ptr, class_ptr + column_bytes), dtype=np.int32)
+        finally:
+            self.free(self.store, base)
+        
+        return scores, classes
+        
+    def enrich_batch(self, sessions, timestamp):
+        """Score and enrich many sessions at once"""
+        if not sessions:
+            return []
+        try:
+            scores, classes = self.score_sessions(sessions)
+            return [
+                {
+                    **session,
+                    'qoe_score': float(score),
+                    'qoe_class': int(qoe_class),
+                    'timestamp': timestamp
+                }
+                for session, score, qoe_class in zip(sessions, scores, classes)
+            ]
         except Exception as e:
             logging.error(f"QoE processing error: {e}")
-            yield session
+            return list(sessions)
+        
+    def process_element(self, windows, ctx):
+        yield from self.enrich_batch(windows, ctx.timestamp())
 
 class WasmAnomalyDetector(ProcessFunction):
     def __init__(self, wasm_path):
@@ -89,6 +114,226 @@ class WasmAnomalyDetector(ProcessFunction):
             logging.error(f"Anomaly detection error: {e}")
             yield session
 
+class WasmSessionAggregator(KeyedProcessFunction):
+    """30 s tumbling windows per session, aggregated in Wasm (session_aggregator.cpp)
+    
+    Runs on the stream keyed by session_id. Each event is appended to keyed
+    list state, so open windows are checkpointed, and handed to Wasm a batch
+    at a time. An event-time timer at each window end emits every window the
+    watermark has closed in one bulk call, as one list record for
+    WasmQoEProcessor to score as a batch; each session's own timer then
+    drops the emitted events from its state. After a restore the Wasm table
+    starts empty: a session's events are reloaded from state the first time
+    the session is seen again, and windows that closed in the meantime are
+    aggregated on their own. Malformed events are dropped and counted.
+    """
+    def __init__(self, wasm_path, window_seconds=30, batch_size=1024, emit_capacity=4096):
+        self.wasm_path = wasm_path
+        self.window_ms = window_seconds * 1000
+        self.batch_size = batch_size
+        self.emit_capacity = emit_capacity
+        self.engine = None
+        self.store = None
+        self.instance = None
+        
+    def open(self, runtime_context):
+        self.engine = wasmtime.Engine()
+        with open(self.wasm_path, 'rb') as f:
+            wasm_bytes = f.read()
+        module = wasmtime.Module(self.engine, wasm_bytes)
+        self.store = wasmtime.Store(self.engine)
+        self.instance = wasmtime.Instance(self.store, module, [])
+        exports = self.instance.exports(self.store)
+        self.memory = exports["memory"]
+        self.malloc = exports["malloc"]
+        self.free = exports["free"]
+        self.hash_session_ids = exports["hash_session_ids"]
+        self.add_events = exports["session_aggregator_add_events"]
+        self.emit = exports["session_aggregator_emit"]
+        self.create_aggregator = exports["create_session_aggregator"]
+        self.destroy_aggregator = exports["destroy_session_aggregator"]
+        self.aggregator = self.create_aggregator(self.store, self.window_ms / 1000.0, 0)
+        
+        # (timestamp, bitrate, buffering_events, startup_delay) of the session's open windows
+        self.events = runtime_context.get_list_state(
+            ListStateDescriptor("session_window_events", Types.PICKLED_BYTE_ARRAY()))
+        metrics = runtime_context.get_metrics_group()
+        self.invalid_events = metrics.counter("invalidSessionEvents")
+        self.late_events = metrics.counter("lateSessionEvents")
+        
+        self.pending = []
+        self.loaded = set()
+        self.session_ids = {}
+        self.emitted_through = None
+        
+    def close(self):
+        if self.instance is not None:
+            self.destroy_aggregator(self.store, self.aggregator)
+        
+    def write_column(self, ptr, values, dtype):
+        self.memory.write(self.store, np.asarray(values, dtype=dtype).tobytes(), ptr)
+        
+    def read_column(self, ptr, count, dtype):
+        size = count * np.dtype(dtype).itemsize
+        return np.frombuffer(self.memory.read(self.store, ptr, ptr + size), dtype=dtype)
+        
+    def add_rows(self, aggregator, entries):
+        """Hash and aggregate (session_id, row) entries with one call each"""
+        count = len(entries)
+        if count == 0:
+            return
+        ids = [str(session_id).encode() for session_id, _ in entries]
+        packed = b''.join(ids)
+        offsets = np.zeros(count + 1, dtype=np.int32)
+        np.cumsum([len(i) for i in ids], out=offsets[1:])
+        
+        # hashes, times (8 bytes); bitrate, buffering events, startup (4); offsets; packed ids
+        base = self.malloc(self.store, count * 28 + (count + 1) * 4 + len(packed))
+        hash_ptr = base
+        time_ptr = hash_ptr + count * 8
+        bitrate_ptr = time_ptr + count * 8
+        buffering_ptr = bitrate_ptr + count * 4
+        startup_ptr = buffering_ptr + count * 4
+        offsets_ptr = startup_ptr + count * 4
+        ids_ptr = offsets_ptr + (count + 1) * 4
+        
+        try:
+            self.memory.write(self.store, packed, ids_ptr)
+            self.write_column(offsets_ptr, offsets, np.int32)
+            times, bitrates, buffering, startup = zip(*(row for _, row in entries))
+            self.write_column(time_ptr, times, np.float64)
+            self.write_column(bitrate_ptr, bitrates, np.float32)
+            self.write_column(buffering_ptr, buffering, np.int32)
+            self.write_column(startup_ptr, startup, np.float32)
+            
+            self.hash_session_ids(self.store, ids_ptr, offsets_ptr, count, hash_ptr)
+            self.add_events(self.store, aggregator, hash_ptr, time_ptr, bitrate_ptr, buffering_ptr, startup_ptr, count)
+            
+            # Session id and latest window per hash, to label emitted windows
+            hashes = self.read_column(hash_ptr, count, np.uint64).tolist()
+            windows = (np.array(times) // self.window_ms).tolist()
+            self.session_ids.update(zip(hashes, zip((session_id for session_id, _ in entries), windows)))
+        finally:
+            self.free(self.store, base)
+        
+    def flush(self):
+        self.add_rows(self.aggregator, self.pending)
+        self.pending = []
+        
+    def emit_windows(self, aggregator, watermark):
+        """All windows that closed at the watermark, as session records"""
+        cap = self.emit_capacity
+        # session hash, window start (8 bytes); six 4-byte columns
+        base = self.malloc(self.store, cap * 16 + cap * 4 * 6)
+        ptrs = [base, base + cap * 8] + [base + cap * 16 + cap * 4 * i for i in range(6)]
+        windows = []
+        
+        try:
+            while True:
+                n = self.emit(self.store, aggregator, float(watermark), cap, *ptrs)
+                if n == 0:
+                    break
+                hashes = self.read_column(ptrs[0], n, np.uint64).tolist()
+                starts = self.read_column(ptrs[1], n, np.float64)
+                events = self.read_column(ptrs[2], n, np.int32)
+                avg_bitrate, variance, buffering = (self.read_column(p, n, np.float32) for p in ptrs[3:6])
+                buffering_events = self.read_column(ptrs[6], n, np.int32)
+                startup = self.read_column(ptrs[7], n, np.float32)
+                
+                for i, h in enumerate(hashes):
+                    session_id, last_window = self.session_ids.get(h, (h, None))
+                    if last_window is not None and last_window <= starts[i] // self.window_ms:
+                        del self.session_ids[h]
+                    windows.append({
+                        'session_id': session_id,
+                        'window_start': float(starts[i]),
+                        'event_count': int(events[i]),
+                        'avg_bitrate': float(avg_bitrate[i]),
+                        'bitrate_variance': float(variance[i]),
+                        'buffering_ratio': float(buffering[i]),
+                        'buffering_events': int(buffering_events[i]),
+                        'startup_delay': float(startup[i])
+                    })
+                if n < cap:
+                    break
+        finally:
+            self.free(self.store, base)
+        return windows
+        
+    def load_session(self, session_id, before=None):
+        """Queue the session's checkpointed events for Wasm once per incarnation
+        
+        Events earlier than `before` are returned instead: their windows close
+        at or before a window end this table may already have emitted.
+        """
+        if session_id in self.loaded:
+            return []
+        self.loaded.add(session_id)
+        closed = []
+        for row in self.events.get():
+            (closed if before is not None and row[0] < before else self.pending).append((session_id, row))
+        return closed
+        
+    def emit_restored(self, entries, timestamp):
+        """Windows of a session restored from a checkpoint, aggregated on their own"""
+        if not entries:
+            return []
+        aggregator = self.create_aggregator(self.store, self.window_ms / 1000.0, 0)
+        try:
+            self.add_rows(aggregator, entries)
+            return self.emit_windows(aggregator, timestamp)
+        finally:
+            self.destroy_aggregator(self.store, aggregator)
+        
+    def process_element(self, event, ctx):
+        try:
+            if event.get('session_id') is None:
+                raise KeyError('session_id')
+            row = (ctx.timestamp(), float(event['bitrate']), int(event['buffering_events']),
+                   float(event.get('startup_delay', -1.0)))
+        except (KeyError, TypeError, ValueError) as e:
+            # Dropped, not raised: a malformed record must not fail and replay the job forever
+            self.invalid_events.inc()
+            logging.warning(f"Dropping malformed session event ({e!r}): {event}")
+            return iter(())
+        
+        window_end = (row[0] // self.window_ms + 1) * self.window_ms
+        if window_end <= ctx.timer_service().current_watermark():
+            self.late_events.inc()
+            return iter(())
+        
+        session_id = ctx.get_current_key()
+        self.load_session(session_id)
+        self.events.add(row)
+        self.pending.append((session_id, row))
+        # Flink keeps one timer per key and timestamp
+        ctx.timer_service().register_event_time_timer(window_end)
+        if len(self.pending) >= self.batch_size:
+            self.flush()
+        return iter(())
+            
+    def on_timer(self, timestamp, ctx):
+        session_id = ctx.get_current_key()
+        windows = self.emit_restored(self.load_session(session_id, before=timestamp), timestamp)
+        
+        # Every session's timer for a window end fires at the same watermark:
+        # the first one emits all loaded sessions' windows
+        if self.emitted_through is None or timestamp > self.emitted_through:
+            self.emitted_through = timestamp
+            self.flush()
+            windows += self.emit_windows(self.aggregator, timestamp)
+        
+        # This session's windows up to the timer are out: keep only later events
+        remaining = [row for row in self.events.get() if row[0] >= timestamp]
+        if remaining:
+            self.events.update(remaining)
+        else:
+            self.events.clear()
+            self.loaded.discard(session_id)
+        
+        if windows:
+            yield windows
+
 def main():
     # Initialize Flink environment
     env = StreamExecutionEnvironment.get_execution_environment()
@@ -115,9 +360,8 @@ def main():
     
     # Process with Wasm UDFs
     processed_stream = data_stream \
-        .key_by(lambda x: x['session_id']) \
-        .window(TumblingEventTimeWindows.of(Time.seconds(30))) \
-        .process(SessionAggregator()) \
+        .key_by(lambda x: x.get('session_id')) \
+        .process(WasmSessionAggregator("lib/wasm/session_aggregator.wasm")) \
         .process(WasmQoEProcessor("lib/wasm/qoe_calculator.wasm")) \
         .process(WasmAnomalyDetector("lib/wasm/anomaly_detector.wasm"))
     
@@ -142,19 +386,5 @@ def main():
     # Execute pipeline
     env.execute("Spark Video Analytics Pipeline")
 
-class SessionAggregator:
-    def process(self, sessions):
-        # Aggregate session metrics over window
-        total_sessions = len(sessions)
-        avg_bitrate = sum(s['bitrate'] for s in sessions) / total_sessions
-        avg_buffering = sum(s['buffering_events'] for s in sessions) / total_sessions
-        
-        return {
-            'session_count': total_sessions,
-            'avg_bitrate': avg_bitrate,
-            'buffering_ratio': avg_buffering / max(1, total_sessions),
-            'startup_delay': sum(s.get('startup_delay', 0) for s in sessions) / total_sessions
-        }
-
 if __name__ == "__main__":
     main()
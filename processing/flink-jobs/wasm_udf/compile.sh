@@ -10,9 +10,10 @@ mkdir -p ../../lib/wasm
 echo "Compiling QoE Calculator..."
 emcc qoe_calculator.cpp \
   -O3 \
+  -msimd128 \
   -s WASM=1 \
   -s STANDALONE_WASM=1 \
-  -s EXPORTED_FUNCTIONS='["_calculate_qoe","_classify_qoe"]' \
+  -s EXPORTED_FUNCTIONS='["_calculate_qoe","_classify_qoe","_calculate_qoe_batch","_classify_qoe_batch","_malloc","_free"]' \
   -s ALLOW_MEMORY_GROWTH=1 \
   -o ../../lib/wasm/qoe_calculator.wasm
 
@@ -26,10 +27,25 @@ emcc anomaly_detector.cpp \
   -s ALLOW_MEMORY_GROWTH=1 \
   -o ../../lib/wasm/anomaly_detector.wasm
 
+# Build Session Aggregator (Wasm for the Flink job, native for other hosts)
+echo "Compiling Session Aggregator..."
+emcc session_aggregator.cpp \
+  -O3 \
+  -s WASM=1 \
+  -s STANDALONE_WASM=1 \
+  -s EXPORTED_FUNCTIONS='["_hash_session_ids","_create_session_aggregator","_destroy_session_aggregator","_session_aggregator_add_events","_session_aggregator_emit","_session_aggregator_open_windows","_session_aggregator_late_events","_malloc","_free"]' \
+  -s ALLOW_MEMORY_GROWTH=1 \
+  -o ../../lib/wasm/session_aggregator.wasm
+
+mkdir -p ../../lib/native
+g++ -O3 -shared -fPIC session_aggregator.cpp -o ../../lib/native/libsession_aggregator.so
+
 echo "Wasm UDFs built successfully!"
 echo "Files created:"
 echo "  - ../../lib/wasm/qoe_calculator.wasm"
 echo "  - ../../lib/wasm/anomaly_detector.wasm"
+echo "  - ../../lib/wasm/session_aggregator.wasm"
+echo "  - ../../lib/native/libsession_aggregator.so"
 
 # Make files executable
 chmod +x ../../lib/wasm/*.wasm
@@ -1,21 +1,25 @@
 #include <emscripten.h>
 #include <cmath>
 
-extern "C" EMSCRIPTEN_KEEPALIVE
-float calculate_qoe(float bitrate, float buffering_ratio, float startup_delay) {
+static inline float qoe_score(float bitrate, float buffering_ratio, float startup_delay) {
     const float MAX_BITRATE = 10000.0f;
     const float MAX_DELAY = 5.0f;
-    
+
     // Industry-standard QoE formula
     float bitrate_score = (bitrate / MAX_BITRATE);
     float buffering_penalty = (1.0f - buffering_ratio);
     float startup_penalty = (1.0f - fminf(startup_delay / MAX_DELAY, 1.0f));
-    
-    return (0.6f * bitrate_score) + 
-           (0.3f * buffering_penalty) + 
+
+    return (0.6f * bitrate_score) +
+           (0.3f * buffering_penalty) +
            (0.1f * startup_penalty);
 }
 
+extern "C" EMSCRIPTEN_KEEPALIVE
+float calculate_qoe(float bitrate, float buffering_ratio, float startup_delay) {
+    return qoe_score(bitrate, buffering_ratio, startup_delay);
+}
+
 extern "C" EMSCRIPTEN_KEEPALIVE
 int classify_qoe(float qoe_score) {
     if (qoe_score >= 0.8f) return 5; // Excellent
@@ -23,4 +27,29 @@ int classify_qoe(float qoe_score) {
     if (qoe_score >= 0.4f) return 3; // Fair
     if (qoe_score >= 0.2f) return 2; // Poor
     return 1; // Bad
-}
\ No newline at end of file
+}
+
+// Columnar entry points: one call per mini-batch instead of one per record.
+// Columns live in linear memory (malloc / free are exported for the host).
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int calculate_qoe_batch(float* bitrate, float* buffering_ratio, float* startup_delay, int count, float* qoe_out) {
+    if (!bitrate || !buffering_ratio || !startup_delay || !qoe_out || count < 1) return 0;
+
+    for (int i = 0; i < count; i++) {
+        qoe_out[i] = qoe_score(bitrate[i], buffering_ratio[i], startup_delay[i]);
+    }
+    return count;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int classify_qoe_batch(float* qoe_scores, int count, int* class_out) {
+    if (!qoe_scores || !class_out || count < 1) return 0;
+
+    // Same bands as classify_qoe, counted instead of branched
+    for (int i = 0; i < count; i++) {
+        float q = qoe_scores[i];
+        class_out[i] = 1 + (q >= 0.2f) + (q >= 0.4f) + (q >= 0.6f) + (q >= 0.8f);
+    }
+    return count;
+}
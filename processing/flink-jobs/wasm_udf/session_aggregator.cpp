@@ -0,0 +1,314 @@
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE   // native shared library (ctypes)
+#endif
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Tumbling-window session aggregation for the analytics stream.
+// Windows are keyed by (session-id hash, window index) in an open-addressing
+// table (linear probing, backward-shift deletion) whose per-window state is
+// kept as parallel arrays. Events go in and finished windows come out in
+// bulk, so the host makes one call per batch instead of one per event.
+
+static const int MIN_CAPACITY = 1024;       // slots, power of two
+static const float MAX_LOAD = 0.7f;
+
+struct SessionAggregator {
+    double window_ms;
+    double watermark_ms;        // windows ending at or before this are emitted
+    int capacity;
+    int size;
+    int late_events;            // dropped: their window was already emitted
+    int64_t min_window;         // lower bound of open window indices
+
+    // Per-slot window state (structure of arrays)
+    uint8_t* used;
+    uint64_t* session;
+    int64_t* window;
+    int* events;
+    double* bitrate_mean;       // Welford
+    double* bitrate_m2;
+    int* buffering_events;
+    double* startup_sum;        // over events reporting a startup delay
+    int* startup_count;
+};
+
+static inline uint32_t slot_home(uint64_t session, int64_t window, int mask) {
+    uint64_t h = session ^ ((uint64_t)window * 0x9E3779B97F4A7C15ULL);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return (uint32_t)h & mask;
+}
+
+static bool allocate_slots(SessionAggregator* agg, int capacity) {
+    agg->used = (uint8_t*)calloc(capacity, sizeof(uint8_t));
+    agg->session = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    agg->window = (int64_t*)malloc(capacity * sizeof(int64_t));
+    agg->events = (int*)malloc(capacity * sizeof(int));
+    agg->bitrate_mean = (double*)malloc(capacity * sizeof(double));
+    agg->bitrate_m2 = (double*)malloc(capacity * sizeof(double));
+    agg->buffering_events = (int*)malloc(capacity * sizeof(int));
+    agg->startup_sum = (double*)malloc(capacity * sizeof(double));
+    agg->startup_count = (int*)malloc(capacity * sizeof(int));
+    agg->capacity = capacity;
+
+    return agg->used && agg->session && agg->window && agg->events && agg->bitrate_mean && agg->bitrate_m2 &&
+           agg->buffering_events && agg->startup_sum && agg->startup_count;
+}
+
+static void free_slots(SessionAggregator* agg) {
+    free(agg->used);
+    free(agg->session);
+    free(agg->window);
+    free(agg->events);
+    free(agg->bitrate_mean);
+    free(agg->bitrate_m2);
+    free(agg->buffering_events);
+    free(agg->startup_sum);
+    free(agg->startup_count);
+}
+
+static void move_slot(SessionAggregator* dst, int to, const SessionAggregator* src, int from) {
+    dst->used[to] = 1;
+    dst->session[to] = src->session[from];
+    dst->window[to] = src->window[from];
+    dst->events[to] = src->events[from];
+    dst->bitrate_mean[to] = src->bitrate_mean[from];
+    dst->bitrate_m2[to] = src->bitrate_m2[from];
+    dst->buffering_events[to] = src->buffering_events[from];
+    dst->startup_sum[to] = src->startup_sum[from];
+    dst->startup_count[to] = src->startup_count[from];
+}
+
+static bool grow(SessionAggregator* agg) {
+    SessionAggregator old = *agg;
+    if (!allocate_slots(agg, old.capacity * 2)) {
+        free_slots(agg);
+        *agg = old;
+        return false;
+    }
+
+    int mask = agg->capacity - 1;
+    for (int i = 0; i < old.capacity; i++) {
+        if (!old.used[i]) continue;
+        uint32_t s = slot_home(old.session[i], old.window[i], mask);
+        while (agg->used[s]) s = (s + 1) & mask;
+        move_slot(agg, s, &old, i);
+    }
+    free_slots(&old);
+    return true;
+}
+
+/**
+ * Find or open the slot of (session, window); -1 when the table cannot grow
+ */
+static int find_slot(SessionAggregator* agg, uint64_t session, int64_t window) {
+    if (agg->size + 1 > agg->capacity * MAX_LOAD && !grow(agg)) return -1;
+
+    int mask = agg->capacity - 1;
+    uint32_t s = slot_home(session, window, mask);
+    while (agg->used[s]) {
+        if (agg->session[s] == session && agg->window[s] == window) return (int)s;
+        s = (s + 1) & mask;
+    }
+
+    agg->used[s] = 1;
+    agg->session[s] = session;
+    agg->window[s] = window;
+    agg->events[s] = 0;
+    agg->bitrate_mean[s] = 0.0;
+    agg->bitrate_m2[s] = 0.0;
+    agg->buffering_events[s] = 0;
+    agg->startup_sum[s] = 0.0;
+    agg->startup_count[s] = 0;
+    agg->size++;
+    if (window < agg->min_window) agg->min_window = window;
+    return (int)s;
+}
+
+/**
+ * Empty slot i and shift later entries of its probe run back over it
+ */
+static void remove_slot(SessionAggregator* agg, int i) {
+    int mask = agg->capacity - 1;
+    int hole = i;
+    int j = (i + 1) & mask;
+
+    while (agg->used[j]) {
+        int home = (int)slot_home(agg->session[j], agg->window[j], mask);
+        // Move j into the hole unless its home lies cyclically in (hole, j]
+        bool stays = (hole <= j) ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            move_slot(agg, hole, agg, j);
+            hole = j;
+        }
+        j = (j + 1) & mask;
+    }
+
+    agg->used[hole] = 0;
+    agg->size--;
+}
+
+/**
+ * FNV-1a 64-bit hash of a session id (hosts can hash the same way)
+ */
+static inline uint64_t fnv1a(const char* text, int length) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < length; i++) {
+        h ^= (uint8_t)text[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+/**
+ * Hash count session ids packed back to back in ids (offsets: count + 1
+ * byte offsets into ids) into out; returns count
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int hash_session_ids(const char* ids, int* offsets, int count, uint64_t* out) {
+    if (!ids || !offsets || !out || count < 1) return 0;
+    for (int i = 0; i < count; i++) out[i] = fnv1a(ids + offsets[i], offsets[i + 1] - offsets[i]);
+    return count;
+}
+
+/**
+ * Create an aggregator with tumbling windows of window_seconds (<= 0: 30)
+ * expected_sessions sizes the table up front (it grows as needed)
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+SessionAggregator* create_session_aggregator(float window_seconds, int expected_sessions) {
+    SessionAggregator* agg = (SessionAggregator*)calloc(1, sizeof(SessionAggregator));
+    if (!agg) return nullptr;
+
+    int capacity = MIN_CAPACITY;
+    while (capacity < (1 << 28) && capacity * MAX_LOAD < expected_sessions) capacity *= 2;
+
+    if (!allocate_slots(agg, capacity)) {
+        free_slots(agg);
+        free(agg);
+        return nullptr;
+    }
+    agg->window_ms = (window_seconds > 0.0f ? window_seconds : 30.0f) * 1000.0;
+    agg->watermark_ms = -INFINITY;
+    agg->min_window = INT64_MAX;
+    return agg;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+void destroy_session_aggregator(SessionAggregator* agg) {
+    if (!agg) return;
+    free_slots(agg);
+    free(agg);
+}
+
+/**
+ * Add count events (parallel columns, the video-sessions event fields)
+ * bitrate_kbps: playing bitrate; buffering_events: buffering events the
+ * event reports; startup_delay_s: < 0 when the event does not report one.
+ * Events whose window was already emitted are dropped.
+ * Returns number of events aggregated
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int session_aggregator_add_events(SessionAggregator* agg, uint64_t* session_hash, double* event_time_ms,
+                                  float* bitrate_kbps, int* buffering_events, float* startup_delay_s, int count) {
+    if (!agg || !session_hash || !event_time_ms || !bitrate_kbps || !buffering_events || count < 1) return 0;
+
+    int added = 0;
+    for (int e = 0; e < count; e++) {
+        int64_t window = (int64_t)floor(event_time_ms[e] / agg->window_ms);
+        if ((double)(window + 1) * agg->window_ms <= agg->watermark_ms) {
+            agg->late_events++;
+            continue;
+        }
+
+        int s = find_slot(agg, session_hash[e], window);
+        if (s < 0) break;
+
+        int n = ++agg->events[s];
+        double d = bitrate_kbps[e] - agg->bitrate_mean[s];
+        agg->bitrate_mean[s] += d / n;
+        agg->bitrate_m2[s] += d * (bitrate_kbps[e] - agg->bitrate_mean[s]);
+
+        if (buffering_events[e] > 0) agg->buffering_events[s] += buffering_events[e];
+        if (startup_delay_s && startup_delay_s[e] >= 0.0f) {
+            agg->startup_sum[s] += startup_delay_s[e];
+            agg->startup_count[s]++;
+        }
+        added++;
+    }
+    return added;
+}
+
+/**
+ * Emit windows that ended at or before watermark_ms, up to capacity of them
+ * Per window: session hash, window start (ms), events, mean bitrate,
+ * relative bitrate variance (variance / mean^2), buffering ratio (mean
+ * buffering events per event over the event count, as the Python window
+ * computed it), buffering events and mean startup delay (0 when none
+ * reported). Call again while it returns capacity.
+ * Returns number of windows written
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE
+int session_aggregator_emit(SessionAggregator* agg, double watermark_ms, int capacity, uint64_t* out_session,
+                            double* out_window_start_ms, int* out_events, float* out_avg_bitrate,
+                            float* out_bitrate_variance, float* out_buffering_ratio, int* out_buffering_events,
+                            float* out_startup_delay) {
+    if (!agg || capacity < 1 || !out_session || !out_window_start_ms || !out_events || !out_avg_bitrate ||
+        !out_bitrate_variance || !out_buffering_ratio || !out_buffering_events || !out_startup_delay) {
+        return 0;
+    }
+    if (watermark_ms > agg->watermark_ms) agg->watermark_ms = watermark_ms;
+
+    // Nothing has closed yet: skip the table scan
+    if (agg->size == 0 || (double)(agg->min_window + 1) * agg->window_ms > agg->watermark_ms) return 0;
+
+    int written = 0;
+    int i = 0;
+    int64_t min_open = INT64_MAX;
+    while (i < agg->capacity && written < capacity) {
+        if (!agg->used[i]) {
+            i++;
+            continue;
+        }
+        if ((double)(agg->window[i] + 1) * agg->window_ms > agg->watermark_ms) {
+            if (agg->window[i] < min_open) min_open = agg->window[i];
+            i++;
+            continue;
+        }
+
+        double mean = agg->bitrate_mean[i];
+        double variance = (agg->events[i] > 1) ? agg->bitrate_m2[i] / (agg->events[i] - 1) : 0.0;
+
+        out_session[written] = agg->session[i];
+        out_window_start_ms[written] = (double)agg->window[i] * agg->window_ms;
+        out_events[written] = agg->events[i];
+        out_avg_bitrate[written] = (float)mean;
+        out_bitrate_variance[written] = (mean > 0.0) ? (float)(variance / (mean * mean)) : 0.0f;
+        out_buffering_ratio[written] = (float)((double)agg->buffering_events[i] / agg->events[i] / agg->events[i]);
+        out_buffering_events[written] = agg->buffering_events[i];
+        out_startup_delay[written] = agg->startup_count[i] ? (float)(agg->startup_sum[i] / agg->startup_count[i]) : 0.0f;
+        written++;
+
+        // Slot i now holds the next entry of the run (if any): look again
+        remove_slot(agg, i);
+    }
+
+    if (i == agg->capacity) agg->min_window = min_open;
+    return written;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int session_aggregator_open_windows(SessionAggregator* agg) {
+    return agg ? agg->size : 0;
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE
+int session_aggregator_late_events(SessionAggregator* agg) {
+    return agg ? agg->late_events : 0;
+}
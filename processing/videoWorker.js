@@ -22,6 +22,15 @@ const projectRoot = path.resolve(__dirname, "..");
 
 // --- HLS Transcoding Logic ---
 
+// Variant streams, highest first as listed in the master playlist
+// (segment_sizes.json and the ABR ladder list them ascending)
+const HLS_RENDITIONS = [
+    { name: '720p', bandwidth: 2800000, resolution: '1280x720' },
+    { name: '480p', bandwidth: 1200000, resolution: '854x480' },
+    { name: '360p', bandwidth: 700000, resolution: '640x360' },
+];
+const HLS_SEGMENT_SECONDS = 10;
+
 const generateHLS = (filePath, outputDir) => {
     const watermarkPath = path.join(projectRoot, 'BACKEND', 'public', 'watermark.svg');
     
@@ -34,7 +43,7 @@ const generateHLS = (filePath, outputDir) => {
                 '-c:v libx264','-b:v 2500k','-maxrate 2675k','-bufsize 3750k',
                 '-c:a aac','-b:a 128k',
                 '-preset veryfast',
-                '-hls_time 10',
+                `-hls_time ${HLS_SEGMENT_SECONDS}`,
                 '-hls_playlist_type vod',
                 '-hls_segment_filename', path.join(outputDir, '720p_%03d.ts'),
             ])
@@ -46,7 +55,7 @@ const generateHLS = (filePath, outputDir) => {
                 '-c:v libx264','-b:v 1000k','-maxrate 1075k','-bufsize 1500k',
                 '-c:a aac','-b:a 96k',
                 '-preset veryfast',
-                '-hls_time 10',
+                `-hls_time ${HLS_SEGMENT_SECONDS}`,
                 '-hls_playlist_type vod',
                 '-hls_segment_filename', path.join(outputDir, '480p_%03d.ts'),
             ])
@@ -58,21 +67,18 @@ const generateHLS = (filePath, outputDir) => {
                 '-c:v libx264','-b:v 600k','-maxrate 645k','-bufsize 900k',
                 '-c:a aac','-b:a 64k',
                 '-preset veryfast',
-                '-hls_time 10',
+                `-hls_time ${HLS_SEGMENT_SECONDS}`,
                 '-hls_playlist_type vod',
                 '-hls_segment_filename', path.join(outputDir, '360p_%03d.ts'),
             ])
             .on('end',async()=>{
-                const masterPlaylist = `#EXTM3U
-#EXT-X-VERSION:3
-#EXT-X-STREAM-INF:BANDWIDTH=2800000,RESOLUTION=1280x720
-720p.m3u8
-#EXT-X-STREAM-INF:BANDWIDTH=1200000,RESOLUTION=854x480
-480p.m3u8
-#EXT-X-STREAM-INF:BANDWIDTH=700000,RESOLUTION=640x360
-360p.m3u8`;
+                const masterPlaylist = ['#EXTM3U', '#EXT-X-VERSION:3',
+                    ...HLS_RENDITIONS.flatMap(({ name, bandwidth, resolution }) =>
+                        [`#EXT-X-STREAM-INF:BANDWIDTH=${bandwidth},RESOLUTION=${resolution}`, `${name}.m3u8`]),
+                ].join('\n');
                 try {
-                    await fs.watchFile(path.join(outputDir, 'master.m3u8'), masterPlaylist);
+                    await fs.writeFile(path.join(outputDir, 'master.m3u8'), masterPlaylist);
+                    await writeSegmentSizes(outputDir);
                     resolve("HLS generation completed.");
                 } catch (e) {
                     reject(e);
@@ -84,6 +90,26 @@ const generateHLS = (filePath, outputDir) => {
         })
 }
 
+// Per-segment byte sizes for VBR-aware ABR (abr_ladder_set_segment_sizes),
+// renditions in ascending bitrate like the ABR ladder.
+// Read by abr_simulator --sizes (cpp/abr_simulator.cpp)
+const writeSegmentSizes = async (outputDir) => {
+    const files = await fs.readdir(outputDir);
+    const sidecar = { segmentDuration: HLS_SEGMENT_SECONDS, renditions: [] };
+
+    for (const { name, bandwidth } of [...HLS_RENDITIONS].reverse()) {
+        // Order by segment number: names are zero-padded to 3 digits only
+        const segments = files
+            .map(file => ({ file, match: file.match(new RegExp(`^${name}_(\\d+)\\.ts$`)) }))
+            .filter(({ match }) => match)
+            .map(({ file, match }) => ({ file, index: Number(match[1]) }))
+            .sort((a, b) => a.index - b.index);
+        const sizes = await Promise.all(segments.map(async ({ file }) => (await fs.stat(path.join(outputDir, file))).size));
+        sidecar.renditions.push({ name, bandwidth, sizes });
+    }
+
+    await fs.writeFile(path.join(outputDir, 'segment_sizes.json'), JSON.stringify(sidecar));
+};
 
 const uploadHLSFiles = async (hlsDir, videoId) => {
     const files = await fs.readdir(hlsDir);